@@ -0,0 +1,779 @@
+/**
+ * @file adaptive.c
+ * @brief ARC, CLOCK-Pro and W-TinyLFU for fully associative caches
+ *
+ * The policies keep an entry per resident block and, for ARC and
+ * CLOCK-Pro, per ghost (a block recently evicted, remembered without its
+ * data). With c lines there are
+ * at most c resident entries and c ghosts, so all entries come from one
+ * arena of 2c + 1 slots allocated up front and recycled through a free
+ * list; nothing is allocated per access. Entries are linked by 32-bit
+ * arena indexes rather than pointers, which halves the size of the links,
+ * and a chained hash table over the same indexes finds the entry of a
+ * block in expected O(1).
+ *
+ * ARC (Megiddo and Modha, FAST 2003) keeps four LRU lists: T1 and T2 hold
+ * the resident blocks seen once and seen more than once recently, B1 and
+ * B2 the ghosts evicted from each. A hit on a ghost of B1 means T1 was too
+ * small and grows its target size p; a hit on a ghost of B2 shrinks it.
+ * The lists are intrusive: each entry carries its own links and the list
+ * it is on, so every move is O(1).
+ *
+ * CLOCK-Pro (Jiang, Chen and Zhang, USENIX ATC 2005) keeps resident hot
+ * and cold blocks and non-resident test blocks (ghosts of recently
+ * evicted cold blocks) on one circular list swept by three hands. The
+ * cold hand evicts unreferenced cold blocks and promotes referenced ones;
+ * the hot hand demotes unreferenced hot blocks; the test hand, and the hot
+ * hand as it passes them, retire test blocks. A hit on a test block means its reuse distance was short
+ * enough to deserve a resident line, and grows the share of cold lines.
+ * This follows the common simplified form of the algorithm, in which a
+ * miss always enters as cold and a test hit re-enters as hot.
+ *
+ * W-TinyLFU (Einziger, Friedman and Manes, 2017) puts new blocks in a
+ * small LRU window (1% of the lines) in front of a segmented LRU main
+ * region, whose protected segment holds 80% of it and takes the blocks
+ * hit again while on probation. A block pushed out of the full window
+ * only enters the main region if it was accessed more often than the
+ * probation block it would evict; otherwise the window block itself goes.
+ * Access frequencies come from a count-min sketch of 4-bit counters,
+ * halved after every 10c accesses so that old popularity fades. The
+ * counters of a block all lie in one 64-byte, line-aligned group of 8
+ * words, picked with one multiplicative hash whose other bits select a
+ * counter in each of 4 word pairs, so an update or estimate touches one
+ * host cache line and runs as 4 independent, branch-free steps.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "adaptive.h"
+
+/** @brief Marks the end of a list or hash chain */
+#define NIL UINT32_MAX
+
+/** @brief Largest capacity in lines, so that indexes fit in 32 bits */
+#define ADAPTIVE_MAX_LINES (1UL << 30)
+
+/**
+ * @brief Where an entry is
+ */
+enum {
+    ARC_T1,     /* resident, seen once */
+    ARC_T2,     /* resident, seen at least twice */
+    ARC_B1,     /* ghost evicted from T1 */
+    ARC_B2,     /* ghost evicted from T2 */
+    TLFU_WINDOW,    /* W-TinyLFU: resident, in the window */
+    TLFU_PROBATION, /* W-TinyLFU: resident, main region, seen once there */
+    TLFU_PROTECTED, /* W-TinyLFU: resident, main region, hit there */
+    NUM_LISTS,
+    CP_HOT = NUM_LISTS, /* CLOCK-Pro: resident, hot */
+    CP_COLD,    /* CLOCK-Pro: resident, cold */
+    CP_TEST,    /* CLOCK-Pro: non-resident, in its test period */
+    ENTRY_FREE, /* on the free list */
+};
+
+/**
+ * @brief One block known to the policy, resident or ghost
+ */
+typedef struct {
+    unsigned long block;  /* block number (address >> b) */
+    uint32_t prev, next;  /* list or ring links; next links the free list */
+    uint32_t chain;       /* next entry in the same hash bucket */
+    unsigned char where;  /* one of the enum above */
+    bool ref;             /* CLOCK-Pro reference bit */
+    bool dirty;           /* resident block was stored to */
+    unsigned short owner; /* owner of a resident block, if tracked */
+} entry_t;
+
+/**
+ * @brief An intrusive LRU list: head is the most recently used entry
+ */
+typedef struct {
+    uint32_t head, tail;
+    unsigned long size;
+} list_t;
+
+/** @brief Rows of the sketch, i.e. counters per block */
+#define SKETCH_ROWS 4
+
+/**
+ * @brief A count-min sketch of 4-bit counters, in 64-byte groups of 8
+ * words; row r of a group is words 2r and 2r + 1
+ */
+typedef struct {
+    uint64_t *table;          /* groups of 8 words, 64-byte aligned */
+    unsigned long group_mask; /* number of groups - 1 */
+    unsigned long additions;  /* increments since the last halving */
+    unsigned long sample;     /* increments between halvings */
+} sketch_t;
+
+struct adaptive {
+    cache_policy_t policy;
+    unsigned long lines; /* capacity c, in blocks */
+    entry_t *entries;    /* arena of 2c + 1 entries */
+    uint32_t num_entries;
+    uint32_t free;       /* first free entry */
+    uint32_t *buckets;   /* hash table heads */
+    unsigned int hash_shift;
+    unsigned long resident;
+
+    /* ARC */
+    list_t lists[NUM_LISTS]; /* indexed by where */
+    unsigned long p;          /* target size of T1 */
+
+    /* W-TinyLFU */
+    sketch_t sketch;
+    unsigned long window_max;    /* lines of the window */
+    unsigned long main_max;      /* lines of the main region */
+    unsigned long protected_max; /* lines of the protected segment */
+
+    /* CLOCK-Pro */
+    uint32_t hand_hot, hand_cold, hand_test;
+    unsigned long count_hot, count_cold, count_test;
+    unsigned long mem_cold; /* target number of cold lines */
+};
+
+/*
+ * Arena and hash table
+ */
+
+static uint32_t bucket_of(const adaptive_t *state, unsigned long block) {
+    return (uint32_t)((block * 0x9e3779b97f4a7c15UL) >> state->hash_shift);
+}
+
+static uint32_t find(const adaptive_t *state, unsigned long block) {
+    uint32_t i = state->buckets[bucket_of(state, block)];
+    while (i != NIL && state->entries[i].block != block)
+        i = state->entries[i].chain;
+    return i;
+}
+
+/**
+ * @brief Takes an entry from the free list and hashes it under a block.
+ */
+static uint32_t entry_new(adaptive_t *state, unsigned long block) {
+    uint32_t i = state->free;
+    entry_t *e = &state->entries[i];
+    state->free = e->next;
+
+    uint32_t *head = &state->buckets[bucket_of(state, block)];
+    memset(e, 0, sizeof(*e));
+    e->block = block;
+    e->prev = e->next = NIL;
+    e->chain = *head;
+    *head = i;
+    return i;
+}
+
+/**
+ * @brief Unhashes an entry and returns it to the free list.
+ */
+static void entry_delete(adaptive_t *state, uint32_t i) {
+    entry_t *e = &state->entries[i];
+    uint32_t *link = &state->buckets[bucket_of(state, e->block)];
+    while (*link != i)
+        link = &state->entries[*link].chain;
+    *link = e->chain;
+
+    e->where = ENTRY_FREE;
+    e->next = state->free;
+    state->free = i;
+}
+
+/**
+ * @brief Allocates the state of a policy.
+ *
+ * @param[in] policy  CACHE_ARC or CACHE_CLOCKPRO
+ * @param[in] lines   Capacity of the cache, in lines
+ *
+ * @return The state, or NULL if the policy is not adaptive, the capacity
+ * is out of range or memory ran out
+ */
+adaptive_t *adaptive_new(cache_policy_t policy, unsigned long lines) {
+    if ((policy != CACHE_ARC && policy != CACHE_CLOCKPRO &&
+         policy != CACHE_TINYLFU) ||
+        lines == 0 || lines > ADAPTIVE_MAX_LINES)
+        return NULL;
+
+    adaptive_t *state = calloc(1, sizeof(*state));
+    if (state == NULL)
+        return NULL;
+    state->policy = policy;
+    state->lines = lines;
+    state->num_entries = (uint32_t)(2 * lines + 1);
+
+    /* At least two buckets per entry keeps the chains short */
+    unsigned int bits = 1;
+    while ((1UL << bits) < 2UL * state->num_entries)
+        bits++;
+    state->hash_shift = 64 - bits;
+    state->entries = malloc(state->num_entries * sizeof(*state->entries));
+    state->buckets = malloc((1UL << bits) * sizeof(*state->buckets));
+    if (state->entries == NULL || state->buckets == NULL) {
+        adaptive_delete(state);
+        return NULL;
+    }
+
+    if (policy == CACHE_TINYLFU) {
+        state->main_max = lines - (lines / 100 > 0 ? lines / 100 : 1);
+        state->window_max = lines - state->main_max;
+        state->protected_max = state->main_max * 4 / 5;
+        /* One 4-bit counter per row for every 4 lines, at least */
+        unsigned long groups = 1;
+        while (groups * 8 < lines)
+            groups <<= 1;
+        state->sketch.group_mask = groups - 1;
+        state->sketch.sample = 10 * lines;
+        void *table;
+        if (posix_memalign(&table, 64, groups * 8 * sizeof(uint64_t)) != 0) {
+            adaptive_delete(state);
+            return NULL;
+        }
+        state->sketch.table = table;
+    }
+    adaptive_reset(state);
+    return state;
+}
+
+/**
+ * @brief Releases the state of a policy.
+ */
+void adaptive_delete(adaptive_t *state) {
+    if (state == NULL)
+        return;
+    free(state->entries);
+    free(state->buckets);
+    free(state->sketch.table);
+    free(state);
+}
+
+/**
+ * @brief Forgets every block, resident or ghost.
+ */
+void adaptive_reset(adaptive_t *state) {
+    memset(state->buckets, 0xff,
+           (1UL << (64 - state->hash_shift)) * sizeof(*state->buckets));
+    for (uint32_t i = 0; i < state->num_entries; i++) {
+        state->entries[i].where = ENTRY_FREE;
+        state->entries[i].next = i + 1 < state->num_entries ? i + 1 : NIL;
+    }
+    state->free = 0;
+    state->resident = 0;
+    for (int l = 0; l < NUM_LISTS; l++) {
+        state->lists[l].head = state->lists[l].tail = NIL;
+        state->lists[l].size = 0;
+    }
+    state->p = 0;
+    state->hand_hot = state->hand_cold = state->hand_test = NIL;
+    state->count_hot = state->count_cold = state->count_test = 0;
+    state->mem_cold = state->lines;
+    if (state->sketch.table != NULL) {
+        memset(state->sketch.table, 0,
+               (state->sketch.group_mask + 1) * 8 * sizeof(uint64_t));
+        state->sketch.additions = 0;
+    }
+}
+
+/*
+ * Accounting shared by all policies
+ */
+
+/**
+ * @brief Records the eviction of a resident entry, which stays in the
+ * arena as a ghost or is deleted by the caller.
+ */
+static void evict(cache_t *cache, entry_t *e) {
+    adaptive_t *state = cache->adaptive;
+    state->resident--;
+    cache->stats.evictions++;
+    cache->evicted_addr = e->block << cache->b;
+    cache->evicted_dirty = e->dirty;
+    if (e->dirty) {
+        cache->stats.dirty_evictions += cache->block_bytes;
+        cache->stats.dirty_bytes -= cache->block_bytes;
+        e->dirty = false;
+    }
+    if (cache->owner != NULL) {
+        cache->victim = e->owner;
+        cache->occupancy[e->owner]--;
+    }
+}
+
+/**
+ * @brief Records that a block became resident.
+ */
+static void fill(cache_t *cache, entry_t *e, bool store) {
+    cache->adaptive->resident++;
+    e->dirty = store;
+    if (store)
+        cache->stats.dirty_bytes += cache->block_bytes;
+    if (cache->owner != NULL) {
+        e->owner = cache->current;
+        cache->occupancy[cache->current]++;
+    }
+}
+
+/**
+ * @brief Records a hit on a resident block.
+ */
+static void touch(cache_t *cache, entry_t *e, bool store) {
+    cache->stats.hits++;
+    if (store && !e->dirty) {
+        e->dirty = true;
+        cache->stats.dirty_bytes += cache->block_bytes;
+    }
+}
+
+/*
+ * ARC
+ */
+
+static void list_remove(adaptive_t *state, uint32_t i) {
+    entry_t *e = &state->entries[i];
+    list_t *list = &state->lists[e->where];
+    if (e->prev != NIL)
+        state->entries[e->prev].next = e->next;
+    else
+        list->head = e->next;
+    if (e->next != NIL)
+        state->entries[e->next].prev = e->prev;
+    else
+        list->tail = e->prev;
+    list->size--;
+}
+
+static void list_push(adaptive_t *state, int where, uint32_t i) {
+    entry_t *e = &state->entries[i];
+    list_t *list = &state->lists[where];
+    e->where = (unsigned char)where;
+    e->prev = NIL;
+    e->next = list->head;
+    if (list->head != NIL)
+        state->entries[list->head].prev = i;
+    else
+        list->tail = i;
+    list->head = i;
+    list->size++;
+}
+
+/**
+ * @brief Moves an entry to the most recently used end of a list.
+ */
+static void list_move(adaptive_t *state, int where, uint32_t i) {
+    list_remove(state, i);
+    list_push(state, where, i);
+}
+
+/**
+ * @brief Moves the LRU block of T1 or T2 to the matching ghost list.
+ *
+ * @param[in] in_b2  Whether the block missed on is a ghost of B2
+ */
+static void arc_replace(cache_t *cache, bool in_b2) {
+    adaptive_t *state = cache->adaptive;
+    unsigned long t1 = state->lists[ARC_T1].size;
+    int from = ARC_T2, to = ARC_B2;
+    if (t1 > 0 && (t1 > state->p || (in_b2 && t1 == state->p))) {
+        from = ARC_T1;
+        to = ARC_B1;
+    }
+    uint32_t victim = state->lists[from].tail;
+    evict(cache, &state->entries[victim]);
+    list_move(state, to, victim);
+}
+
+/**
+ * @brief Deletes the LRU entry of a list.
+ */
+static void arc_discard(adaptive_t *state, int where) {
+    uint32_t i = state->lists[where].tail;
+    list_remove(state, i);
+    entry_delete(state, i);
+}
+
+static cache_result_t arc_access(cache_t *cache, unsigned long block,
+                                 bool store) {
+    adaptive_t *state = cache->adaptive;
+    list_t *lists = state->lists;
+    unsigned long c = state->lines;
+    uint32_t i = find(state, block);
+
+    if (i != NIL && state->entries[i].where <= ARC_T2) {
+        touch(cache, &state->entries[i], store);
+        list_move(state, ARC_T2, i);
+        return CACHE_HIT;
+    }
+
+    cache->stats.misses++;
+    unsigned long evictions = cache->stats.evictions;
+    cache_result_t result = state->resident == 0 ? CACHE_COLD_MISS : CACHE_MISS;
+    if (i != NIL) {
+        unsigned long b1 = lists[ARC_B1].size, b2 = lists[ARC_B2].size;
+        bool in_b2 = state->entries[i].where == ARC_B2;
+        if (!in_b2) {
+            unsigned long delta = b1 >= b2 ? 1 : b2 / b1;
+            state->p = state->p + delta < c ? state->p + delta : c;
+        } else {
+            unsigned long delta = b2 >= b1 ? 1 : b1 / b2;
+            state->p = state->p > delta ? state->p - delta : 0;
+        }
+        if (state->resident == c)
+            arc_replace(cache, in_b2);
+        list_move(state, ARC_T2, i);
+    } else {
+        unsigned long l1 = lists[ARC_T1].size + lists[ARC_B1].size;
+        unsigned long total =
+            l1 + lists[ARC_T2].size + lists[ARC_B2].size;
+        if (l1 == c) {
+            if (lists[ARC_T1].size < c) {
+                arc_discard(state, ARC_B1);
+                if (state->resident == c)
+                    arc_replace(cache, false);
+            } else {
+                uint32_t victim = lists[ARC_T1].tail;
+                list_remove(state, victim);
+                evict(cache, &state->entries[victim]);
+                entry_delete(state, victim);
+            }
+        } else if (total >= c) {
+            if (total == 2 * c)
+                arc_discard(state, ARC_B2);
+            if (state->resident == c)
+                arc_replace(cache, false);
+        }
+        i = entry_new(state, block);
+        list_push(state, ARC_T1, i);
+    }
+    fill(cache, &state->entries[i], store);
+    return cache->stats.evictions != evictions ? CACHE_MISS_EVICT : result;
+}
+
+/*
+ * CLOCK-Pro
+ */
+
+/**
+ * @brief Unlinks an entry from the ring, moving any hand off it first,
+ * and deletes it.
+ */
+static void cp_delete(adaptive_t *state, uint32_t i) {
+    entry_t *e = &state->entries[i];
+    uint32_t next = e->next == i ? NIL : e->next;
+    if (state->hand_hot == i)
+        state->hand_hot = next;
+    if (state->hand_cold == i)
+        state->hand_cold = next;
+    if (state->hand_test == i)
+        state->hand_test = next;
+    if (next != NIL) {
+        state->entries[e->prev].next = e->next;
+        state->entries[e->next].prev = e->prev;
+    }
+    entry_delete(state, i);
+}
+
+/**
+ * @brief Ends the test period of a test block: it leaves the ring, and the
+ * cold share shrinks since the block was not reused in time.
+ */
+static void cp_retire(adaptive_t *state, uint32_t i) {
+    cp_delete(state, i);
+    state->count_test--;
+    if (state->mem_cold > 1)
+        state->mem_cold--;
+}
+
+/**
+ * @brief Retires the test block under the test hand, if any, and advances.
+ */
+static void cp_run_hand_test(cache_t *cache) {
+    adaptive_t *state = cache->adaptive;
+    uint32_t i = state->hand_test;
+    state->hand_test = state->entries[i].next;
+    if (state->entries[i].where == CP_TEST)
+        cp_retire(state, i);
+}
+
+/**
+ * @brief Demotes the hot block under the hot hand unless it was
+ * referenced, and advances. Test blocks the hot hand passes are retired,
+ * as in the paper, so the hot hand never has to wait for the test hand.
+ */
+static void cp_run_hand_hot(cache_t *cache) {
+    adaptive_t *state = cache->adaptive;
+    uint32_t i = state->hand_hot;
+    entry_t *e = &state->entries[i];
+    state->hand_hot = e->next;
+    if (e->where == CP_HOT) {
+        if (e->ref) {
+            e->ref = false;
+        } else {
+            e->where = CP_COLD;
+            state->count_hot--;
+            state->count_cold++;
+        }
+    } else if (e->where == CP_TEST) {
+        cp_retire(state, i);
+    }
+}
+
+/**
+ * @brief Promotes the cold block under the cold hand if it was referenced
+ * and evicts it to a test block otherwise, then advances. The hot hand
+ * then runs until the hot blocks fit in the lines not reserved for cold
+ * ones.
+ *
+ * Every call either evicts, or promotes a cold block that the hot hand
+ * will demote again within two laps, so the loop in cp_add() ends.
+ */
+static void cp_run_hand_cold(cache_t *cache) {
+    adaptive_t *state = cache->adaptive;
+    entry_t *e = &state->entries[state->hand_cold];
+    state->hand_cold = e->next;
+    if (e->where == CP_COLD) {
+        if (e->ref) {
+            e->where = CP_HOT;
+            e->ref = false;
+            state->count_cold--;
+            state->count_hot++;
+        } else {
+            evict(cache, e);
+            e->where = CP_TEST;
+            state->count_cold--;
+            state->count_test++;
+            while (state->lines < state->count_test)
+                cp_run_hand_test(cache);
+        }
+    }
+    while (state->lines - state->mem_cold < state->count_hot)
+        cp_run_hand_hot(cache);
+}
+
+/**
+ * @brief Makes room for one block and links a new entry in behind the
+ * hot hand, where the sweep will reach it last.
+ */
+static uint32_t cp_add(cache_t *cache, unsigned long block, int where) {
+    adaptive_t *state = cache->adaptive;
+    while (state->count_hot + state->count_cold >= state->lines)
+        cp_run_hand_cold(cache);
+
+    uint32_t i = entry_new(state, block);
+    entry_t *e = &state->entries[i];
+    e->where = (unsigned char)where;
+    if (state->hand_hot == NIL) {
+        e->prev = e->next = i;
+        state->hand_hot = state->hand_cold = state->hand_test = i;
+    } else {
+        entry_t *at = &state->entries[state->hand_hot];
+        e->next = state->hand_hot;
+        e->prev = at->prev;
+        state->entries[at->prev].next = i;
+        at->prev = i;
+    }
+    if (state->hand_cold == state->hand_hot)
+        state->hand_cold = state->entries[state->hand_cold].prev;
+    return i;
+}
+
+static cache_result_t cp_access(cache_t *cache, unsigned long block,
+                                bool store) {
+    adaptive_t *state = cache->adaptive;
+    uint32_t i = find(state, block);
+
+    if (i != NIL && state->entries[i].where != CP_TEST) {
+        touch(cache, &state->entries[i], store);
+        state->entries[i].ref = true;
+        return CACHE_HIT;
+    }
+
+    cache->stats.misses++;
+    unsigned long evictions = cache->stats.evictions;
+    cache_result_t result = state->resident == 0 ? CACHE_COLD_MISS : CACHE_MISS;
+    if (i != NIL) {
+        if (state->mem_cold < state->lines)
+            state->mem_cold++;
+        cp_delete(state, i);
+        state->count_test--;
+        i = cp_add(cache, block, CP_HOT);
+        state->count_hot++;
+    } else {
+        i = cp_add(cache, block, CP_COLD);
+        state->count_cold++;
+    }
+    fill(cache, &state->entries[i], store);
+    return cache->stats.evictions != evictions ? CACHE_MISS_EVICT : result;
+}
+
+/*
+ * W-TinyLFU
+ */
+
+/**
+ * @brief Finds the counters of a block: one hash picks the group, and
+ * 5 more of its bits per row pick the word of the row and the counter.
+ */
+static void sketch_slots(const sketch_t *sketch, unsigned long block,
+                         uint64_t *word[SKETCH_ROWS],
+                         unsigned int at[SKETCH_ROWS]) {
+    uint64_t h = (uint64_t)block * 0x9e3779b97f4a7c15ULL;
+    h ^= h >> 29;
+    uint64_t *group = sketch->table + ((h >> 32) & sketch->group_mask) * 8;
+    for (int r = 0; r < SKETCH_ROWS; r++) {
+        unsigned int bits = (unsigned int)(h >> (5 * r));
+        word[r] = group + 2 * r + (bits & 1);
+        at[r] = ((bits >> 1) & 15) * 4;
+    }
+}
+
+/**
+ * @brief Estimates how often a block was accessed: its smallest counter.
+ */
+static unsigned int sketch_frequency(const sketch_t *sketch,
+                                     unsigned long block) {
+    uint64_t *word[SKETCH_ROWS];
+    unsigned int at[SKETCH_ROWS];
+    sketch_slots(sketch, block, word, at);
+    unsigned int min = 15;
+    for (int r = 0; r < SKETCH_ROWS; r++) {
+        unsigned int c = (unsigned int)(*word[r] >> at[r]) & 15;
+        min = c < min ? c : min;
+    }
+    return min;
+}
+
+/**
+ * @brief Counts an access to a block, halving every counter once the
+ * sample is complete.
+ */
+static void sketch_increment(sketch_t *sketch, unsigned long block) {
+    uint64_t *word[SKETCH_ROWS];
+    unsigned int at[SKETCH_ROWS];
+    sketch_slots(sketch, block, word, at);
+    for (int r = 0; r < SKETCH_ROWS; r++)
+        *word[r] += (uint64_t)(((*word[r] >> at[r]) & 15) != 15) << at[r];
+
+    if (++sketch->additions >= sketch->sample) {
+        size_t words = (sketch->group_mask + 1) * 8;
+        for (size_t w = 0; w < words; w++)
+            sketch->table[w] = (sketch->table[w] >> 1) & 0x7777777777777777ULL;
+        sketch->additions /= 2;
+    }
+}
+
+static cache_result_t tlfu_access(cache_t *cache, unsigned long block,
+                                  bool store) {
+    adaptive_t *state = cache->adaptive;
+    list_t *lists = state->lists;
+    sketch_increment(&state->sketch, block);
+    uint32_t i = find(state, block);
+
+    if (i != NIL) {
+        touch(cache, &state->entries[i], store);
+        if (state->entries[i].where != TLFU_PROBATION) {
+            list_move(state, state->entries[i].where, i);
+            return CACHE_HIT;
+        }
+        list_move(state, TLFU_PROTECTED, i);
+        if (lists[TLFU_PROTECTED].size > state->protected_max)
+            list_move(state, TLFU_PROBATION, lists[TLFU_PROTECTED].tail);
+        return CACHE_HIT;
+    }
+
+    cache->stats.misses++;
+    cache_result_t result = state->resident == 0 ? CACHE_COLD_MISS : CACHE_MISS;
+    i = entry_new(state, block);
+    list_push(state, TLFU_WINDOW, i);
+    fill(cache, &state->entries[i], store);
+    if (lists[TLFU_WINDOW].size <= state->window_max)
+        return result;
+
+    /* The window block either enters the main region or is evicted */
+    uint32_t candidate = lists[TLFU_WINDOW].tail;
+    list_remove(state, candidate);
+    if (lists[TLFU_PROBATION].size + lists[TLFU_PROTECTED].size <
+        state->main_max) {
+        list_push(state, TLFU_PROBATION, candidate);
+        return result;
+    }
+    uint32_t victim = lists[TLFU_PROBATION].tail != NIL
+                          ? lists[TLFU_PROBATION].tail
+                          : lists[TLFU_PROTECTED].tail;
+    if (victim != NIL &&
+        sketch_frequency(&state->sketch, state->entries[candidate].block) >
+            sketch_frequency(&state->sketch, state->entries[victim].block)) {
+        list_remove(state, victim);
+        list_push(state, TLFU_PROBATION, candidate);
+    } else {
+        victim = candidate;
+    }
+    evict(cache, &state->entries[victim]);
+    entry_delete(state, victim);
+    return CACHE_MISS_EVICT;
+}
+
+/**
+ * @brief Simulates one load or store under the policy of the cache.
+ *
+ * The statistics, evicted_addr/evicted_dirty and, if owners are tracked,
+ * victim and occupancy are updated as by the LRU path of cache_access().
+ *
+ * @return What the access did to the cache
+ */
+cache_result_t adaptive_access(cache_t *cache, unsigned long addr,
+                               bool store) {
+    unsigned long block = addr >> cache->b;
+    cache->clock++;
+    switch (cache->adaptive->policy) {
+    case CACHE_ARC:
+        return arc_access(cache, block, store);
+    case CACHE_TINYLFU:
+        return tlfu_access(cache, block, store);
+    default:
+        return cp_access(cache, block, store);
+    }
+}
+
+/**
+ * @brief Drops a resident block without counting an eviction.
+ *
+ * The entry is deleted, not kept as a ghost, and the occupancy of its
+ * owner is updated if owners are tracked; the dirty bytes are left to the
+ * caller. A ghost is not resident and is left alone. ARC only replaces a
+ * block while the cache is full, so the next misses refill the line first,
+ * as they do under the other policies.
+ *
+ * @param[in,out] cache  The cache, run by ARC, CLOCK-Pro or W-TinyLFU
+ * @param[in]     addr   An address in the block
+ * @param[out]    dirty  Whether the dropped block was dirty
+ *
+ * @return True if the block was resident, false otherwise
+ */
+bool adaptive_invalidate(cache_t *cache, unsigned long addr, bool *dirty) {
+    adaptive_t *state = cache->adaptive;
+    uint32_t i = find(state, addr >> cache->b);
+    if (i == NIL)
+        return false;
+    entry_t *e = &state->entries[i];
+    if (e->where == ARC_B1 || e->where == ARC_B2 || e->where == CP_TEST)
+        return false;
+
+    *dirty = e->dirty;
+    state->resident--;
+    if (cache->owner != NULL)
+        cache->occupancy[e->owner]--;
+    if (e->where == CP_HOT || e->where == CP_COLD) {
+        if (e->where == CP_HOT)
+            state->count_hot--;
+        else
+            state->count_cold--;
+        cp_delete(state, i);
+    } else {
+        list_remove(state, i);
+        entry_delete(state, i);
+    }
+    return true;
+}
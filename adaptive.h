@@ -0,0 +1,38 @@
+/**
+ * @file adaptive.h
+ * @brief Scan-resistant replacement policies for fully associative caches
+ *
+ * ARC and CLOCK-Pro remember some blocks that were recently evicted
+ * (ghosts), and use hits on them to adapt how much of the cache goes to
+ * blocks seen once versus blocks seen again. W-TinyLFU only admits a new
+ * block into its main region if a frequency sketch says it is more
+ * popular than the block it would evict. Both are meant for large
+ * fully associative caches, such as application-level block caches: a
+ * cache_t with s = 0 and E lines switches to them with cache_set_policy(),
+ * after which cache_access() runs the policy instead of LRU.
+ */
+
+#ifndef ADAPTIVE_H
+#define ADAPTIVE_H
+
+#include <stdbool.h>
+
+#include "cache.h"
+
+/** @brief Creates the state of a policy for a cache of some lines */
+adaptive_t *adaptive_new(cache_policy_t policy, unsigned long lines);
+
+/** @brief Releases the state of a policy */
+void adaptive_delete(adaptive_t *state);
+
+/** @brief Forgets every block, resident or ghost */
+void adaptive_reset(adaptive_t *state);
+
+/** @brief Simulates one load or store under the policy of the cache */
+cache_result_t adaptive_access(cache_t *cache, unsigned long addr,
+                               bool store);
+
+/** @brief Drops a resident block without counting an eviction */
+bool adaptive_invalidate(cache_t *cache, unsigned long addr, bool *dirty);
+
+#endif /* ADAPTIVE_H */
@@ -0,0 +1,603 @@
+/**
+ * @file bench-csim.c
+ * @brief Measures the throughput of the cache simulator
+ *
+ * test-csim only checks that csim agrees with csim-ref. This program runs a
+ * fixed matrix of (trace pattern x s/E/b x policy) cases against ./csim and
+ * reports, for each case:
+ *
+ *   - accesses per second and nanoseconds per access (best of -r runs),
+ *   - peak resident set size of the simulator process,
+ *   - retired instructions per access, when perf_event_open is available.
+ *
+ * The synthetic traces are generated deterministically into a private
+ * temporary directory, and csim is run inside that directory so that its
+ * .csim_results and .csim_stats files do not clobber the caller's.
+ *
+ * Results are written as JSON, one case per line. When a baseline file is
+ * given, every case whose throughput fell more than the allowed percentage
+ * below the baseline is reported and the program exits with status 1.
+ */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <limits.h>
+#include <linux/perf_event.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MAX_STR 1024 /* Max string size */
+#define MAX_NAME 128 /* Max case name size */
+
+/** @brief Default number of accesses in each synthetic trace */
+#define DEFAULT_ACCESSES 1000000
+
+/** @brief Default number of timed runs per case (the best one is kept) */
+#define DEFAULT_RUNS 3
+
+/** @brief Default allowed throughput regression, in percent */
+#define DEFAULT_THRESHOLD 10.0
+
+/** @brief Kinds of synthetic access patterns */
+typedef enum {
+    PATTERN_SEQ,    /* unit-stride sweep over a large array */
+    PATTERN_STRIDE, /* page-stride sweep, conflicts in every set */
+    PATTERN_RANDOM, /* uniformly random over a 256 MB footprint */
+    PATTERN_HOT,    /* 90% of accesses to a 32 KB hot region */
+} pattern_t;
+
+typedef struct {
+    pattern_t pattern;
+    const char *name;
+} bench_trace_t;
+
+typedef struct {
+    int s;
+    int E;
+    int b;
+} bench_geom_t;
+
+typedef struct {
+    const char *name;
+    const char *args; /* extra csim arguments selecting the policy */
+    bool fully_associative; /* only run on geometries with s = 0 */
+} bench_policy_t;
+
+/** @brief Synthetic traces, generated once per run */
+static const bench_trace_t TRACES[] = {
+    {.pattern = PATTERN_SEQ, .name = "seq"},
+    {.pattern = PATTERN_STRIDE, .name = "stride"},
+    {.pattern = PATTERN_RANDOM, .name = "random"},
+    {.pattern = PATTERN_HOT, .name = "hot"},
+};
+
+/** @brief Cache geometries, from a tiny direct-mapped cache to an LLC */
+static const bench_geom_t GEOMS[] = {
+    {.s = 5, .E = 1, .b = 5},  {.s = 6, .E = 8, .b = 6},
+    {.s = 10, .E = 16, .b = 6}, {.s = 14, .E = 4, .b = 6},
+    {.s = 0, .E = 64, .b = 6},
+};
+
+/** @brief Replacement policies understood by csim */
+static const bench_policy_t POLICIES[] = {
+    {.name = "lru", .args = ""},
+    {.name = "arc", .args = "--policy arc", .fully_associative = true},
+    {.name = "clockpro",
+     .args = "--policy clockpro",
+     .fully_associative = true},
+    {.name = "tinylfu",
+     .args = "--policy tinylfu",
+     .fully_associative = true},
+    {.name = "ship", .args = "--policy ship"},
+};
+
+#define NTRACES (sizeof(TRACES) / sizeof(TRACES[0]))
+#define NGEOMS (sizeof(GEOMS) / sizeof(GEOMS[0]))
+#define NPOLICIES (sizeof(POLICIES) / sizeof(POLICIES[0]))
+#define NCASES (NTRACES * NGEOMS * NPOLICIES)
+
+/** @brief Measurements for a single case */
+typedef struct {
+    char name[MAX_NAME];
+    double seconds;
+    double accesses_per_sec;
+    double ns_per_access;
+    long peak_rss_kb;
+    double instructions_per_access; /* negative if unavailable */
+} bench_result_t;
+
+static unsigned long num_accesses = DEFAULT_ACCESSES;
+static int num_runs = DEFAULT_RUNS;
+static double threshold = DEFAULT_THRESHOLD;
+static char csim_path[PATH_MAX];
+static char work_dir[] = "/tmp/bench-csim.XXXXXX";
+
+/*
+ * usage - Prints usage info
+ */
+static void usage(char *argv[]) {
+    printf("Usage: %s [-h] [-n accesses] [-r runs] [-c csim] [-o out.json]\n"
+           "       [-B baseline.json] [-t percent]\n",
+           argv[0]);
+    printf("Options:\n");
+    printf("  -h              Print this help message.\n");
+    printf("  -n accesses     Accesses per synthetic trace (default %d).\n",
+           DEFAULT_ACCESSES);
+    printf("  -r runs         Timed runs per case, best is kept (default "
+           "%d).\n",
+           DEFAULT_RUNS);
+    printf("  -c csim         Simulator to measure (default ./csim).\n");
+    printf("  -o out.json     Write results to this file.\n");
+    printf("  -B base.json    Compare against this baseline; it is created "
+           "if missing.\n");
+    printf("  -t percent      Allowed throughput regression (default "
+           "%.0f%%).\n",
+           DEFAULT_THRESHOLD);
+}
+
+/**
+ * @brief Small deterministic PRNG so traces are identical across runs.
+ */
+static uint64_t xorshift64(uint64_t *state) {
+    uint64_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    *state = x;
+    return x;
+}
+
+/**
+ * @brief Writes one synthetic trace to the given path.
+ *
+ * @return false if any problems, true if OK.
+ */
+static bool write_trace(const char *path, pattern_t pattern) {
+    FILE *fp = fopen(path, "w");
+    if (fp == NULL) {
+        fprintf(stderr, "Error creating %s: %s\n", path, strerror(errno));
+        return false;
+    }
+
+    const uint64_t base = 0x10000000;
+    const uint64_t footprint = 256UL << 20;
+    uint64_t rng = 0x9e3779b97f4a7c15ULL;
+    for (unsigned long i = 0; i < num_accesses; i++) {
+        uint64_t r = xorshift64(&rng);
+        uint64_t addr;
+        switch (pattern) {
+        case PATTERN_SEQ:
+            addr = base + (i * 8) % footprint;
+            break;
+        case PATTERN_STRIDE:
+            addr = base + (i * 4096 + (i / 65536) * 8) % footprint;
+            break;
+        case PATTERN_RANDOM:
+            addr = base + (r % footprint & ~7ULL);
+            break;
+        case PATTERN_HOT:
+        default:
+            if (r % 10 != 0)
+                addr = base + ((r >> 8) % (32 << 10) & ~7ULL);
+            else
+                addr = base + ((r >> 8) % footprint & ~7ULL);
+            break;
+        }
+        /* Roughly one store for every three loads */
+        char op = (r >> 60) % 4 == 0 ? 'S' : 'L';
+        fprintf(fp, "%c %llx,8\n", op, (unsigned long long)addr);
+    }
+
+    if (fclose(fp) != 0) {
+        fprintf(stderr, "Error writing %s: %s\n", path, strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Opens a retired-instruction counter on a stopped child.
+ *
+ * The counter is enabled automatically when the child calls exec, so the
+ * count covers only the simulator itself.
+ *
+ * @return The counter file descriptor, or -1 if unavailable.
+ */
+static int open_instruction_counter(pid_t pid) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+    attr.disabled = 1;
+    attr.enable_on_exec = 1;
+    attr.inherit = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return (int)syscall(SYS_perf_event_open, &attr, pid, -1, -1, 0);
+}
+
+/**
+ * @brief Runs the simulator once and measures it.
+ *
+ * @param[in]  argv          Simulator command line
+ * @param[out] seconds       Wall-clock time of the run
+ * @param[out] peak_rss_kb   Peak resident set size of the simulator
+ * @param[out] instructions  Retired instructions, or -1 if unavailable
+ *
+ * @return false if any problems, true if OK.
+ */
+static bool run_once(char *const argv[], double *seconds, long *peak_rss_kb,
+                     long long *instructions) {
+    int gate[2];
+    if (pipe(gate) < 0) {
+        fprintf(stderr, "Error creating pipe: %s\n", strerror(errno));
+        return false;
+    }
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        fprintf(stderr, "Error forking: %s\n", strerror(errno));
+        close(gate[0]);
+        close(gate[1]);
+        return false;
+    }
+    if (pid == 0) {
+        /* Wait until the parent has attached the counter */
+        char c;
+        close(gate[1]);
+        if (read(gate[0], &c, 1) != 1)
+            _exit(126);
+        close(gate[0]);
+        int devnull = open("/dev/null", O_WRONLY);
+        if (devnull >= 0)
+            dup2(devnull, STDOUT_FILENO);
+        if (chdir(work_dir) < 0)
+            _exit(126);
+        execv(argv[0], argv);
+        _exit(127);
+    }
+
+    close(gate[0]);
+    int counter = open_instruction_counter(pid);
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    ssize_t res = write(gate[1], "x", 1);
+    (void)res;
+    close(gate[1]);
+
+    int status;
+    struct rusage usage;
+    if (wait4(pid, &status, 0, &usage) < 0) {
+        fprintf(stderr, "Error waiting for csim: %s\n", strerror(errno));
+        if (counter >= 0)
+            close(counter);
+        return false;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    *instructions = -1;
+    if (counter >= 0) {
+        long long count;
+        if (read(counter, &count, sizeof(count)) == sizeof(count))
+            *instructions = count;
+        close(counter);
+    }
+
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        fprintf(stderr, "Error running csim: Status %d\n", status);
+        return false;
+    }
+
+    *seconds = (double)(end.tv_sec - start.tv_sec) +
+               (double)(end.tv_nsec - start.tv_nsec) * 1e-9;
+    *peak_rss_kb = usage.ru_maxrss;
+    return true;
+}
+
+/**
+ * @brief Runs one case of the matrix and collects its measurements.
+ *
+ * @return false if any problems, true if OK.
+ */
+static bool run_case(const bench_trace_t *trace, const bench_geom_t *geom,
+                     const bench_policy_t *policy, bench_result_t *result) {
+    char sflag[] = "-s", eflag[] = "-E", bflag[] = "-b", tflag[] = "-t";
+    char sbuf[16], ebuf[16], bbuf[16], tbuf[MAX_STR], abuf[MAX_STR];
+    char *argv[32];
+    int argc = 0;
+
+    sprintf(sbuf, "%d", geom->s);
+    sprintf(ebuf, "%d", geom->E);
+    sprintf(bbuf, "%d", geom->b);
+    sprintf(tbuf, "%s.trace", trace->name);
+    argv[argc++] = csim_path;
+    argv[argc++] = sflag;
+    argv[argc++] = sbuf;
+    argv[argc++] = eflag;
+    argv[argc++] = ebuf;
+    argv[argc++] = bflag;
+    argv[argc++] = bbuf;
+    argv[argc++] = tflag;
+    argv[argc++] = tbuf;
+
+    /* Split the policy arguments on spaces */
+    strcpy(abuf, policy->args);
+    for (char *tok = strtok(abuf, " "); tok != NULL && argc < 31;
+         tok = strtok(NULL, " ")) {
+        argv[argc++] = tok;
+    }
+    argv[argc] = NULL;
+
+    snprintf(result->name, sizeof(result->name), "%s/s%dE%db%d/%s",
+             trace->name, geom->s, geom->E, geom->b, policy->name);
+    result->seconds = -1;
+    result->peak_rss_kb = 0;
+    result->instructions_per_access = -1;
+
+    for (int run = 0; run < num_runs; run++) {
+        double seconds;
+        long rss;
+        long long instructions;
+        if (!run_once(argv, &seconds, &rss, &instructions)) {
+            fprintf(stderr, "Case %s failed\n", result->name);
+            return false;
+        }
+        if (result->seconds < 0 || seconds < result->seconds)
+            result->seconds = seconds;
+        if (rss > result->peak_rss_kb)
+            result->peak_rss_kb = rss;
+        if (instructions >= 0)
+            result->instructions_per_access =
+                (double)instructions / (double)num_accesses;
+    }
+
+    result->accesses_per_sec = (double)num_accesses / result->seconds;
+    result->ns_per_access = result->seconds * 1e9 / (double)num_accesses;
+    return true;
+}
+
+/**
+ * @brief Writes all results as JSON, one case per line.
+ *
+ * @return false if any problems, true if OK.
+ */
+static bool write_json(const char *path, const bench_result_t *results,
+                       size_t count) {
+    FILE *fp = fopen(path, "w");
+    if (fp == NULL) {
+        fprintf(stderr, "Error creating %s: %s\n", path, strerror(errno));
+        return false;
+    }
+
+    fprintf(fp, "{\n  \"accesses\": %lu,\n  \"cases\": [\n", num_accesses);
+    for (size_t i = 0; i < count; i++) {
+        const bench_result_t *r = &results[i];
+        fprintf(fp,
+                "    {\"name\": \"%s\", \"seconds\": %.6f, "
+                "\"accesses_per_sec\": %.1f, \"ns_per_access\": %.3f, "
+                "\"peak_rss_kb\": %ld, ",
+                r->name, r->seconds, r->accesses_per_sec, r->ns_per_access,
+                r->peak_rss_kb);
+        if (r->instructions_per_access < 0)
+            fprintf(fp, "\"instructions_per_access\": null}");
+        else
+            fprintf(fp, "\"instructions_per_access\": %.2f}",
+                    r->instructions_per_access);
+        fprintf(fp, "%s\n", i + 1 < count ? "," : "");
+    }
+    fprintf(fp, "  ]\n}\n");
+
+    if (fclose(fp) != 0) {
+        fprintf(stderr, "Error writing %s: %s\n", path, strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Looks up the baseline throughput of a case.
+ *
+ * Only files written by write_json() need to be understood, so each case
+ * is found by its name on a line of its own.
+ *
+ * @return The baseline accesses per second, or a negative value if the
+ *         case does not appear in the baseline.
+ */
+static double baseline_throughput(FILE *fp, const char *name) {
+    char line[MAX_STR];
+    char key[MAX_STR];
+    snprintf(key, sizeof(key), "\"name\": \"%.*s\"", MAX_NAME, name);
+
+    rewind(fp);
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        if (strstr(line, key) == NULL)
+            continue;
+        const char *field = strstr(line, "\"accesses_per_sec\":");
+        double aps;
+        if (field != NULL &&
+            sscanf(field, "\"accesses_per_sec\": %lf", &aps) == 1)
+            return aps;
+    }
+    return -1;
+}
+
+/**
+ * @brief Compares results against a baseline file.
+ *
+ * @return The number of cases that regressed beyond the threshold.
+ */
+static int compare_baseline(FILE *fp, const bench_result_t *results,
+                            size_t count) {
+    int regressions = 0;
+    printf("\n%-32s%14s%14s%9s\n", "Case", "Baseline/s", "Current/s",
+           "Change");
+    for (size_t i = 0; i < count; i++) {
+        const bench_result_t *r = &results[i];
+        double base = baseline_throughput(fp, r->name);
+        if (base <= 0) {
+            printf("%-32s%14s%14.0f%9s\n", r->name, "-", r->accesses_per_sec,
+                   "new");
+            continue;
+        }
+        double change = (r->accesses_per_sec - base) / base * 100.0;
+        bool regressed = change < -threshold;
+        printf("%-32s%14.0f%14.0f%+8.1f%%%s\n", r->name, base,
+               r->accesses_per_sec, change, regressed ? "  REGRESSED" : "");
+        regressions += regressed;
+    }
+    return regressions;
+}
+
+/**
+ * @brief Removes the generated traces and the private work directory.
+ */
+static void cleanup(void) {
+    char path[MAX_STR];
+    for (size_t t = 0; t < NTRACES; t++) {
+        snprintf(path, sizeof(path), "%s/%s.trace", work_dir, TRACES[t].name);
+        unlink(path);
+    }
+    snprintf(path, sizeof(path), "%s/.csim_results", work_dir);
+    unlink(path);
+    snprintf(path, sizeof(path), "%s/.csim_stats", work_dir);
+    unlink(path);
+    rmdir(work_dir);
+}
+
+/**
+ * @brief Main routine
+ */
+int main(int argc, char *argv[]) {
+    const char *out_path = NULL;
+    const char *baseline_path = NULL;
+    const char *csim = "./csim";
+    int c;
+
+    while ((c = getopt(argc, argv, "hn:r:c:o:B:t:")) != -1) {
+        switch (c) {
+        case 'n':
+            num_accesses = strtoul(optarg, NULL, 10);
+            break;
+        case 'r':
+            num_runs = atoi(optarg);
+            break;
+        case 'c':
+            csim = optarg;
+            break;
+        case 'o':
+            out_path = optarg;
+            break;
+        case 'B':
+            baseline_path = optarg;
+            break;
+        case 't':
+            threshold = atof(optarg);
+            break;
+        case 'h':
+            usage(argv);
+            exit(0);
+        default:
+            usage(argv);
+            exit(1);
+        }
+    }
+
+    if (num_accesses == 0 || num_runs <= 0 || threshold < 0) {
+        usage(argv);
+        exit(1);
+    }
+    if (realpath(csim, csim_path) == NULL) {
+        fprintf(stderr, "Error: cannot find simulator %s: %s\n", csim,
+                strerror(errno));
+        exit(1);
+    }
+    if (mkdtemp(work_dir) == NULL) {
+        fprintf(stderr, "Error creating work directory: %s\n",
+                strerror(errno));
+        exit(1);
+    }
+
+    for (size_t t = 0; t < NTRACES; t++) {
+        char path[MAX_STR];
+        snprintf(path, sizeof(path), "%s/%s.trace", work_dir, TRACES[t].name);
+        if (!write_trace(path, TRACES[t].pattern)) {
+            cleanup();
+            exit(1);
+        }
+    }
+
+    static bench_result_t results[NCASES];
+    size_t count = 0;
+    bool ok = true;
+
+    printf("%-32s%14s%10s%10s%10s\n", "Case", "Accesses/s", "ns/acc",
+           "RSS(KB)", "Inst/acc");
+    for (size_t t = 0; t < NTRACES && ok; t++) {
+        for (size_t g = 0; g < NGEOMS && ok; g++) {
+            for (size_t p = 0; p < NPOLICIES && ok; p++) {
+                if (POLICIES[p].fully_associative && GEOMS[g].s != 0)
+                    continue;
+                bench_result_t *r = &results[count];
+                if (!run_case(&TRACES[t], &GEOMS[g], &POLICIES[p], r)) {
+                    ok = false;
+                    break;
+                }
+                count++;
+                printf("%-32s%14.0f%10.2f%10ld", r->name, r->accesses_per_sec,
+                       r->ns_per_access, r->peak_rss_kb);
+                if (r->instructions_per_access < 0)
+                    printf("%10s\n", "n/a");
+                else
+                    printf("%10.1f\n", r->instructions_per_access);
+                fflush(stdout);
+            }
+        }
+    }
+    cleanup();
+    if (!ok)
+        exit(1);
+
+    if (out_path != NULL && !write_json(out_path, results, count))
+        exit(1);
+
+    if (baseline_path == NULL)
+        exit(0);
+
+    FILE *fp = fopen(baseline_path, "r");
+    if (fp == NULL) {
+        if (errno != ENOENT) {
+            fprintf(stderr, "Error opening %s: %s\n", baseline_path,
+                    strerror(errno));
+            exit(1);
+        }
+        /* No stored baseline yet: record this run as the baseline */
+        printf("\nNo baseline found, writing %s\n", baseline_path);
+        exit(write_json(baseline_path, results, count) ? 0 : 1);
+    }
+
+    int regressions = compare_baseline(fp, results, count);
+    fclose(fp);
+    if (regressions > 0) {
+        printf("\n%d case(s) regressed by more than %.1f%%\n", regressions,
+               threshold);
+        exit(1);
+    }
+    printf("\nNo regressions beyond %.1f%%\n", threshold);
+    exit(0);
+}
@@ -0,0 +1,876 @@
+/**
+ * @file cache.c
+ * @brief Set-associative cache engine used by the cache simulator
+ *
+ * Every set owns E consecutive slots of the tag and metadata arrays. Ways
+ * are filled in order, so fill[set] bounds the tag scan and tells a cold
+ * set apart from a full one without walking any list. LRU order is kept
+ * as a per-line timestamp of the last use: a hit is a single store, and
+ * the victim of a miss in a full set is the line with the oldest stamp.
+ *
+ * With at most 16 ways, the order of a set also fits in one 64-bit word
+ * of 4-bit way numbers, most recently used first. A use moves its way to
+ * the front with a few shifts and masks, and the victim is the last
+ * nibble, so a miss reads one word instead of scanning E stamps spread
+ * over up to four host cache lines. The words are stored XORed with the
+ * identity permutation, so that a zeroed (calloc'd or sparse) word is a
+ * valid order. The stamps are still written, for lifetimes and way masks;
+ * with way masks the victim is picked by stamp and the words go unused.
+ *
+ * The arrays are allocated with calloc, so the pages of sets that the
+ * trace never touches are never backed by memory.
+ *
+ * With many sets, consecutive accesses land on unrelated sets and each one
+ * misses in the host's own caches. Sets never interact, so a batch may be
+ * simulated in any order that keeps the order of the accesses within each
+ * set: cache_access_batch() radix-partitions the batch by the high bits of
+ * the set index, keeping the order within each partition, and then runs
+ * one partition at a time over a slice of the arrays small enough to stay
+ * in the host's L1/L2. The LRU stamps still increase in the order of each
+ * set's accesses, and the statistics are plain sums, so the results are
+ * exactly those of simulating the batch in trace order.
+ *
+ * With way masks (see cache_set_way_masks()), a line may only be filled in
+ * the ways allowed to its owner, so the ways of a set no longer fill up in
+ * order: fill[set] then only counts the valid lines, the hit scan covers
+ * all E ways, and the victim is picked among the allowed ways by a
+ * branch-free scan that prefers empty ways and then the oldest stamp.
+ *
+ * A cache too big for memory can keep its arrays in a file instead (see
+ * cache_init_mapped()); spill.c then simulates it one range of sets at a
+ * time and hands each finished range back to the kernel.
+ *
+ * A fully associative cache may also run ARC, CLOCK-Pro or W-TinyLFU
+ * instead of LRU (see cache_set_policy()); cache_access() then hands every
+ * access to adaptive.c, which keeps its own state and leaves the arrays
+ * unused. Any cache may also run SHiP (see cache_set_ship()), which keeps
+ * the tag arrays but replaces the LRU stamps with its own line state in
+ * ship.c. Both kinds of policy share state across sets (ship.c its
+ * predictor), so their batches are always simulated in trace order.
+ *
+ * A flush or a non-temporal store invalidates the line of its block in
+ * place (see cache_flush_block()). Without way masks the way stays below
+ * fill[set], so the hit scan still checks the valid bits, and the invalid
+ * line is made the LRU victim of its set; a miss that picks it fills it
+ * without counting an eviction.
+ *
+ * Every line counts its hits in the padding of its metadata, which the
+ * hit path writes anyway. With lifetimes tracked (see
+ * cache_track_lifetimes()), a separate array also remembers when each
+ * line was filled; it is only touched on fills and evictions, and the
+ * histograms are only updated on evictions. Lifetimes are measured on the
+ * access clock, so their batches are kept in trace order too.
+ */
+
+#define _GNU_SOURCE
+
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "adaptive.h"
+#include "cache.h"
+#include "ship.h"
+
+/** @brief log2 of the number of partitions of cache_access_batch() */
+#define CACHE_PARTITION_BITS 8
+
+/** @brief Size of the tag and line state above which batches are sorted */
+#define CACHE_SORT_MIN_BYTES (1UL << 20)
+
+/** @brief Batches smaller than this are simulated in trace order */
+#define CACHE_SORT_MIN_BATCH 4096
+
+/** @brief Largest number of ways whose LRU order is packed in a word */
+#define CACHE_PACKED_WAYS 16
+
+/** @brief Packed order that puts way k at position k */
+#define ORDER_IDENTITY 0xfedcba9876543210ULL
+
+/** @brief 1 in every nibble of a word */
+#define NIBBLE_ONES 0x1111111111111111ULL
+
+/**
+ * @brief Fills in the geometry of an empty cache.
+ */
+static bool set_geometry(cache_t *cache, int s, int E, int b) {
+    memset(cache, 0, sizeof(*cache));
+    if (s < 0 || b < 0 || E <= 0 || s + b >= 64)
+        return false;
+
+    cache->s = s;
+    cache->E = E;
+    cache->b = b;
+    cache->num_sets = 1UL << s;
+    cache->set_mask = cache->num_sets - 1;
+    cache->block_bytes = 1UL << b;
+    return true;
+}
+
+/**
+ * @brief Rounds a size up to a whole number of pages.
+ */
+static size_t page_round(size_t bytes) {
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    return (bytes + page - 1) / page * page;
+}
+
+/**
+ * @brief Allocates an empty cache.
+ *
+ * @param[out] cache  The cache to initialize
+ * @param[in]  s      Number of set index bits
+ * @param[in]  E      Number of lines per set
+ * @param[in]  b      Number of block offset bits
+ *
+ * @return True if the cache was allocated, false otherwise
+ */
+bool cache_init(cache_t *cache, int s, int E, int b) {
+    if (!set_geometry(cache, s, E, b))
+        return false;
+
+    size_t lines = (size_t)cache->num_sets * (size_t)E;
+    cache->tags = calloc(lines, sizeof(*cache->tags));
+    cache->meta = calloc(lines, sizeof(*cache->meta));
+    cache->fill = calloc(cache->num_sets, sizeof(*cache->fill));
+    if (E <= CACHE_PACKED_WAYS)
+        cache->order = calloc(cache->num_sets, sizeof(*cache->order));
+    if (cache->tags == NULL || cache->meta == NULL || cache->fill == NULL ||
+        (E <= CACHE_PACKED_WAYS && cache->order == NULL)) {
+        cache_free(cache);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Allocates an empty cache whose arrays live in a file.
+ *
+ * The file is created (or truncated) at path, sized sparsely and mapped
+ * shared, then unlinked, so it goes away with the mapping. The kernel
+ * pages the arrays in and out as they are used; cache_release() tells it
+ * when a range of sets will not be needed again soon.
+ *
+ * @param[out] cache  The cache to initialize
+ * @param[in]  s      Number of set index bits
+ * @param[in]  E      Number of lines per set
+ * @param[in]  b      Number of block offset bits
+ * @param[in]  path   File to hold the arrays
+ *
+ * @return True if the cache was allocated, false with an error message
+ * printed otherwise
+ */
+bool cache_init_mapped(cache_t *cache, int s, int E, int b,
+                       const char *path) {
+    if (!set_geometry(cache, s, E, b))
+        return false;
+
+    size_t lines = (size_t)cache->num_sets * (size_t)E;
+    size_t tag_bytes = page_round(lines * sizeof(*cache->tags));
+    size_t meta_bytes = page_round(lines * sizeof(*cache->meta));
+    size_t fill_bytes =
+        page_round((size_t)cache->num_sets * sizeof(*cache->fill));
+    size_t order_bytes =
+        E <= CACHE_PACKED_WAYS
+            ? page_round((size_t)cache->num_sets * sizeof(*cache->order))
+            : 0;
+    size_t total = tag_bytes + meta_bytes + fill_bytes + order_bytes;
+
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0600);
+    if (fd < 0) {
+        perror(path);
+        return false;
+    }
+    void *map = MAP_FAILED;
+    if (ftruncate(fd, (off_t)total) == 0)
+        map = mmap(NULL, total, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED)
+        perror(path);
+    close(fd);
+    unlink(path);
+    if (map == MAP_FAILED)
+        return false;
+
+    cache->map = map;
+    cache->map_bytes = total;
+    cache->tags = map;
+    cache->meta = (cache_meta_t *)(void *)((char *)map + tag_bytes);
+    cache->fill = (unsigned int *)(void *)((char *)map + tag_bytes +
+                                           meta_bytes);
+    if (order_bytes != 0)
+        cache->order = (uint64_t *)(void *)((char *)map + tag_bytes +
+                                            meta_bytes + fill_bytes);
+    return true;
+}
+
+/**
+ * @brief Drops the pages of a range of sets from memory.
+ *
+ * Only caches from cache_init_mapped() are affected: their pages are
+ * scheduled for write-back and unmapped from the process, and are read
+ * back from the file if the sets are accessed again. Pages shared with
+ * sets outside the range are kept.
+ */
+void cache_release(cache_t *cache, unsigned long first_set,
+                   unsigned long num_sets) {
+    if (cache->map == NULL)
+        return;
+
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t E = (size_t)cache->E;
+    int num_ranges = 3;
+    char *ranges[4][2] = {
+        {(char *)(cache->tags + first_set * E),
+         (char *)(cache->tags + (first_set + num_sets) * E)},
+        {(char *)(cache->meta + first_set * E),
+         (char *)(cache->meta + (first_set + num_sets) * E)},
+        {(char *)(cache->fill + first_set),
+         (char *)(cache->fill + first_set + num_sets)},
+    };
+    if (cache->order != NULL) {
+        ranges[num_ranges][0] = (char *)(cache->order + first_set);
+        ranges[num_ranges][1] = (char *)(cache->order + first_set + num_sets);
+        num_ranges++;
+    }
+    for (int r = 0; r < num_ranges; r++) {
+        size_t lo = (size_t)(ranges[r][0] - (char *)cache->map);
+        size_t hi = (size_t)(ranges[r][1] - (char *)cache->map);
+        lo = (lo + page - 1) / page * page;
+        hi = hi / page * page;
+        if (lo < hi) {
+            msync((char *)cache->map + lo, hi - lo, MS_ASYNC);
+            madvise((char *)cache->map + lo, hi - lo, MADV_DONTNEED);
+        }
+    }
+}
+
+/**
+ * @brief Starts recording which owner filled each line.
+ *
+ * Every line filled from now on is tagged with cache->current, which the
+ * caller sets before each access (for example, to the trace the access
+ * comes from), and must be below CACHE_MAX_OWNERS. After a
+ * CACHE_MISS_EVICT, cache->victim holds the owner of the line that was
+ * evicted, and cache->occupancy counts the valid lines of each owner.
+ * Lines filled before the call belong to 0.
+ *
+ * @return True if the owner array was allocated, false otherwise
+ */
+bool cache_track_owners(cache_t *cache) {
+    size_t lines = (size_t)cache->num_sets * (size_t)cache->E;
+    if (cache->owner != NULL)
+        return true;
+    cache->owner = calloc(lines, sizeof(*cache->owner));
+    if (cache->owner == NULL)
+        return false;
+    memset(cache->occupancy, 0, sizeof(cache->occupancy));
+    for (unsigned long set = 0; set < cache->num_sets; set++)
+        cache->occupancy[0] += cache->fill[set];
+    return true;
+}
+
+/**
+ * @brief Restricts the ways that the lines of each owner may be filled in.
+ *
+ * Bit w of masks[o] allows owner o (cache->current at the time of the
+ * miss) to fill way w; hits are allowed in every way, as with Intel CAT.
+ * Owners are tracked as with cache_track_owners(), so cache->occupancy
+ * tells how many lines each owner holds. The masks are not copied.
+ *
+ * @param[in,out] cache  The cache, with LRU replacement and at most 64 ways
+ * @param[in]     masks  CACHE_MAX_OWNERS masks, each with some way of the
+ *                       cache allowed
+ *
+ * @return True on success, false if a mask allows no way or the owner
+ * array could not be allocated
+ */
+bool cache_set_way_masks(cache_t *cache, const unsigned long *masks) {
+    if (cache->E > 64 || cache->policy != CACHE_LRU)
+        return false;
+    unsigned long all = cache->E == 64 ? ~0UL : (1UL << cache->E) - 1;
+    for (int o = 0; o < CACHE_MAX_OWNERS; o++) {
+        if ((masks[o] & all) == 0)
+            return false;
+    }
+    if (!cache_track_owners(cache))
+        return false;
+    cache->way_masks = masks;
+    return true;
+}
+
+/**
+ * @brief Records the lifetime of every line evicted from now on.
+ *
+ * For every eviction, the histograms get the accesses since the line was
+ * filled, the accesses since it was last used, and its hits. Lines that
+ * are still resident at the end are not counted. The histograms are not
+ * copied; lines filled before the call count as filled at the time of the
+ * call.
+ *
+ * @param[in,out] cache      The cache, kept in memory and run by LRU or
+ *                           SHiP
+ * @param[out]    lifetimes  The histograms to add to, zeroed by the caller
+ *
+ * @return True on success, false if the cache does not fit or memory ran
+ * out
+ */
+bool cache_track_lifetimes(cache_t *cache, cache_lifetimes_t *lifetimes) {
+    size_t lines = (size_t)cache->num_sets * (size_t)cache->E;
+    if (cache->map != NULL || cache->adaptive != NULL)
+        return false;
+    if (cache->filled == NULL) {
+        cache->filled = malloc(lines * sizeof(*cache->filled));
+        if (cache->filled == NULL)
+            return false;
+    }
+    for (size_t i = 0; i < lines; i++)
+        cache->filled[i] = cache->clock;
+    cache->lifetimes = lifetimes;
+    return true;
+}
+
+/**
+ * @brief Returns the histogram bucket of a count: 0 for 0, k for
+ * [2**(k-1), 2**k).
+ */
+static unsigned int lifetime_bucket(unsigned long count) {
+    unsigned int bucket = 0;
+    while (count != 0) {
+        bucket++;
+        count >>= 1;
+    }
+    return bucket;
+}
+
+/**
+ * @brief Adds a line about to be evicted to the lifetime histograms.
+ *
+ * @param[in,out] cache  The cache, with lifetimes tracked
+ * @param[in]     line   Index of the line in the tag and metadata arrays
+ * @param[in]     now    The access clock at the eviction
+ */
+void cache_record_eviction(cache_t *cache, size_t line, unsigned long now) {
+    cache_lifetimes_t *lifetimes = cache->lifetimes;
+    unsigned long resident = now - cache->filled[line];
+    unsigned long idle = now - cache->meta[line].stamp;
+    unsigned long hits = cache->meta[line].hits;
+    lifetimes->resident[lifetime_bucket(resident)]++;
+    lifetimes->idle[lifetime_bucket(idle)]++;
+    lifetimes->hits[lifetime_bucket(hits)]++;
+    lifetimes->evictions++;
+    lifetimes->dead_on_arrival += hits == 0;
+    lifetimes->resident_time += resident;
+    lifetimes->dead_time += idle;
+}
+
+/**
+ * @brief Parses the name of a replacement policy.
+ *
+ * @param[in]  name    "lru", "arc", "clockpro", "tinylfu" or "ship"
+ * @param[out] policy  The policy named
+ *
+ * @return True if the name is known, false otherwise
+ */
+bool cache_policy_parse(const char *name, cache_policy_t *policy) {
+    if (strcmp(name, "lru") == 0)
+        *policy = CACHE_LRU;
+    else if (strcmp(name, "arc") == 0)
+        *policy = CACHE_ARC;
+    else if (strcmp(name, "clockpro") == 0)
+        *policy = CACHE_CLOCKPRO;
+    else if (strcmp(name, "tinylfu") == 0)
+        *policy = CACHE_TINYLFU;
+    else if (strcmp(name, "ship") == 0)
+        *policy = CACHE_SHIP;
+    else
+        return false;
+    return true;
+}
+
+/**
+ * @brief Switches an empty cache to another replacement policy.
+ *
+ * ARC, CLOCK-Pro and W-TinyLFU need a fully associative cache (s = 0)
+ * kept in memory, and cannot be combined with way masks or lifetimes;
+ * owners may still be tracked. CACHE_SHIP gets the default signatures of cache_set_ship(),
+ * without bypass.
+ *
+ * @return True on success, false if the policy does not fit the cache or
+ * its state could not be allocated
+ */
+bool cache_set_policy(cache_t *cache, cache_policy_t policy) {
+    if (policy == CACHE_SHIP) {
+        int bits = cache->b > SHIP_GRANULE_BITS ? cache->b : SHIP_GRANULE_BITS;
+        return cache_set_ship(cache, bits, false);
+    }
+    adaptive_t *state = NULL;
+    if (policy != CACHE_LRU) {
+        if (cache->s != 0 || cache->map != NULL || cache->way_masks != NULL ||
+            cache->lifetimes != NULL)
+            return false;
+        state = adaptive_new(policy, (unsigned long)cache->E);
+        if (state == NULL)
+            return false;
+    }
+    adaptive_delete(cache->adaptive);
+    ship_delete(cache->ship);
+    cache->adaptive = state;
+    cache->ship = NULL;
+    cache->policy = policy;
+    return true;
+}
+
+/**
+ * @brief Switches an empty cache to SHiP.
+ *
+ * SHiP needs a cache kept in memory and cannot be combined with way masks;
+ * owners may still be tracked.
+ *
+ * @param[in,out] cache         The cache
+ * @param[in]     granule_bits  log2 of the bytes of the address regions
+ *                              that share a signature, at least b
+ * @param[in]     bypass        Whether blocks predicted dead bypass the
+ *                              cache instead of being inserted
+ *
+ * @return True on success, false if SHiP does not fit the cache or its
+ * state could not be allocated
+ */
+bool cache_set_ship(cache_t *cache, int granule_bits, bool bypass) {
+    if (cache->map != NULL || cache->way_masks != NULL)
+        return false;
+    ship_t *state = ship_new(cache, granule_bits, bypass);
+    if (state == NULL)
+        return false;
+    adaptive_delete(cache->adaptive);
+    ship_delete(cache->ship);
+    cache->adaptive = NULL;
+    cache->ship = state;
+    cache->policy = CACHE_SHIP;
+    return true;
+}
+
+/**
+ * @brief Releases the memory held by a cache.
+ */
+void cache_free(cache_t *cache) {
+    if (cache->map != NULL) {
+        munmap(cache->map, cache->map_bytes);
+    } else {
+        free(cache->tags);
+        free(cache->meta);
+        free(cache->fill);
+        free(cache->order);
+    }
+    cache->map = NULL;
+    cache->map_bytes = 0;
+    free(cache->sorted);
+    free(cache->owner);
+    free(cache->filled);
+    cache->tags = NULL;
+    cache->meta = NULL;
+    cache->fill = NULL;
+    cache->order = NULL;
+    cache->sorted = NULL;
+    cache->sorted_size = 0;
+    cache->owner = NULL;
+    cache->filled = NULL;
+    cache->lifetimes = NULL;
+    adaptive_delete(cache->adaptive);
+    ship_delete(cache->ship);
+    cache->adaptive = NULL;
+    cache->ship = NULL;
+}
+
+/**
+ * @brief Empties a cache, as if it had just been allocated.
+ *
+ * The statistics are kept, except that the dropped dirty lines no longer
+ * count as dirty bytes in the cache. Dropping a line is not an eviction.
+ */
+void cache_flush(cache_t *cache) {
+    size_t lines = (size_t)cache->num_sets * (size_t)cache->E;
+    memset(cache->tags, 0, lines * sizeof(*cache->tags));
+    memset(cache->meta, 0, lines * sizeof(*cache->meta));
+    memset(cache->fill, 0, cache->num_sets * sizeof(*cache->fill));
+    if (cache->order != NULL)
+        memset(cache->order, 0, cache->num_sets * sizeof(*cache->order));
+    if (cache->owner != NULL)
+        memset(cache->owner, 0, lines * sizeof(*cache->owner));
+    memset(cache->occupancy, 0, sizeof(cache->occupancy));
+    if (cache->adaptive != NULL)
+        adaptive_reset(cache->adaptive);
+    if (cache->ship != NULL)
+        ship_reset(cache->ship);
+    cache->stats.dirty_bytes = 0;
+}
+
+/**
+ * @brief Finds the least recently used way of a full set.
+ */
+static unsigned int lru_victim(const cache_meta_t *meta, unsigned int ways) {
+    unsigned int victim = 0;
+    unsigned long oldest = ULONG_MAX;
+    for (unsigned int w = 0; w < ways; w++) {
+        if (meta[w].stamp < oldest) {
+            oldest = meta[w].stamp;
+            victim = w;
+        }
+    }
+    return victim;
+}
+
+/**
+ * @brief Finds the way to fill among the ways allowed by a mask.
+ *
+ * Empty ways have a stamp of 0 and win over every used way; ways outside
+ * the mask get a key of ULONG_MAX and never win over an allowed one.
+ */
+static unsigned int masked_victim(const cache_meta_t *meta, unsigned int ways,
+                                  unsigned long mask) {
+    unsigned int victim = 0;
+    unsigned long oldest = ULONG_MAX;
+    for (unsigned int w = 0; w < ways; w++) {
+        unsigned long key = meta[w].stamp | (((mask >> w) & 1) - 1);
+        bool older = key < oldest;
+        oldest = older ? key : oldest;
+        victim = older ? w : victim;
+    }
+    return victim;
+}
+
+/**
+ * @brief Finds the position of a way in the packed order of a set.
+ *
+ * Every nibble equal to the way becomes 0 after the XOR; the usual SWAR
+ * test flags the lowest zero nibble exactly (a borrow only ever flags
+ * nibbles above a real zero), and the multiplication turns its bit into
+ * the nibble number. The nibbles past E keep their identity values, which
+ * are at least E and never match.
+ */
+static unsigned int order_find(uint64_t order, unsigned int way) {
+    uint64_t x = order ^ (NIBBLE_ONES * way);
+    uint64_t zero = (x - NIBBLE_ONES) & ~x & (NIBBLE_ONES << 3);
+    return (unsigned int)((((zero & -zero) >> 3) * 0x0123456789abcdefULL) >>
+                          60);
+}
+
+/**
+ * @brief Moves the way at a position of a packed order to the front.
+ */
+static uint64_t order_touch(uint64_t order, unsigned int pos,
+                            unsigned int way) {
+    uint64_t front = (2ULL << (4 * pos + 3)) - 1;
+    return (order & ~front) | ((order << 4) & front) | way;
+}
+
+/**
+ * @brief Moves the way at a position of a packed order to a later
+ * position, shifting the ways in between one position forward.
+ */
+static uint64_t order_demote(uint64_t order, unsigned int pos,
+                             unsigned int last, unsigned int way) {
+    uint64_t before = (1ULL << (4 * pos)) - 1;
+    uint64_t before_last = (1ULL << (4 * last)) - 1;
+    uint64_t through_last = (2ULL << (4 * last + 3)) - 1;
+    return (order & before) | ((order >> 4) & before_last & ~before) |
+           (uint64_t)way << (4 * last) | (order & ~through_last);
+}
+
+/**
+ * @brief Simulates one load or store.
+ *
+ * @param[in,out] cache  The cache to access
+ * @param[in]     addr   The address accessed
+ * @param[in]     store  True for a store, false for a load
+ *
+ * @return What the access did to the cache
+ */
+cache_result_t cache_access(cache_t *cache, unsigned long addr, bool store) {
+    if (cache->adaptive != NULL)
+        return adaptive_access(cache, addr, store);
+    if (cache->ship != NULL)
+        return ship_access(cache, addr, store);
+
+    unsigned long tag = addr >> (cache->s + cache->b);
+    unsigned long set = (addr >> cache->b) & cache->set_mask;
+    size_t base = (size_t)set * (size_t)cache->E;
+    unsigned long *tags = cache->tags + base;
+    cache_meta_t *meta = cache->meta + base;
+    unsigned int fill = cache->fill[set];
+    unsigned long now = ++cache->clock;
+    unsigned int scan =
+        cache->way_masks == NULL ? fill : (unsigned int)cache->E;
+    uint64_t *order = cache->order != NULL && cache->way_masks == NULL
+                          ? cache->order + set
+                          : NULL;
+
+    for (unsigned int w = 0; w < scan; w++) {
+        if (tags[w] == tag && meta[w].valid) {
+            cache->stats.hits++;
+            if (store && !meta[w].dirty) {
+                meta[w].dirty = true;
+                cache->stats.dirty_bytes += cache->block_bytes;
+            }
+            meta[w].stamp = now;
+            meta[w].hits++;
+            if (order != NULL) {
+                uint64_t word = *order ^ ORDER_IDENTITY;
+                *order = order_touch(word, order_find(word, w), w) ^
+                         ORDER_IDENTITY;
+            }
+            return CACHE_HIT;
+        }
+    }
+
+    cache->stats.misses++;
+    cache_result_t result;
+    unsigned int way;
+    if (cache->way_masks != NULL) {
+        way = masked_victim(meta, (unsigned int)cache->E,
+                            cache->way_masks[cache->current]);
+        result = fill == 0 ? CACHE_COLD_MISS : CACHE_MISS;
+        if (meta[way].valid) {
+            result = CACHE_MISS_EVICT;
+            if (cache->lifetimes != NULL)
+                cache_record_eviction(cache, base + way, now);
+            cache->stats.evictions++;
+            cache->evicted_addr = (tags[way] << cache->s | set) << cache->b;
+            cache->evicted_dirty = meta[way].dirty;
+            if (meta[way].dirty) {
+                cache->stats.dirty_evictions += cache->block_bytes;
+                cache->stats.dirty_bytes -= cache->block_bytes;
+            }
+        } else {
+            cache->fill[set] = fill + 1;
+        }
+    } else if (fill < (unsigned int)cache->E) {
+        way = fill;
+        cache->fill[set] = fill + 1;
+        result = fill == 0 ? CACHE_COLD_MISS : CACHE_MISS;
+        if (order != NULL) {
+            uint64_t word = *order ^ ORDER_IDENTITY;
+            *order = order_touch(word, order_find(word, way), way) ^
+                     ORDER_IDENTITY;
+        }
+    } else {
+        if (order != NULL) {
+            uint64_t word = *order ^ ORDER_IDENTITY;
+            way = (unsigned int)(word >> (4 * fill - 4)) & 0xf;
+            *order = order_touch(word, fill - 1, way) ^ ORDER_IDENTITY;
+        } else {
+            way = lru_victim(meta, fill);
+        }
+        result = CACHE_MISS;
+        if (meta[way].valid) {
+            if (cache->lifetimes != NULL)
+                cache_record_eviction(cache, base + way, now);
+            cache->stats.evictions++;
+            cache->evicted_addr = (tags[way] << cache->s | set) << cache->b;
+            cache->evicted_dirty = meta[way].dirty;
+            if (meta[way].dirty) {
+                cache->stats.dirty_evictions += cache->block_bytes;
+                cache->stats.dirty_bytes -= cache->block_bytes;
+            }
+            result = CACHE_MISS_EVICT;
+        }
+    }
+
+    if (cache->owner != NULL) {
+        unsigned short *owner = cache->owner + base + way;
+        cache->victim = *owner;
+        if (result == CACHE_MISS_EVICT)
+            cache->occupancy[*owner]--;
+        cache->occupancy[cache->current]++;
+        *owner = cache->current;
+    }
+    tags[way] = tag;
+    meta[way].stamp = now;
+    meta[way].hits = 0;
+    meta[way].valid = true;
+    if (cache->filled != NULL)
+        cache->filled[base + way] = now;
+    meta[way].dirty = store;
+    if (store)
+        cache->stats.dirty_bytes += cache->block_bytes;
+    return result;
+}
+
+/**
+ * @brief Simulates a load and then a store of the same block, as for a
+ * read-modify-write instruction.
+ *
+ * Both accesses count in the statistics, as a load and a store would.
+ *
+ * @return What the load did to the cache
+ */
+cache_result_t cache_modify(cache_t *cache, unsigned long addr) {
+    cache_result_t result = cache_access(cache, addr, false);
+    cache_access(cache, addr, true);
+    cache->ops.modifies++;
+    cache->ops.modify_hits += result == CACHE_HIT;
+    return result;
+}
+
+/**
+ * @brief Simulates a software prefetch: the block is filled, or its line
+ * used, as by a load, but no hit or miss is counted. An eviction it causes
+ * still counts.
+ *
+ * @return What the prefetch did to the cache
+ */
+cache_result_t cache_prefetch(cache_t *cache, unsigned long addr) {
+    unsigned long hits = cache->stats.hits;
+    unsigned long misses = cache->stats.misses;
+    cache_result_t result = cache_access(cache, addr, false);
+    cache->stats.hits = hits;
+    cache->stats.misses = misses;
+    cache->ops.prefetches++;
+    cache->ops.prefetch_misses += result != CACHE_HIT;
+    return result;
+}
+
+/**
+ * @brief Drops the line holding a block, if any, without counting an
+ * eviction.
+ *
+ * The line becomes invalid and the first victim of its set: an LRU set
+ * gives it the stamp of an empty way and moves it to the LRU end of its
+ * packed order, a way-masked set stops counting it in fill[set], and SHiP
+ * and the fully associative policies drop it in their own state. A set
+ * without way masks keeps counting it in fill[set], so the ways below
+ * fill[set] may now hold invalid lines.
+ *
+ * @return True if the block was cached; evicted_addr and evicted_dirty
+ * then describe it, and its dirty bytes no longer count as in the cache
+ */
+static bool invalidate(cache_t *cache, unsigned long addr) {
+    bool dirty;
+    if (cache->adaptive != NULL) {
+        if (!adaptive_invalidate(cache, addr, &dirty))
+            return false;
+    } else {
+        unsigned long tag = addr >> (cache->s + cache->b);
+        unsigned long set = (addr >> cache->b) & cache->set_mask;
+        size_t base = (size_t)set * (size_t)cache->E;
+        cache_meta_t *meta = cache->meta + base;
+        unsigned int fill = cache->fill[set];
+        unsigned int scan =
+            cache->way_masks == NULL ? fill : (unsigned int)cache->E;
+        unsigned int w = 0;
+        while (w < scan && !(cache->tags[base + w] == tag && meta[w].valid))
+            w++;
+        if (w == scan)
+            return false;
+
+        dirty = meta[w].dirty;
+        meta[w].stamp = 0;
+        meta[w].valid = false;
+        meta[w].dirty = false;
+        if (cache->owner != NULL)
+            cache->occupancy[cache->owner[base + w]]--;
+        if (cache->ship != NULL)
+            ship_invalidate(cache->ship, base + w);
+        if (cache->way_masks != NULL) {
+            cache->fill[set] = fill - 1;
+        } else if (cache->order != NULL) {
+            uint64_t word = cache->order[set] ^ ORDER_IDENTITY;
+            cache->order[set] =
+                order_demote(word, order_find(word, w), fill - 1, w) ^
+                ORDER_IDENTITY;
+        }
+    }
+    if (dirty)
+        cache->stats.dirty_bytes -= cache->block_bytes;
+    cache->evicted_addr = addr >> cache->b << cache->b;
+    cache->evicted_dirty = dirty;
+    return true;
+}
+
+/**
+ * @brief Writes back and invalidates the line holding a block, if any, as
+ * clflush does. Neither a hit, a miss nor an eviction is counted.
+ *
+ * @return CACHE_HIT if the block was cached, with evicted_dirty telling
+ * whether it was written back, and CACHE_MISS otherwise
+ */
+cache_result_t cache_flush_block(cache_t *cache, unsigned long addr) {
+    cache->ops.flushes++;
+    if (!invalidate(cache, addr))
+        return CACHE_MISS;
+    cache->ops.flush_hits++;
+    if (cache->evicted_dirty)
+        cache->ops.flush_writebacks += cache->block_bytes;
+    return CACHE_HIT;
+}
+
+/**
+ * @brief Simulates a non-temporal store, which writes memory without
+ * allocating a line. A cached copy of the block is invalidated, its dirty
+ * bytes merged into the store. Neither a hit, a miss nor an eviction is
+ * counted.
+ *
+ * @return CACHE_HIT if a copy was invalidated, CACHE_MISS otherwise
+ */
+cache_result_t cache_nt_store(cache_t *cache, unsigned long addr) {
+    cache->ops.nt_stores++;
+    if (!invalidate(cache, addr))
+        return CACHE_MISS;
+    cache->ops.nt_invalidations++;
+    return CACHE_HIT;
+}
+
+/**
+ * @brief Simulates a batch of loads and stores.
+ *
+ * Large caches get the batch grouped by set first (see the top of this
+ * file); the statistics are the same as those of calling cache_access()
+ * on each request in order, but the per-access results are not reported.
+ *
+ * @param[in,out] cache     The cache to access
+ * @param[in]     requests  The batch, in trace order
+ * @param[in]     count     Number of requests in the batch
+ */
+void cache_access_batch(cache_t *cache, const cache_request_t *requests,
+                        size_t count) {
+    size_t state = (size_t)cache->num_sets * (size_t)cache->E *
+                   (sizeof(*cache->tags) + sizeof(*cache->meta));
+    if (state >= CACHE_SORT_MIN_BYTES && count >= CACHE_SORT_MIN_BATCH &&
+        count > cache->sorted_size) {
+        cache_request_t *grown =
+            realloc(cache->sorted, count * sizeof(*cache->sorted));
+        if (grown != NULL) {
+            cache->sorted = grown;
+            cache->sorted_size = count;
+        }
+    }
+    if (state < CACHE_SORT_MIN_BYTES || count < CACHE_SORT_MIN_BATCH ||
+        count > cache->sorted_size || cache->policy != CACHE_LRU ||
+        cache->lifetimes != NULL) {
+        for (size_t i = 0; i < count; i++)
+            cache_access(cache, requests[i].addr, requests[i].store);
+        return;
+    }
+
+    /* Partition by the top bits of the set index, keeping the order */
+    int shift = cache->s > CACHE_PARTITION_BITS
+                    ? cache->s - CACHE_PARTITION_BITS
+                    : 0;
+    size_t start[(1 << CACHE_PARTITION_BITS) + 1] = {0};
+    for (size_t i = 0; i < count; i++) {
+        unsigned long set = (requests[i].addr >> cache->b) & cache->set_mask;
+        start[(set >> shift) + 1]++;
+    }
+    for (size_t p = 0; p < (1 << CACHE_PARTITION_BITS); p++)
+        start[p + 1] += start[p];
+    for (size_t i = 0; i < count; i++) {
+        unsigned long set = (requests[i].addr >> cache->b) & cache->set_mask;
+        cache->sorted[start[set >> shift]++] = requests[i];
+    }
+
+    for (size_t i = 0; i < count; i++)
+        cache_access(cache, cache->sorted[i].addr, cache->sorted[i].store);
+}
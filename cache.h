@@ -0,0 +1,195 @@
+/**
+ * @file cache.h
+ * @brief Set-associative cache engine used by the cache simulator
+ *
+ * The cache state is kept in flat arrays rather than per-line heap nodes:
+ * the tags of a set are contiguous, so a lookup is a linear scan over a
+ * few words, and the replacement state lives in a parallel array that is
+ * only touched once the way is known.
+ */
+
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "cachelab.h"
+
+/**
+ * @brief Outcome of a single cache access
+ */
+typedef enum {
+    CACHE_HIT,        /* tag found in the set */
+    CACHE_COLD_MISS,  /* miss in a set that held no lines yet */
+    CACHE_MISS,       /* miss that filled an empty way */
+    CACHE_MISS_EVICT, /* miss that evicted the least recently used line */
+} cache_result_t;
+
+/**
+ * @brief Replacement policies
+ */
+typedef enum {
+    CACHE_LRU,      /* least recently used, per set */
+    CACHE_ARC,      /* adaptive replacement cache, fully associative */
+    CACHE_CLOCKPRO, /* CLOCK-Pro, fully associative */
+    CACHE_TINYLFU,  /* W-TinyLFU, fully associative */
+    CACHE_SHIP,     /* SHiP: RRIP with signature-based insertion */
+} cache_policy_t;
+
+/** @brief State of the fully associative policies (see adaptive.h) */
+typedef struct adaptive adaptive_t;
+
+/** @brief State of SHiP (see ship.h) */
+typedef struct ship ship_t;
+
+/**
+ * @brief Replacement state of one cache line
+ */
+typedef struct {
+    unsigned long stamp; /* value of the access clock at the last use */
+    unsigned int hits;   /* hits since the block was filled */
+    bool valid;          /* line holds a block */
+    bool dirty;          /* block was stored to since it was filled */
+} cache_meta_t;
+
+/** @brief Buckets of a lifetime histogram: 0, then [2**(k-1), 2**k) */
+#define CACHE_LIFETIME_BUCKETS 65
+
+/**
+ * @brief Histograms of the lines evicted from a cache, times in accesses
+ * to the cache
+ */
+typedef struct {
+    unsigned long resident[CACHE_LIFETIME_BUCKETS]; /* fill to eviction */
+    unsigned long idle[CACHE_LIFETIME_BUCKETS];     /* last use to eviction */
+    unsigned long hits[CACHE_LIFETIME_BUCKETS];     /* hits while resident */
+    unsigned long evictions;       /* lines evicted */
+    unsigned long dead_on_arrival; /* lines evicted without a hit */
+    unsigned long resident_time;   /* sum of the resident times */
+    unsigned long dead_time;       /* sum of the idle times */
+} cache_lifetimes_t;
+
+/**
+ * @brief Counts of the operations other than plain loads and stores
+ */
+typedef struct {
+    unsigned long modifies;         /* loads followed by a store */
+    unsigned long modify_hits;      /* of which the load hit */
+    unsigned long prefetches;       /* software prefetches */
+    unsigned long prefetch_misses;  /* of which the block was not cached */
+    unsigned long flushes;          /* write-back-and-invalidates */
+    unsigned long flush_hits;       /* of which found the block cached */
+    unsigned long flush_writebacks; /* bytes written back by flushes */
+    unsigned long nt_stores;        /* non-temporal stores */
+    unsigned long nt_invalidations; /* of which dropped a cached copy */
+} cache_op_stats_t;
+
+/** @brief Number of owners (or classes) whose lines are counted */
+#define CACHE_MAX_OWNERS 64
+
+/**
+ * @brief One load or store of a batch
+ */
+typedef struct {
+    unsigned long addr; /* address accessed */
+    bool store;         /* true for a store, false for a load */
+} cache_request_t;
+
+/**
+ * @brief State of a simulated cache
+ */
+typedef struct {
+    int s;                     /* number of set index bits */
+    int E;                     /* number of lines per set */
+    int b;                     /* number of block offset bits */
+    unsigned long num_sets;    /* 2**s */
+    unsigned long set_mask;    /* num_sets - 1 */
+    unsigned long block_bytes; /* 2**b */
+    unsigned long *tags;       /* num_sets * E tags, set after set */
+    cache_meta_t *meta;        /* line state, same layout as tags */
+    unsigned int *fill;        /* ways ever filled in each set */
+    uint64_t *order;           /* LRU order of each set if E <= 16, or
+                                  NULL (see cache.c) */
+    unsigned long clock;       /* number of accesses so far */
+    csim_stats_t stats;        /* statistics of the simulation so far */
+    cache_op_stats_t ops;      /* counts of the other operations */
+    cache_request_t *sorted;   /* scratch batch of cache_access_batch() */
+    size_t sorted_size;        /* room in sorted, in requests */
+    void *map;                 /* file mapping holding the arrays, or NULL */
+    size_t map_bytes;          /* size of the mapping */
+    unsigned short *owner;     /* owner of each line, or NULL if untracked */
+    unsigned short current;    /* owner given to the lines filled now */
+    unsigned short victim;     /* owner of the line last evicted */
+    unsigned long evicted_addr; /* address of the block last evicted */
+    bool evicted_dirty;        /* whether that block was dirty */
+    unsigned long occupancy[CACHE_MAX_OWNERS]; /* valid lines per owner */
+    const unsigned long *way_masks; /* ways each owner may fill, or NULL */
+    cache_policy_t policy;     /* replacement policy */
+    adaptive_t *adaptive;      /* state of ARC, CLOCK-Pro or W-TinyLFU, or
+                                  NULL */
+    ship_t *ship;              /* state of SHiP, or NULL */
+    unsigned long *filled;     /* access clock at the fill of each line, if
+                                  lifetimes are tracked */
+    cache_lifetimes_t *lifetimes; /* histograms of evicted lines, or NULL */
+} cache_t;
+
+/** @brief Allocates an empty cache with 2**s sets of E lines of 2**b bytes */
+bool cache_init(cache_t *cache, int s, int E, int b);
+
+/** @brief Allocates an empty cache whose arrays live in a mapped file */
+bool cache_init_mapped(cache_t *cache, int s, int E, int b,
+                       const char *path);
+
+/** @brief Drops the pages of a range of sets of a mapped cache from memory */
+void cache_release(cache_t *cache, unsigned long first_set,
+                   unsigned long num_sets);
+
+/** @brief Starts recording which owner filled each line */
+bool cache_track_owners(cache_t *cache);
+
+/** @brief Restricts the ways that the lines of each owner may be filled in */
+bool cache_set_way_masks(cache_t *cache, const unsigned long *masks);
+
+/** @brief Records the lifetime of every line evicted from now on */
+bool cache_track_lifetimes(cache_t *cache, cache_lifetimes_t *lifetimes);
+
+/** @brief Adds a line about to be evicted to the lifetime histograms */
+void cache_record_eviction(cache_t *cache, size_t line, unsigned long now);
+
+/** @brief Parses the name of a replacement policy */
+bool cache_policy_parse(const char *name, cache_policy_t *policy);
+
+/** @brief Switches an empty cache to another replacement policy */
+bool cache_set_policy(cache_t *cache, cache_policy_t policy);
+
+/** @brief Switches an empty cache to SHiP with the given signatures */
+bool cache_set_ship(cache_t *cache, int granule_bits, bool bypass);
+
+/** @brief Releases the memory held by a cache */
+void cache_free(cache_t *cache);
+
+/** @brief Empties a cache without counting evictions */
+void cache_flush(cache_t *cache);
+
+/** @brief Simulates one load or store and updates the statistics */
+cache_result_t cache_access(cache_t *cache, unsigned long addr, bool store);
+
+/** @brief Simulates a load and then a store of the same block */
+cache_result_t cache_modify(cache_t *cache, unsigned long addr);
+
+/** @brief Fills a block without counting a hit or a miss */
+cache_result_t cache_prefetch(cache_t *cache, unsigned long addr);
+
+/** @brief Writes back and invalidates the line holding a block, if any */
+cache_result_t cache_flush_block(cache_t *cache, unsigned long addr);
+
+/** @brief Simulates a store that bypasses the cache */
+cache_result_t cache_nt_store(cache_t *cache, unsigned long addr);
+
+/** @brief Simulates a batch of loads and stores, grouped by set if large */
+void cache_access_batch(cache_t *cache, const cache_request_t *requests,
+                        size_t count);
+
+#endif /* CACHE_H */
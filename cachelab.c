@@ -48,10 +48,28 @@ void printSummary(const csim_stats_t *stats) {
  * @return True if the operation was successful, false otherwise
  */
 bool loadSummary(csim_stats_t *stats) {
+    return loadSummaryAt(".", stats);
+}
+
+/**
+ * @brief Load the summary stored by a simulation run in another directory.
+ *
+ * Lets a caller that runs several simulators concurrently, each in its own
+ * working directory, collect their results without sharing one file.
+ *
+ * @param[in]  dir   The working directory of the simulation run
+ * @param[out] stats The simulation statistics that were read
+ *
+ * @return True if the operation was successful, false otherwise
+ */
+bool loadSummaryAt(const char *dir, csim_stats_t *stats) {
+    char path[FILENAME_MAX];
+    snprintf(path, sizeof(path), "%s/.csim_results", dir);
+
     /* Get the results from the simulator */
-    FILE *fp = fopen(".csim_results", "r");
+    FILE *fp = fopen(path, "r");
     if (fp == NULL) {
-        fprintf(stderr, "Failed to open .csim_results: %s\n", strerror(errno));
+        fprintf(stderr, "Failed to open %s: %s\n", path, strerror(errno));
         return false;
     }
 
@@ -28,6 +28,9 @@ void printSummary(const csim_stats_t *stats);
 /* @brief Load the stored summary of the cache simulation statistics. */
 bool loadSummary(csim_stats_t *stats);
 
+/* @brief Load the summary stored by a simulation run in another directory. */
+bool loadSummaryAt(const char *dir, csim_stats_t *stats);
+
 /* Grading parameters for transpose */
 
 /** @brief Number of clock cycles for hit */
@@ -100,4 +103,43 @@ void registerTransFunction(void (*trans)(size_t M, size_t N, double[N][M],
                                          double[M][N], double *),
                            const char *desc);
 
+/*
+ * Accessors for A, B and tmp in transpose functions. They compile to plain
+ * loads and stores, unless trans.c is built with -DCACHELAB_TRACE_SRC for
+ * tracegen-src: then every access is also recorded by the source-level
+ * tracing runtime in ct-src.c, in place of the CT instrumentation pass.
+ */
+#ifdef CACHELAB_TRACE_SRC
+#include <stdint.h>
+
+/* Defined in ct-src.c */
+extern uint64_t *__ctSrcPos;
+extern uint64_t *__ctSrcEnd;
+extern void __ctSrcFlush(void);
+
+/** @brief Appends one 8-byte access to the trace buffer, in CT encoding */
+static inline void __ctSrcRecord(const void *addr, uint64_t isWrite) {
+    if (__ctSrcPos == __ctSrcEnd)
+        __ctSrcFlush();
+    *__ctSrcPos++ = ((uint64_t)(uintptr_t)addr & 0x3ffffffffffffULL) |
+                    isWrite << 58 | 3ULL << 59;
+}
+
+static inline double __ctSrcLoad(const double *addr) {
+    __ctSrcRecord(addr, 0);
+    return *addr;
+}
+
+static inline void __ctSrcStore(double *addr, double value) {
+    __ctSrcRecord(addr, 1);
+    *addr = value;
+}
+
+#define TRANS_LD(x) __ctSrcLoad(&(x))
+#define TRANS_ST(x, v) __ctSrcStore(&(x), (v))
+#else
+#define TRANS_LD(x) (x)
+#define TRANS_ST(x, v) ((x) = (v))
+#endif
+
 #endif /* CACHELAB_TOOLS_H */
@@ -1,449 +1,1460 @@
-/**
- * This C file is a cache simulator that takes user arguments and simulates the operation of a cache. 
- * In order to use this simulator, four inputs are needed from the user, and they are "s," "E," "b," and "t."
- * s should be a nonnegative integer that represents the set bit of the cache. In other words, the cache will have 2**s sets. 
- * E should be a positive integer which represents how many cache lines are in a single set. 
- * b should be a nonnegative integer that represents the block offset. 
- * t should be a string that represents the directory of the input trace file. 
- * An example command line input is: ./csim -s 4 -E 10 -b 0 -t mytrace.trace.
- * Note that -s, -E, -b, -t can be in any order.
- * There are also two optional command, -h and -v. The first one will provide a usage insturction, and the second one will enable the verbose mode.  
- * 
- * This cache simulator was implemented based on an array of doubly-linked lists. 
- * Each node of the list has four fields, its next node, its previous node, its tag, and its dirty bits. 
- * It is able to tell that each node can represent a cache line, and the whole doubly linked list can represent a cache set. 
- * The doubly linked list has two fields, the head node, and the tail node. 
- * In order to avoid the edge case, the head and the tail node are just placeholders with no meaningful data inside. 
- * The node between the head and the tail nodes are meaningful nodes with tags and dirty bits. 
- * 
- * This cache simulator uses the eviction strategy of LRU, 
- * which means when a cache set is full, and eviction is required, the Least Recently Used cache line will be evicted. 
- * In order to achieve this implementation, two Doubly Linked list methods are used, addLast and deleteNode.
- * The most recently used cache line will be located right before the tail node, and the least recently used cache line will be located right after the head node. 
- * After reading a line from the trace file, the program will check if this line is a valid input. 
- * If so, the program will find the correct index of the Doubly-LinkedList array and check the size of this list. 
- * Here, there are three options, a cold miss, and a capacity miss and a cache hit.
- * 
- * Cold miss:
- * If there is currently no other node between the head and the tail, a cold miss happens, 
- * and a new node will be added in front of the tail node to indicate that this cache is the most recently used.
- * The tag of the cache line will be calculated, and the dirty bit will be set according to the operation type (Load or Store)
- * 
- * Capacity miss:
- * If there are nodes between the head and the tail, 
- * then the program will loop through all these nodes and check if the tag of one of these nodes matches the current tag. 
- * If there is no match, a capacity miss happens.
- * There are two decisions here:
- *   1.  If the current number of the node is smaller than the input E, no eviction happens. 
- *       A new node will be created, and its tag and the dirty bit will be adjusted 
- *       and finally inserted at the end of the Doubly Linked List right before the tail node indicates that it is the most recently used. 
- * 
- *   2.  If the current number of the node is equal to the input E, then eviction should take place.
- *       The Least Recently Used cache line will be located at the front of the Doubly LinkedList right after the head node.  
- *       This node will be deleted, and its memory will be freed, indicates a eviction happened. 
- *       Then a new node will be created, and its tag and the dirty bit will be adjusted 
- *       and finally inserted at the end of the Doubly Linked List right before the tail node indicates that it is the most recently used.
- * 
- * Cache Hit:
- * If there are nodes between the head and the tail,
- * then the program will loop through all these nodes and check if the tag of one of these nodes matches the current tag.
- * If there is a match, a cache hit happens.
- * Then this node will be deleted first and then reinserted at the end of the Doubly LinkedList right before the tail node,
- * indicating that it is the most recently used. 
- * 
- * The reason why a doubly linked list is used is that it can efficiently retrieve the Least Recently Used cache line and update the most recently used cache line. 
- * From the end to the front of the list, the usage time of the cache lines decreases, and the Least Recently Used cache line will always be right after the head node. 
- * The decision to use the head and tail node as placeholder can perfectly avoid some edge cases such as Nullptr and an empty list. 
-*/
-
-#include "cachelab.h"
-#include <stdio.h>
-#include <stdlib.h>
-#include <math.h>
-#include <getopt.h>
-#include <string.h>
-#include <unistd.h>
-#include <errno.h>
-
-#define FILENAMELENGTH 100
-#define LINELENGTH 64
-/**
- * This is the node structure. Each node has four fields, the reference of its next node, the reference of its previous node, the tag number, and the dirty bit. 
- * The node structure will form the Doubly Linked List, and the position inside the list indicates the usage time. 
-*/
-typedef struct DLLNode {
-    struct DLLNode* next;
-    struct DLLNode* prev;
-    unsigned long tag;
-    unsigned int dirty;
-} Node;
-/**
- * This is the DoublyLinkedList structure. It has two fields, the head reference, and the tail reference. 
- * The head and tail nodes are just placeholders that have no meaningful data inside.
- * An array of this structure will be used to simulate the cache operation. 
-*/
-typedef struct DoublyLinkedList {
-    Node* head;
-    Node* tail;
-} DLL;
-
-void getArguments(int argc, char ** argv);
-void printMessage(void);
-int mainProcess(char *afile);
-int initializeCache(unsigned long setNum);
-void addLast(unsigned long index, Node* n);
-void deleteNode(Node* n);
-int cacheOperation(char op, unsigned long address, unsigned long block);
-
-/**
- * Indicates if the user gives invalid command line argument. 1 if argument is invalid. 
-*/
-int quit = 0;
-/**
- * 
-*/
-int verbose;
-/**
- * Indicates the user input set bit and used for cache simulation. 
-*/
-int setBit = -1;
-/**
- * Indicates the user input block bit and used for cache simulation. 
-*/
-int blockBit = -1;
-/**
- * Indicates the user input cache line per set and used for cache simulation. 
-*/
-int linesPerSet = -1;
-/**
- * Indicates the user input trace file name and used for getting operation inputs.
-*/
-char fileName[FILENAMELENGTH] = "";
-/**
- * The array of Doubly Linked List. Each index contains a Doubly Linked List which simulates a cache set. 
-*/
-DLL* cache;
-/**
- * The structure for keeping track of the number of the cache hit, 
- * cache miss, cache eviction, dirty bytes evicted, and dirty bytes remained. Used for function printSummary.
- * The source codes of this struct are in given "cachelab.h" file.
-*/
-csim_stats_t myStats = {
-    .hits = 0,
-    .misses = 0,
-    .evictions = 0,
-    .dirty_bytes = 0,
-    .dirty_evictions = 0
-};
-/**
- * This function takes the set number as a parameter and allocates memory for the array of Doubly LinkedList. 
- * It then allocates memory for the head node and tail node for each Doubly Linked List.
- * If any malloc fails, it returns 1, indicating that an error occurred. Otherwise, return 0.  
-*/
-int initializeCache(unsigned long setNum) {
-    cache = malloc(setNum * sizeof(*cache));
-    for (unsigned long i = 0; i < setNum; i++) {
-        cache[i].head = malloc(sizeof(Node));
-        cache[i].tail = malloc(sizeof(Node));
-        if (cache[i].head == NULL || cache[i].tail == NULL) {
-            return 1;
-        }
-        cache[i].head->next = cache[i].tail;
-        cache[i].tail->prev = cache[i].head;
-    }
-     return 0;    
-}
-/**
- * This function takes the set number as a parameter and clears the memory allocated to each node of each list inside the array. 
-*/
-void cleanUp(unsigned long setNum) {
-    for (unsigned long i = 0; i < setNum; i++) {
-        Node* curr = cache[i].head;
-        while (curr != NULL) {
-            Node* temp = curr->next;
-            free(curr);
-            curr = temp;
-        }
-    }
-    free(cache);
-}
-/**
- * This function takes two parameters, an integer index, and a node n. This function will retrieve the correct Doubly LinkedList inside the array 
- * and insert a node at the end of the list right before the tail node, indicating that the inserted node is the most recently used.  
- * This function is called for every cache operation because the most recently used cache will change everytime. 
-*/
-void addLast(unsigned long index, Node* n) {
-    cache[index].tail->prev->next = n;
-    n->prev = cache[index].tail->prev;
-    n->next = cache[index].tail;
-    cache[index].tail->prev = n;
-}
-/**
- * This function takes a node reference as the parameter. It deletes this node from the linked list by resetting its previous and next node's pointers. 
- * This function is called whenever an eviction happens. 
-*/
-void deleteNode(Node* n) {
-    n->prev->next = n->next;
-    n->next->prev = n->prev;
-}
-/**
- * This function is the function that simulates the cache operation.
- * It takes three parameters, a char indicating the operation type, an unsigned long indicating the address, 
- * and an unsigned long indicating the number of bytes visited.
- * 
- * These parameters are all parsed from a line from the input trace file.
- * It first calculates the tag from the address. 
- * The tag is part of the address except for the set index and the block offset. 
- * So the tag is calculated by right shifting the address by (s + b) bit.
- * Then, the set index is calculated. 
- * Because the set index is located in the middle of the address between the tag and the block offset, 
- * so a mask is first generated by shifting 1 to the left by the number of set bits and then minus 1. 
- * This mask will have its least significant s bits set to 1. 
- * Then the address is right-shifted by the number of block bits so that the least s significant bits are the set index. 
- * Finally, a binary "and" operation is performed to acquire the set index. 
- * 
- * At this point, all the required information is collected, and the cache simulation starts. 
- * It first traverses the Doubly LinkedList located at the set index of the array to acquire how many nodes are there now. 
- *  If there is no node between the head and the tail node, this cache set is cold, and a cold miss happens.
- * (Please see the start of this file for the definition of cold miss and how the simulator will work in this circumstance).
- *  The number of misses will be incremented, and a node will be created and inserted into this list.
- *  Finally, this function will return to its caller. 
- * 
- * If the cache set is not cold, then the program will traverse all the existing nodes between the head and the tail node to see if there is a tag match. 
- * If so, a cache hit happens. 
- * (Please see the start of this file for the definition of cache hit and how the simulator will work in this circumstance).
- * Ths number of hits will be incremented, and the node representing this cache line will be relocated inside the list. 
- * 
- * If there is no cache hit, then a cache miss happens. 
- * (Please see the start of this file for the definition of cache hit and how the simulator will work in this circumstance.)
- * The number of misses will be incremented, and then the number of nodes between the head and the tail node will be compared to user input E to 
- * determine if evictions take place and adjust the number of eviction accordingly. 
- * 
- * Since this function will also possibly call malloc to create new nodes, malloc may fail.
- * So this function will return 1 if any malloc calls fail and return 0 if no error occurs.  
-*/
-int cacheOperation(char op, unsigned long address, unsigned long block) {
-    /* Calculate required information: tag, set index, and bytes visited.*/
-    unsigned long thisTag = address >> (setBit + blockBit);
-    unsigned long thisSetNum = (address >> blockBit) & ((1L << setBit) - 1L);
-    unsigned long blockByteNum = 1L << blockBit;
-    int size = 0;
-    /* Check how many nodes are between the head and the tail now*/
-    Node* sizeCheck = cache[thisSetNum].head->next;
-    while (sizeCheck != cache[thisSetNum].tail) {
-        size++;
-        sizeCheck = sizeCheck->next;
-    }
-    /* No nodes between the head and tail, a cold cache line, a cold miss must take place*/
-    if (size == 0) {
-        myStats.misses = myStats.misses + 1;
-        Node* aNode = malloc(sizeof(Node));
-        if (aNode == NULL) {
-            return 1;
-        }
-        aNode->dirty = 0;
-        if (op == 'S') {
-            aNode->dirty = 1;
-            myStats.dirty_bytes = myStats.dirty_bytes + blockByteNum;
-        }
-        aNode->tag = thisTag;
-        addLast(thisSetNum, aNode);
-        if (verbose == 1) {
-            printf("A Cold Miss\n");
-        }
-        return 0;
-    }
-    /* Traverse all the nodes to see if there is a tag match*/
-    bool hit = false;
-    Node* curr = cache[thisSetNum].head->next;
-    while (curr != cache[thisSetNum].tail) {
-        if (curr->tag == thisTag) {
-            hit = true;
-            break;
-        }
-        curr = curr->next;
-    }
-    /* If there is a tag match, a cache hit must take place.*/
-    if (hit) {
-        myStats.hits = myStats.hits + 1;
-        /* If the operation is "Store", and the hit cache line is not dirty, set the dirty bit of this cache line and increment dirty bytes existing*/
-        if (op == 'S' && curr->dirty == 0) {
-            curr->dirty = 1;
-            myStats.dirty_bytes = myStats.dirty_bytes + blockByteNum;
-        }
-        /* Relocate this node because it is used recently*/
-        deleteNode(curr);
-        addLast(thisSetNum, curr);
-        if (verbose == 1) {
-            printf("Hit!\n");
-        }
-
-    /* No tag match, a cache miss must take place.*/
-    } else {
-        myStats.misses = myStats.misses + 1;
-        Node* aNode = malloc(sizeof(Node));
-        if (aNode == NULL) {
-            return 1;
-        }
-        aNode->dirty = 0;
-        aNode->tag = thisTag;
-        /* If the operation is "Store", set the dirty bit and increment dirty bytes existing*/
-        if (op == 'S') {
-            aNode->dirty = 1;
-            myStats.dirty_bytes = myStats.dirty_bytes + blockByteNum;
-        }
-        /* Check the number of node inside the list between the head and the tail, if they are equal right now, need eviction*/
-        if (size == linesPerSet) {
-            myStats.evictions = myStats.evictions + 1;
-            Node* toDelete = cache[thisSetNum].head->next;
-            /* Check if the evicted cache line is dirty, if so, increment dirty byte evicted and decrement dirty byte existing*/
-            if (toDelete->dirty == 1) {
-                myStats.dirty_evictions = myStats.dirty_evictions + blockByteNum;
-                myStats.dirty_bytes = myStats.dirty_bytes - blockByteNum;
-            }
-            /* Add this node to the end of the list indicating it's the most recently used*/
-            deleteNode(toDelete);
-            free(toDelete);
-            addLast(thisSetNum, aNode);
-            if (verbose == 1) {
-                printf("A Cache Miss and Eviction\n");
-            }
-
-        /* If the number of existing node is smaller than E, no eviction take place. */    
-        } else {
-            addLast(thisSetNum, aNode);
-            if (verbose == 1) {
-                printf("A Cache Miss\n");
-            }
-        }
-    }
-    return 0;
-}
-/**
- * The main function. 
- * It first calls "getArguments" to acquire the set bit, lines per set, and block bits. 
- * If any of these are invalid, it tells the user that the input is invalid, and return 1 indicates that an error occurred. 
- * 
- * It then calls "initializeCache" to allocate memory to the Doubly Linked List array, 
- * and if any memory allocation fails, it returns 1, indicating that an error occurred. 
- * 
- * It then calls the function "main process" to parse the trace file and simulate the cache. 
- * If any line of the trace file is invalid or any memory allocation failed during the cache simulation, it returns 1 indicating that an error occurred. 
- * 
- * After the simulation is done, it clear the memory allocated for the Doubly Linked List array and all the nodes inside the list by calling the function "cleanUp."
- * 
- * Finally, it calls the function printSummary to print out the number of the cache hit, cache miss, cache eviction, dirty bytes existing, and dirty bytes evicted. 
- * The source code of "printSummary" is inside provided "cachelab.h" file. 
-*/
-int main(int argc, char **argv) {
-    getArguments(argc, argv);
-    if (quit == 1 || setBit < 0 || blockBit < 0 || linesPerSet <= 0 || fileName[0] == 0 || setBit + blockBit >= 64) {
-        printf("Invalid Argument!\n");
-        printMessage();
-        return 1;
-    }
-    unsigned long setNum = 1 << setBit;
-    if (initializeCache(setNum) == 1) {
-        return 1;
-    }
-    if (mainProcess(fileName) == 1) {
-        return 1;
-    };
-    cleanUp(setNum);
-    printSummary(&myStats);
-    return 0;
-}
-/**
- * This function processes the user input command line arguments. It checks if verbose mode is enabled, 
- * if a helper usage message needs to be printed, and the value of the set bit, lines per set, and block bits. 
- * If the input is invalid, it sets the global variable "quit" to 1, and this global variable will determine if the program should be aborted in the main function. 
- * The main structure of the function is acquired from the recitation slides of Spring 2022. The site is https://www.cs.cmu.edu/afs/cs/academic/class/15213-s22/www/recitations/rec06_slides.pdf
-*/
-void getArguments(int argc, char ** argv) {
-    int opt;
-    while ((opt = getopt(argc, argv, "vs:E:b:t:h")) != -1) {
-        switch(opt) {
-            case 'v':
-                verbose = 1;
-                break;
-            case 's':
-                setBit = atoi(optarg);
-                break;
-            case 'E':
-                linesPerSet = atoi(optarg);
-                break;
-            case 'b':
-                blockBit = atoi(optarg);
-                break;
-            case 't':
-                strcpy(fileName, optarg);
-                break;
-            case 'h':
-                printMessage();
-                break;
-            default:
-                quit = 1;
-                printMessage();
-                break;
-        }
-    }
-}
-/**
- * This function prints out the usage instruction of this simulator if the user inputs invalid command or typed -h in the command. 
-*/
-void printMessage(void) {
-    printf("Usage :  ./csim -ref [-v] -s <s> -E <E> -b <b> -t <trace>\n");
-    printf("./csim -h\n");
-    printf("    -h    Print this help message and exit\n");
-    printf("    -v    Verbose mode: report effects of each memory operation\n");
-    printf("    -s <s>    Number of set index bits (there are 2**s sets\n");
-    printf("    -b <b>    Number of block bits (there are 2**b blocks)\n");
-    printf("    -E <E>    Number of lines per set (associativity)\n");
-    printf("    -t <trace >    File name of the memory trace to process\n");
-    printf("The -s, -b, -E, and -t options must be supplied for all simulations.\n");
-}
-/**
- * This function takes the input of a string which should be the user input trace file name. 
- * It then parses each line of the trace file to acquire required information such as operation type, address, and visited byte number.
- * For each line of the trace file, this function will check the validity of this line and store the operation type, address, and byte number inside three local variables. 
- * Then these three variables will be used as parameters to call the function "cacheOperation."
- * Since the lines of the trace files may be invalid or the input file may not exist or failed to open, 
- * this function will return 1, indicating an error occurred. Otherwise, it will process all lines of the trace file and finally return 0.
-*/
-int mainProcess(char *afile) {
-    FILE *inputTrace = fopen(afile, "r");
-    if (!inputTrace) {
-        printf("Failed open trace file!\n");
-        return 1;
-    }
-    char lineBuffer[LINELENGTH];
-    char type;
-    char* left;
-    char* end;
-    unsigned long address;
-    unsigned long block;
-    while (fgets(lineBuffer, LINELENGTH, inputTrace)) {
-        type = lineBuffer[0];
-        if (type != 'S' && type != 'L') {
-            return 1;
-        }
-        errno = 0;
-        address = strtoul(lineBuffer + 2, &left, 16);
-        if ((address == 0 && errno == 1) || *left != ',') {
-            return 1;
-        }
-        errno = 0;
-        block = strtoul(left + 1, &end, 10);
-        if (block == 0 && errno == 1) {
-            return 1;
-        }
-        if (verbose == 1) {
-            printf("%c %lx,%ld ", type, address, block);
-        }
-        if (cacheOperation(type, address, block) == 1) {
-            return 1;
-        }
-    }
-    fclose(inputTrace);
-    return 0;
-}
+/**
+ * This C file is a cache simulator that takes user arguments and simulates the operation of a cache. 
+ * In order to use this simulator, four inputs are needed from the user, and they are "s," "E," "b," and "t."
+ * s should be a nonnegative integer that represents the set bit of the cache. In other words, the cache will have 2**s sets. 
+ * E should be a positive integer which represents how many cache lines are in a single set. 
+ * b should be a nonnegative integer that represents the block offset. 
+ * t should be a string that represents the directory of the input trace file. 
+ * An example command line input is: ./csim -s 4 -E 10 -b 0 -t mytrace.trace.
+ * Note that -s, -E, -b, -t can be in any order.
+ * There are also two optional command, -h and -v. The first one will provide a usage insturction, and the second one will enable the verbose mode.  
+ * 
+ * This cache simulator is implemented on top of the cache engine in "cache.c" and "cache.h".
+ * The engine keeps the whole cache in flat arrays: an array of tags and a parallel array of line states (valid bit, dirty bit and the time of the last use).
+ * The E lines of a set are located next to each other inside these arrays, so a set is just a small window of the arrays.
+ * The engine also remembers how many ways of each set have been filled so far. Ways are always filled in order, so only the filled ways have to be checked for a tag match.
+ * 
+ * This cache simulator uses the eviction strategy of LRU, 
+ * which means when a cache set is full, and eviction is required, the Least Recently Used cache line will be evicted. 
+ * In order to achieve this implementation, every access gets a time stamp from a counter that is incremented for each access.
+ * The stamp of a line is updated whenever the line is used, so the line with the smallest stamp inside a set is the Least Recently Used one.
+ * After reading a line from the trace file, the program will check if this line is a valid input. 
+ * If so, the engine will calculate the set index and check how many ways of this set are filled. 
+ * Here, there are three options, a cold miss, and a capacity miss and a cache hit.
+ * 
+ * Cold miss:
+ * If no way of the set has been filled yet, a cold miss happens, 
+ * and the first way is filled with the tag of the cache line and stamped with the current time.
+ * The dirty bit will be set according to the operation type (Load or Store)
+ * 
+ * Capacity miss:
+ * If some ways are filled, then the engine will loop through these ways and check if one of the tags matches the current tag. 
+ * If there is no match, a capacity miss happens.
+ * There are two decisions here:
+ *   1.  If the number of filled ways is smaller than the input E, no eviction happens. 
+ *       The next empty way is filled, its tag and the dirty bit will be adjusted, and it is stamped with the current time. 
+ * 
+ *   2.  If the number of filled ways is equal to the input E, then eviction should take place.
+ *       The Least Recently Used cache line is the way with the smallest stamp. 
+ *       This way is overwritten with the new tag and dirty bit and stamped with the current time, indicates a eviction happened. 
+ * 
+ * Cache Hit:
+ * If some ways are filled, then the engine will loop through these ways and check if one of the tags matches the current tag.
+ * If there is a match, a cache hit happens.
+ * Then the stamp of this way is set to the current time, indicating that it is the most recently used. 
+ * 
+ * The reason why flat arrays are used instead of a linked list of nodes is that no memory has to be allocated or freed while the trace is simulated,
+ * and the tags of a set sit next to each other in memory, so checking a set for a tag match is very fast. 
+ * A hit only needs to write one stamp instead of relinking nodes. 
+ * With at most 16 lines per set, the LRU order of each set is also packed into one 64-bit word of 4-bit way numbers, 
+ * so finding the Least Recently Used way on a miss reads a single word instead of comparing every stamp of the set. 
+*/
+
+#include "cachelab.h"
+#include "cache.h"
+#include "trace.h"
+#include "filter.h"
+#include "sweep.h"
+#include "spill.h"
+#include "partition.h"
+#include "translate.h"
+#include "dram.h"
+#include "ship.h"
+#include "stats.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <getopt.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+
+#define FILENAMELENGTH 100
+void getArguments(int argc, char ** argv);
+void printMessage(void);
+int mainProcess(char *afile);
+int cacheOperation(unsigned char op, unsigned long address, unsigned long block);
+void printOperations(void);
+void saveStatistics(void);
+int regionMarker(unsigned char op, unsigned long id);
+int sweepMain(void);
+int parseDirect(char *arg);
+int simulateBatch(const trace_access_t *batch, size_t count);
+int parseMix(char *arg);
+int mixProcess(void);
+void printMix(void);
+void printOccupancy(void);
+void printLifetimes(void);
+int initTranslator(void);
+int parseDram(char *arg);
+int parseShip(char *arg);
+void printRegions(void);
+
+/**
+ * Indicates if the user gives invalid command line argument. 1 if argument is invalid. 
+*/
+int quit = 0;
+/**
+ * Indicates if the verbose mode is enabled. 1 if the effect of each memory operation should be printed.
+*/
+int verbose;
+/**
+ * Indicates the user input set bit and used for cache simulation. 
+*/
+int setBit = -1;
+/**
+ * Indicates the user input block bit and used for cache simulation. 
+*/
+int blockBit = -1;
+/**
+ * Indicates the user input cache line per set and used for cache simulation. 
+*/
+int linesPerSet = -1;
+/**
+ * Indicates the user input trace file name and used for getting operation inputs.
+*/
+char fileName[FILENAMELENGTH] = "";
+/**
+ * Indicates how the trace file is read: the number of threads decoding a binary trace, 
+ * and the range of chunks of a binary trace to simulate (all chunks by default). 
+ * The source codes of this struct are in "trace.h" file.
+*/
+trace_options_t traceOptions;
+/**
+ * Indicates if instruction fetches of the trace are simulated, and the user input set bit, lines per set, and block bits of the instruction cache. 
+ * Instruction fetches only appear in Valgrind Lackey and DynamoRIO traces; they are ignored unless the --icache option is given. 
+*/
+int icacheEnabled = 0;
+int icacheSetBit = -1;
+int icacheBlockBit = -1;
+int icacheLinesPerSet = -1;
+/**
+ * The simulated instruction cache. It is a separate cache that only sees the instruction fetches, so the data cache above only sees loads and stores. 
+*/
+cache_t icache;
+/**
+ * Indicates the user input filter rule file, and the rules loaded from it. 
+ * If a rule file is given, every batch of accesses goes through the filter before it is simulated: 
+ * accesses outside the included address ranges or inside the excluded ones are dropped, and remapped ranges are moved to their new base address. 
+ * The source codes of the filter are in "filter.c" and "filter.h".
+*/
+char filterName[FILENAMELENGTH] = "";
+addr_filter_t addrFilter;
+/**
+ * Indicates if the sweep mode is enabled (the --sweep option), and the largest set bit and lines per set of the sweep. 
+ * In sweep mode, every cache with 0 to sweepSetBit set bits and 1 to sweepLinesPerSet lines per set is simulated at the same time, 
+ * with the user input block bits, in one pass over the trace. The source codes of the sweep are in "sweep.c" and "sweep.h".
+*/
+int sweepEnabled = 0;
+int sweepSetBit = -1;
+int sweepLinesPerSet = -1;
+sweep_t sweep;
+/**
+ * Indicates if whole batches of loads and stores are given to "cache_access_batch" at once, instead of one access at a time to "cacheOperation". 
+ * This is only done when nothing has to happen between two accesses, that is, without the verbose mode and without regions. 
+ * "requests" holds the loads and stores of the current batch. 
+*/
+int batchMode = 0;
+cache_request_t *requests = NULL;
+size_t requestsSize = 0;
+/**
+ * Indicates if the out-of-core mode is enabled (the --out-of-core option), the directory for its files, and its memory budget in MiB. 
+ * In this mode, the arrays of the cache live in a file inside "outOfCoreDir" instead of memory, 
+ * and the loads and stores are first written to spill files, one per range of sets, and then simulated one range at a time, 
+ * so that only about "outOfCoreBudget" MiB of the cache have to be in memory at once. The source codes are in "spill.c" and "spill.h". 
+*/
+int outOfCore = 0;
+char outOfCoreDir[FILENAMELENGTH] = "";
+unsigned long outOfCoreBudget = 256;
+spill_t spill;
+/**
+ * Indicates if the direct-mapped sweep is enabled (the --direct option), and the set bits and block bits of each of its caches. 
+ * Up to DM_SWEEP_LANES direct-mapped caches, each with its own set bits and block bits, are simulated side by side in one pass. 
+*/
+int directEnabled = 0;
+int directCaches = 0;
+int directSetBits[DM_SWEEP_LANES];
+int directBlockBits[DM_SWEEP_LANES];
+dm_sweep_t direct;
+/**
+ * The maximum number of regions that can be open inside each other at the same time.
+*/
+#define MAXNESTING 64
+/**
+ * The number of region IDs that can be used. tracegen-ct numbers its regions by transpose function, so IDs stay below MAX_TRANS_FUNCS, 
+ * and this limit only keeps a broken trace from growing "regions" to the size of its largest ID. 
+*/
+#define MAXREGIONS 4096
+/**
+ * The statistics of one region of the trace: the sum of the changes of the data cache statistics 
+ * between every begin marker of the region and its end marker, and the number of times the region was entered.
+*/
+typedef struct {
+    csim_stats_t stats;
+    unsigned long calls;
+} regionStats;
+/**
+ * Indicates if per-region statistics are kept (the --regions option). 
+ * "regions" is indexed by the region ID and grows when a new ID is seen. 
+ * "openRegions" is the stack of regions that have begun but not ended yet, 
+ * each with a copy of the data cache statistics at the time it began.
+ * With --cold-regions, the cache is emptied when a region begins, so every region is simulated as if it ran alone, 
+ * like a trace of a single transpose function would be.
+*/
+int regionsEnabled = 0;
+int coldRegions = 0;
+regionStats *regions;
+unsigned long numRegions;
+struct {
+    unsigned long id;
+    csim_stats_t start;
+} openRegions[MAXNESTING];
+int numOpenRegions;
+/**
+ * The maximum number of traces that can be mixed into one shared cache, and the mixing policies. 
+ * With round robin, every trace in turn gives "mixWeights" (all the same) accesses; with ratio, every trace gives its own number of accesses per turn. 
+ * With time, the next access always comes from the trace that is the least far in time, 
+ * where the time of a trace is its number of instruction fetches (or of its accesses, as long as it has had no fetch). 
+*/
+#define MAXTRACES 16
+#define MIX_ROUNDROBIN 0
+#define MIX_RATIO 1
+#define MIX_TIME 2
+/**
+ * One of the traces being mixed: its reader and current batch, its time, its own statistics, 
+ * and the number of lines of every trace that its accesses evicted from the shared cache.
+*/
+typedef struct {
+    trace_reader_t *reader;
+    const trace_access_t *batch;
+    size_t count;
+    size_t position;
+    int finished;
+    unsigned long time;
+    int fetched;
+    csim_stats_t stats;
+    unsigned long evicted[MAXTRACES];
+} mixTrace;
+/**
+ * The trace files given with -t (more than one means mixing), the mixing policy given with --mix, and the traces being mixed. 
+*/
+char traceNames[MAXTRACES][FILENAMELENGTH];
+int numTraces = 0;
+int mixPolicy = MIX_ROUNDROBIN;
+unsigned long mixWeights[MAXTRACES] = {1};
+int numMixWeights = 0;
+mixTrace mixTraces[MAXTRACES];
+/**
+ * Indicates if addresses are translated from virtual to physical before they are simulated (the --translate option), 
+ * the frame allocator and the page size (as a number of bits) of the translation, and the translator itself. 
+ * The source codes of the translation are in "translate.c" and "translate.h". 
+*/
+int translateEnabled = 0;
+translate_alloc_t translateAlloc = TRANSLATE_SEQ;
+int translatePageBits = 12;
+translator_t translator;
+/**
+ * Indicates if the DRAM behind the data cache is simulated (the --dram option), its configuration and the DRAM model itself. 
+ * Every miss of the data cache reads its block from the DRAM, and every eviction of a dirty line writes the line back. 
+ * The source codes of the DRAM model are in "dram.c" and "dram.h". 
+*/
+int dramEnabled = 0;
+dram_config_t dramConfig;
+dram_t dram;
+/**
+ * The replacement policy of the data cache (the --policy option). ARC, CLOCK-Pro and W-TinyLFU only work on a fully associative cache (-s 0). 
+ * The source codes of these policies are in "adaptive.c" and "adaptive.h". 
+*/
+cache_policy_t replacementPolicy = CACHE_LRU;
+/**
+ * The granule (as a number of bits) whose address hash is the signature of SHiP, whether SHiP bypasses the blocks it predicts dead 
+ * (the "ship:<bits>:bypass" form of --policy), and the statistics of its predictor, saved before the cache is freed. 
+ * The source codes of SHiP are in "ship.c" and "ship.h". 
+*/
+int shipGranuleBits = SHIP_GRANULE_BITS;
+int shipBypass = 0;
+ship_stats_t shipStats;
+/**
+ * Indicates if the lifetimes of the lines evicted from the data cache are recorded (the --lifetimes option), and their histograms. 
+*/
+int lifetimesEnabled = 0;
+cache_lifetimes_t lifetimes;
+/**
+ * The trace that the current access comes from (always 0 without mixing). 
+*/
+int currentTrace = 0;
+/**
+ * The rule file of the way partitioning (the --ways option), the partition loaded from it, and the interval of the occupancy report (the --occupancy option). 
+ * With a partition, every access belongs to a class: the class of the address range it falls in, or else the number of its trace. 
+ * A miss can only fill the ways allowed to its class (hits can be in any way), and the cache counts the lines of every class. 
+ * Every "occupancyInterval" data accesses, the number of lines held by every class (or every trace, without a partition) is printed. 
+ * The source codes of the partition are in "partition.c" and "partition.h". 
+*/
+char partitionName[FILENAMELENGTH] = "";
+way_partition_t partition;
+unsigned long occupancyInterval = 0;
+/**
+ * The simulated cache. It holds the tags and line states of every set, 
+ * and also the structure for keeping track of the number of the cache hit, 
+ * cache miss, cache eviction, dirty bytes evicted, and dirty bytes remained. Used for function printSummary.
+ * The source codes of this struct are in "cache.h" file.
+*/
+cache_t cache;
+/**
+ * The counters and histograms saved in ".csim_stats" besides the five numbers of ".csim_results" (see "saveStatistics"), by name. 
+ * The engines keep counting in their own structs during the simulation, so a new metric costs nothing on the access path: 
+ * it only needs a line here, and readers of ".csim_stats" that do not know its name skip it. 
+ * The source codes of the registry are in "stats.c" and "stats.h". 
+*/
+typedef struct {
+    const char *name;
+    const unsigned long *value;
+} namedCounter;
+typedef struct {
+    const char *name;
+    const unsigned long *buckets;
+    size_t count;
+} namedHistogram;
+const namedCounter namedCounters[] = {
+    {"hits", &cache.stats.hits}, {"misses", &cache.stats.misses}, {"evictions", &cache.stats.evictions}, 
+    {"dirty_bytes", &cache.stats.dirty_bytes}, {"dirty_evictions", &cache.stats.dirty_evictions}, 
+    {"ops.modifies", &cache.ops.modifies}, {"ops.modify_hits", &cache.ops.modify_hits}, 
+    {"ops.prefetches", &cache.ops.prefetches}, {"ops.prefetch_misses", &cache.ops.prefetch_misses}, 
+    {"ops.flushes", &cache.ops.flushes}, {"ops.flush_hits", &cache.ops.flush_hits}, 
+    {"ops.flush_writeback_bytes", &cache.ops.flush_writebacks}, 
+    {"ops.nt_stores", &cache.ops.nt_stores}, {"ops.nt_invalidations", &cache.ops.nt_invalidations}, 
+    {"icache.hits", &icache.stats.hits}, {"icache.misses", &icache.stats.misses}, {"icache.evictions", &icache.stats.evictions}, 
+    {"ship.predictions", &shipStats.predictions}, {"ship.correct", &shipStats.correct}, 
+    {"ship.dead", &shipStats.dead}, {"ship.bypasses", &shipStats.bypasses}, 
+    {"dram.reads", &dram.stats.reads}, {"dram.writes", &dram.stats.writes}, {"dram.row_hits", &dram.stats.row_hits}, 
+    {"dram.row_misses", &dram.stats.row_misses}, {"dram.row_conflicts", &dram.stats.row_conflicts}, 
+    {"dram.cycles", &dram.stats.cycles}, 
+    {"lifetimes.evictions", &lifetimes.evictions}, {"lifetimes.dead_on_arrival", &lifetimes.dead_on_arrival}, 
+    {"lifetimes.resident_time", &lifetimes.resident_time}, {"lifetimes.dead_time", &lifetimes.dead_time}, 
+};
+const namedHistogram namedHistograms[] = {
+    {"lifetimes.resident", lifetimes.resident, CACHE_LIFETIME_BUCKETS}, 
+    {"lifetimes.idle", lifetimes.idle, CACHE_LIFETIME_BUCKETS}, 
+    {"lifetimes.hits", lifetimes.hits, CACHE_LIFETIME_BUCKETS}, 
+};
+/**
+ * This function reads a block that was missed on from the DRAM model (with --dram), 
+ * and then writes back the dirty line that was evicted to make room for it, if any. 
+*/
+void dramMiss(unsigned long address, cache_result_t result) {
+    if (dramEnabled == 1 && result != CACHE_HIT) {
+        dram_access(&dram, address, false);
+        if (result == CACHE_MISS_EVICT && cache.evicted_dirty) {
+            dram_access(&dram, cache.evicted_addr, true);
+        }
+    }
+}
+/**
+ * These functions simulate one operation of each type on the data cache with the functions of "cache.c", 
+ * and do the DRAM accesses that the operation causes with --dram. 
+ * A load ('L') and a store ('S') are simulated by "cache_access", and a modify ('M') by "cache_modify" as a load followed by a store of the same block. 
+ * A prefetch ('P') fills the block like a load with "cache_prefetch", but is not counted as a hit or a miss. 
+ * A flush ('F') writes back the block if it is dirty and invalidates its line with "cache_flush_block", 
+ * and a non-temporal store ('N') invalidates any copy of the block with "cache_nt_store" and writes its data straight to memory. 
+ * Each of them returns what the operation did to the cache, which only tells if the block was cached for a flush or a non-temporal store. 
+*/
+cache_result_t loadOperation(unsigned long address) {
+    cache_result_t result = cache_access(&cache, address, false);
+    dramMiss(address, result);
+    return result;
+}
+cache_result_t storeOperation(unsigned long address) {
+    cache_result_t result = cache_access(&cache, address, true);
+    dramMiss(address, result);
+    return result;
+}
+cache_result_t modifyOperation(unsigned long address) {
+    cache_result_t result = cache_modify(&cache, address);
+    dramMiss(address, result);
+    return result;
+}
+cache_result_t prefetchOperation(unsigned long address) {
+    cache_result_t result = cache_prefetch(&cache, address);
+    dramMiss(address, result);
+    return result;
+}
+cache_result_t flushOperation(unsigned long address) {
+    cache_result_t result = cache_flush_block(&cache, address);
+    if (dramEnabled == 1 && result == CACHE_HIT && cache.evicted_dirty) {
+        dram_access(&dram, cache.evicted_addr, true);
+    }
+    return result;
+}
+cache_result_t ntStoreOperation(unsigned long address) {
+    cache_result_t result = cache_nt_store(&cache, address);
+    if (dramEnabled == 1) {
+        dram_access(&dram, address, true);
+    }
+    return result;
+}
+/**
+ * The function that simulates each operation type on the data cache, indexed by the operation type (see "trace.h"). 
+ * "cacheOperation" looks the function up in this table instead of comparing the operation type against every kind of operation for each access. 
+ * Instruction fetches go to the instruction cache and region markers never reach "cacheOperation", so they have no function here. 
+*/
+typedef cache_result_t (*dataOperation)(unsigned long address);
+const dataOperation dataOperations[TRACE_NUM_OPS] = {
+    [TRACE_LOAD] = loadOperation,
+    [TRACE_STORE] = storeOperation,
+    [TRACE_MODIFY] = modifyOperation,
+    [TRACE_PREFETCH] = prefetchOperation,
+    [TRACE_FLUSH] = flushOperation,
+    [TRACE_NT_STORE] = ntStoreOperation,
+};
+/**
+ * This function is the function that simulates the cache operation.
+ * It takes three parameters, the operation type (see "trace.h"), an unsigned long indicating the address, 
+ * and an unsigned long indicating the number of bytes visited.
+ * 
+ * These parameters are all parsed from a line from the input trace file.
+ * An instruction fetch (operation type 'I') goes to the instruction cache if it is enabled, and is ignored otherwise. 
+ * Before any other operation, the cache is told the class of the access (see "partitionName"), so that a miss only fills the ways allowed to it. 
+ * The operation is then simulated by its function in "dataOperations" (see above), which also does its DRAM accesses with --dram. 
+ * For a load or store, the simulation itself is done by "cache_access" inside "cache.c", which calculates the tag and the set index from the address,
+ * looks for a tag match inside the set, and updates the number of hits, misses, evictions and dirty bytes.
+ * (Please see the start of this file for the definition of cold miss, capacity miss and cache hit and how the simulator will work in these circumstances).
+ * This function then prints the effect of the operation if the verbose mode is enabled. 
+ * In the sweep modes, a modify is simulated as a load and a store, while prefetches, flushes and non-temporal stores are ignored. 
+ * 
+ * Since the cache memory is allocated up front, this function cannot fail and always returns 0.
+*/
+int cacheOperation(unsigned char op, unsigned long address, unsigned long block) {
+    cache_result_t result;
+    if (sweepEnabled == 1 || directEnabled == 1) {
+        if (op == TRACE_LOAD || op == TRACE_STORE || op == TRACE_MODIFY) {
+            if (sweepEnabled == 1) {
+                sweep_access(&sweep, address);
+            }
+            if (directEnabled == 1) {
+                dm_sweep_access(&direct, address, op == TRACE_STORE);
+            }
+        }
+        if (op == TRACE_MODIFY) {
+            if (sweepEnabled == 1) {
+                sweep_access(&sweep, address);
+            }
+            if (directEnabled == 1) {
+                dm_sweep_access(&direct, address, true);
+            }
+        }
+        if (verbose == 1) {
+            printf("\n");
+        }
+        return 0;
+    }
+    if (op == TRACE_IFETCH) {
+        if (icacheEnabled == 0) {
+            if (verbose == 1) {
+                printf("Ignored\n");
+            }
+            return 0;
+        }
+        result = cache_access(&icache, address, false);
+    } else {
+        cache.current = (unsigned short)currentTrace;
+        if (partitionName[0] != 0) {
+            cache.current = partition_class(&partition, address, cache.current);
+        }
+        result = dataOperations[op](address);
+    }
+    if (verbose == 1) {
+        switch (result) {
+            case CACHE_HIT:
+                printf("Hit!\n");
+                break;
+            case CACHE_COLD_MISS:
+                printf("A Cold Miss\n");
+                break;
+            case CACHE_MISS:
+                printf("A Cache Miss\n");
+                break;
+            case CACHE_MISS_EVICT:
+                printf("A Cache Miss and Eviction\n");
+                break;
+        }
+    }
+    if (op != TRACE_IFETCH && occupancyInterval > 0 && cache.clock % occupancyInterval == 0) {
+        printOccupancy();
+    }
+    return 0;
+}
+/**
+ * This function handles a region marker of the trace. tracegen-ct puts a begin marker before every transpose function and an end marker after it, 
+ * with the function number as the region ID. 
+ * At a begin marker, the current statistics of the data cache are remembered. At the matching end marker, 
+ * the difference between the statistics now and the remembered ones is added to the statistics of the region. 
+ * Regions can be inside each other, and then the accesses count for all of them. 
+ * An end marker that does not match the last begin marker means the trace is broken, and the function returns 1, 
+ * as it does for a begin marker nested more than MAXNESTING deep or with an ID of MAXREGIONS or more. 
+*/
+int regionMarker(unsigned char op, unsigned long id) {
+    if (verbose == 1) {
+        printf("Region %lu %s\n", id, op == TRACE_REGION_BEGIN ? "begins" : "ends");
+    }
+    if (regionsEnabled == 0) {
+        return 0;
+    }
+    if (op == TRACE_REGION_BEGIN) {
+        if (numOpenRegions == MAXNESTING) {
+            printf("Regions nested too deeply!\n");
+            return 1;
+        }
+        if (id >= MAXREGIONS) {
+            printf("Region ID too large!\n");
+            return 1;
+        }
+        if (id >= numRegions) {
+            regionStats *grown = realloc(regions, (id + 1) * sizeof(*regions));
+            if (!grown) {
+                return 1;
+            }
+            memset(grown + numRegions, 0, (id + 1 - numRegions) * sizeof(*regions));
+            regions = grown;
+            numRegions = id + 1;
+        }
+        if (coldRegions == 1) {
+            cache_flush(&cache);
+        }
+        openRegions[numOpenRegions].id = id;
+        openRegions[numOpenRegions].start = cache.stats;
+        numOpenRegions++;
+        return 0;
+    }
+    if (numOpenRegions == 0 || openRegions[numOpenRegions - 1].id != id) {
+        printf("Region %lu ends without beginning!\n", id);
+        return 1;
+    }
+    numOpenRegions--;
+    csim_stats_t *start = &openRegions[numOpenRegions].start;
+    csim_stats_t *sum = &regions[id].stats;
+    sum->hits += cache.stats.hits - start->hits;
+    sum->misses += cache.stats.misses - start->misses;
+    sum->evictions += cache.stats.evictions - start->evictions;
+    sum->dirty_bytes += cache.stats.dirty_bytes - start->dirty_bytes;
+    sum->dirty_evictions += cache.stats.dirty_evictions - start->dirty_evictions;
+    regions[id].calls++;
+    return 0;
+}
+/**
+ * This function prints the statistics of every region that was entered at least once. 
+ * The dirty bytes of a region are the change of the number of dirty bytes in the cache while inside the region, so they can be negative. 
+*/
+void printRegions(void) {
+    for (unsigned long id = 0; id < numRegions; id++) {
+        if (regions[id].calls == 0) {
+            continue;
+        }
+        printf("region %lu: hits:%lu misses:%lu evictions:%lu dirty_bytes_in_cache:%ld dirty_bytes_evicted:%lu calls:%lu\n", 
+               id, regions[id].stats.hits, regions[id].stats.misses, regions[id].stats.evictions, 
+               (long)regions[id].stats.dirty_bytes, regions[id].stats.dirty_evictions, regions[id].calls);
+    }
+}
+/**
+ * This function runs the sweep modes instead of the simulation of a single cache. 
+ * It allocates the sweep of the --sweep option and the direct-mapped sweep of the --direct option (one or both can be given), 
+ * processes the trace with "mainProcess" (which sends every load and store to "sweep_access" and "dm_sweep_access"), 
+ * and prints the statistics of every simulated cache, one cache per line. 
+ * Dirty bytes are not reported for the caches of --sweep, and printSummary is not called. 
+*/
+int sweepMain(void) {
+    int valid = quit == 0 && fileName[0] != 0;
+    if (valid == 1 && sweepEnabled == 1) {
+        valid = sweepSetBit >= 0 && sweepLinesPerSet > 0 && blockBit >= 0 && 
+            sweep_init(&sweep, sweepSetBit, sweepLinesPerSet, blockBit);
+    }
+    if (valid == 1 && directEnabled == 1) {
+        valid = dm_sweep_init(&direct, directCaches, directSetBits, directBlockBits);
+        if (valid == 0 && sweepEnabled == 1) {
+            sweep_free(&sweep);
+        }
+    }
+    if (valid == 0) {
+        printf("Invalid Argument!\n");
+        printMessage();
+        return 1;
+    }
+    int status = mainProcess(fileName);
+    if (status == 0 && sweepEnabled == 1) {
+        for (int s = 0; s <= sweepSetBit; s++) {
+            for (int E = 1; E <= sweepLinesPerSet; E++) {
+                csim_stats_t stats;
+                sweep_stats(&sweep, s, E, &stats);
+                printf("s:%d E:%d hits:%lu misses:%lu evictions:%lu\n", s, E, stats.hits, stats.misses, stats.evictions);
+            }
+        }
+    }
+    if (status == 0 && directEnabled == 1) {
+        for (int i = 0; i < directCaches; i++) {
+            csim_stats_t stats;
+            dm_sweep_stats(&direct, i, &stats);
+            printf("s:%d E:1 b:%d hits:%lu misses:%lu evictions:%lu dirty_bytes_in_cache:%lu dirty_bytes_evicted:%lu\n", 
+                   directSetBits[i], directBlockBits[i], stats.hits, stats.misses, stats.evictions, 
+                   stats.dirty_bytes, stats.dirty_evictions);
+        }
+    }
+    if (sweepEnabled == 1) {
+        sweep_free(&sweep);
+    }
+    if (directEnabled == 1) {
+        dm_sweep_free(&direct);
+    }
+    return status;
+}
+/**
+ * This function parses the argument of the --direct option, a comma separated list of "set bits:block bits" pairs, 
+ * into "directSetBits" and "directBlockBits". It returns 1 if the list is invalid or has more than DM_SWEEP_LANES pairs, and 0 otherwise. 
+*/
+int parseDirect(char *arg) {
+    char *pair = strtok(arg, ",");
+    directCaches = 0;
+    while (pair != NULL) {
+        if (directCaches == DM_SWEEP_LANES) {
+            return 1;
+        }
+        if (sscanf(pair, "%d:%d", &directSetBits[directCaches], &directBlockBits[directCaches]) != 2) {
+            return 1;
+        }
+        directCaches++;
+        pair = strtok(NULL, ",");
+    }
+    return directCaches == 0;
+}
+/**
+ * This function simulates a whole batch of the trace in the batch mode. 
+ * Instruction fetches still go through "cacheOperation" (to the instruction cache, or ignored), and region markers through "regionMarker", 
+ * while the loads and stores are copied into "requests" and simulated together by "cache_access_batch" inside "cache.c". 
+ * Any other operation (a modify, prefetch, flush or non-temporal store) must see the cache as it is at its place in the trace, 
+ * so the loads and stores before it are simulated first, and it then goes through "cacheOperation". 
+ * This cannot be done in the out-of-core mode, which only simulates the loads and stores after the whole trace is read, so there it is an error. 
+ * For a large cache, "cache_access_batch" groups the accesses by set before simulating them, 
+ * so that the sets being worked on stay in the caches of the computer running the simulator. The statistics are the same as in the normal mode. 
+ * In the out-of-core mode, the loads and stores are written to the spill files by "spill_put" instead, and simulated after the whole trace is read. 
+ * This function returns 1 if the memory for "requests" cannot be allocated or another operation is found in the out-of-core mode, and 0 otherwise. 
+*/
+int simulateBatch(const trace_access_t *batch, size_t count) {
+    if (count > requestsSize) {
+        cache_request_t *grown = realloc(requests, count * sizeof(*requests));
+        if (!grown) {
+            return 1;
+        }
+        requests = grown;
+        requestsSize = count;
+    }
+    size_t numRequests = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (batch[i].op == TRACE_LOAD || batch[i].op == TRACE_STORE) {
+            requests[numRequests].addr = batch[i].addr;
+            requests[numRequests].store = batch[i].op == TRACE_STORE;
+            numRequests++;
+        } else if (batch[i].op == TRACE_REGION_BEGIN || batch[i].op == TRACE_REGION_END) {
+            if (regionMarker(batch[i].op, batch[i].addr) == 1) {
+                return 1;
+            }
+        } else if (batch[i].op == TRACE_IFETCH) {
+            if (cacheOperation(batch[i].op, batch[i].addr, batch[i].size) == 1) {
+                return 1;
+            }
+        } else {
+            if (outOfCore == 1) {
+                printf("Modifies, prefetches, flushes and non-temporal stores cannot be simulated with --out-of-core!\n");
+                return 1;
+            }
+            cache_access_batch(&cache, requests, numRequests);
+            numRequests = 0;
+            if (cacheOperation(batch[i].op, batch[i].addr, batch[i].size) == 1) {
+                return 1;
+            }
+        }
+    }
+    if (outOfCore == 1) {
+        spill_put(&spill, requests, numRequests);
+    } else {
+        cache_access_batch(&cache, requests, numRequests);
+    }
+    return 0;
+}
+/**
+ * This function creates the translator of the --translate option, if it is given. 
+ * The number of page colors is the number of different set indexes that pages can start at: 2**(s+b) divided by the page size, 
+ * where s is the set bits (the largest set bits with --sweep), and s+b is the largest of the caches of --direct if that is given, 
+ * whose -s and -b are not used. It returns 1 if the translator cannot be created, and 0 otherwise. 
+*/
+int initTranslator(void) {
+    int bits = -1;
+    unsigned long colors = 1;
+    if (translateEnabled == 0) {
+        return 0;
+    }
+    if (sweepEnabled == 1) {
+        bits = sweepSetBit + blockBit;
+    } else if (directEnabled == 0) {
+        bits = setBit + blockBit;
+    }
+    for (int i = 0; directEnabled == 1 && i < directCaches; i++) {
+        if (directSetBits[i] + directBlockBits[i] > bits) {
+            bits = directSetBits[i] + directBlockBits[i];
+        }
+    }
+    if (bits > translatePageBits) {
+        colors = 1UL << (bits - translatePageBits);
+    }
+    if (!translate_init(&translator, translateAlloc, translatePageBits, colors)) {
+        printf("Invalid Argument!\n");
+        return 1;
+    }
+    return 0;
+}
+/**
+ * This function parses the argument of the --dram option: "default", or "<channels>:<ranks>:<banks>:<row bytes>[:<order>]", 
+ * where the order lists the address fields from the most significant bits down (see "dram.h"). The timings are always those of "dram_default_config". 
+ * It returns 1 if the argument is invalid, and 0 otherwise. 
+*/
+int parseDram(char *arg) {
+    char order[DRAM_FIELDS + 2] = "";
+    dram_default_config(&dramConfig);
+    if (strcmp(arg, "default") == 0) {
+        return 0;
+    }
+    int fields = sscanf(arg, "%u:%u:%u:%lu:%6s", &dramConfig.channels, &dramConfig.ranks, &dramConfig.banks, 
+                        &dramConfig.row_bytes, order);
+    if (fields < 4 || strlen(order) > DRAM_FIELDS) {
+        return 1;
+    }
+    if (fields == 5) {
+        strcpy(dramConfig.order, order);
+    }
+    return 0;
+}
+/**
+ * This function parses the options of SHiP in the argument of the --policy option: "ship", followed by the granule bits, "bypass", or both, 
+ * each after a colon (such as "ship:16:bypass"). The options are cut off the argument, which is then left as the name of the policy. 
+ * Any other policy name is left as it is. It returns 1 if an option is invalid. 
+*/
+int parseShip(char *arg) {
+    if (strncmp(arg, "ship:", 5) != 0) {
+        return 0;
+    }
+    char *option = arg + 5;
+    arg[4] = 0;
+    while (option != NULL) {
+        char *next = strchr(option, ':');
+        if (next != NULL) {
+            *next = 0;
+            next++;
+        }
+        char *left;
+        if (strcmp(option, "bypass") == 0) {
+            shipBypass = 1;
+        } else {
+            shipGranuleBits = (int)strtol(option, &left, 10);
+            if (left == option || *left != 0) {
+                return 1;
+            }
+        }
+        option = next;
+    }
+    return 0;
+}
+/**
+ * This function parses the argument of the --mix option: "rr" or "rr:<n>" (round robin, n accesses per turn, 1 by default), 
+ * "ratio:<n>:<n>..." (one number of accesses per turn for every trace, in the order of the -t options), or "time". 
+ * It returns 1 if the argument is invalid, and 0 otherwise. 
+*/
+int parseMix(char *arg) {
+    char *number;
+    numMixWeights = 0;
+    if (strcmp(arg, "time") == 0) {
+        mixPolicy = MIX_TIME;
+        return 0;
+    }
+    if (strncmp(arg, "rr", 2) == 0 && (arg[2] == 0 || arg[2] == ':')) {
+        mixPolicy = MIX_ROUNDROBIN;
+        mixWeights[0] = 1;
+        if (arg[2] == ':' && sscanf(arg + 3, "%lu", &mixWeights[0]) != 1) {
+            return 1;
+        }
+        numMixWeights = 1;
+        return mixWeights[0] == 0;
+    }
+    if (strncmp(arg, "ratio:", 6) != 0) {
+        return 1;
+    }
+    mixPolicy = MIX_RATIO;
+    number = strtok(arg + 6, ":");
+    while (number != NULL) {
+        if (numMixWeights == MAXTRACES || sscanf(number, "%lu", &mixWeights[numMixWeights]) != 1 || mixWeights[numMixWeights] == 0) {
+            return 1;
+        }
+        numMixWeights++;
+        number = strtok(NULL, ":");
+    }
+    return numMixWeights == 0;
+}
+/**
+ * This function gives the next record of one of the mixed traces, or NULL (and marks the trace as finished) at the end of it. 
+*/
+const trace_access_t *mixNext(mixTrace *trace) {
+    while (trace->finished == 0 && trace->position == trace->count) {
+        trace->batch = trace_next(trace->reader, &trace->count);
+        trace->position = 0;
+        if (!trace->batch) {
+            trace->finished = 1;
+        }
+    }
+    if (trace->finished == 1) {
+        return NULL;
+    }
+    return &trace->batch[trace->position++];
+}
+/**
+ * This function mixes several traces (the -t option given more than once) into one shared data cache. 
+ * Every trace is opened with its own reader, which parses ahead on at least one thread of its own, so the mixing never waits for a file. 
+ * The traces are interleaved according to the --mix option (see "parseMix"), until all of them are finished. 
+ * Every access is simulated by "cacheOperation" as usual, after the cache is told which trace the access comes from, 
+ * so every line of the cache remembers the trace that filled it. The changes of the statistics are added to the statistics of the trace, 
+ * and when the access evicts a line, the trace that owned the line is counted as evicted by this trace. 
+ * Instruction fetches go to the instruction cache (if any) and only move the time of the trace, and region markers are ignored. 
+ * With --translate, every trace has its own virtual address space, and all of them share the physical memory. 
+ * This function returns 1 if a trace cannot be opened or is invalid, and 0 otherwise. 
+*/
+int mixProcess(void) {
+    trace_options_t options = traceOptions;
+    int result = 0;
+    int active = numTraces;
+    int turn = -1;
+    unsigned long left = 0;
+    if (options.threads <= 0) {
+        options.threads = 1;
+    }
+    if (!cache_track_owners(&cache) || initTranslator() == 1) {
+        return 1;
+    }
+    for (int i = 0; i < numTraces; i++) {
+        mixTraces[i].reader = trace_open(traceNames[i], &options);
+        if (!mixTraces[i].reader) {
+            printf("Failed open trace file!\n");
+            result = 1;
+            active = 0;
+            break;
+        }
+    }
+    while (active > 0 && result == 0) {
+        int t = turn;
+        if (mixPolicy == MIX_TIME) {
+            t = -1;
+            for (int i = 0; i < numTraces; i++) {
+                if (mixTraces[i].finished == 0 && (t < 0 || mixTraces[i].time < mixTraces[t].time)) {
+                    t = i;
+                }
+            }
+        } else if (left == 0 || mixTraces[t].finished == 1) {
+            if (left == 0) {
+                t = (t + 1) % numTraces;
+            }
+            while (mixTraces[t].finished == 1) {
+                t = (t + 1) % numTraces;
+            }
+            turn = t;
+            left = mixPolicy == MIX_RATIO ? mixWeights[t] : mixWeights[0];
+        }
+        const trace_access_t *access = mixNext(&mixTraces[t]);
+        if (!access) {
+            active--;
+            left = 0;
+            continue;
+        }
+        left--;
+        if (access->op == TRACE_REGION_BEGIN || access->op == TRACE_REGION_END) {
+            continue;
+        }
+        if (access->op == TRACE_IFETCH) {
+            mixTraces[t].time++;
+            mixTraces[t].fetched = 1;
+        } else if (mixTraces[t].fetched == 0) {
+            mixTraces[t].time++;
+        }
+        unsigned long address = access->addr;
+        if (translateEnabled == 1 && !translate_addr(&translator, (unsigned int)t, access->addr, &address)) {
+            printf("Out of physical memory!\n");
+            result = 1;
+            break;
+        }
+        if (verbose == 1) {
+            printf("%d: %c %lx,%u ", t, trace_op_char(access->op), address, access->size);
+        }
+        csim_stats_t before = cache.stats;
+        currentTrace = t;
+        cacheOperation(access->op, address, access->size);
+        mixTraces[t].stats.hits += cache.stats.hits - before.hits;
+        mixTraces[t].stats.misses += cache.stats.misses - before.misses;
+        mixTraces[t].stats.dirty_evictions += cache.stats.dirty_evictions - before.dirty_evictions;
+        if (cache.stats.evictions != before.evictions) {
+            mixTraces[t].stats.evictions++;
+            mixTraces[t].evicted[cache.victim]++;
+        }
+    }
+    translate_free(&translator);
+    for (int i = 0; i < numTraces; i++) {
+        if (mixTraces[i].reader) {
+            size_t errors = trace_errors(mixTraces[i].reader);
+            if (!trace_close(mixTraces[i].reader)) {
+                result = 1;
+            } else if (errors > 0) {
+                fprintf(stderr, "Skipped %zu malformed lines in %s\n", errors, traceNames[i]);
+            }
+        }
+    }
+    return result;
+}
+/**
+ * This function prints the statistics of every mixed trace: its hits, misses, evictions and dirty bytes evicted by its own accesses, 
+ * and how many lines of every trace (itself included) its accesses evicted. 
+*/
+void printMix(void) {
+    for (int i = 0; i < numTraces; i++) {
+        printf("trace %d hits:%lu misses:%lu evictions:%lu dirty_bytes_evicted:%lu evicted", i, mixTraces[i].stats.hits, 
+               mixTraces[i].stats.misses, mixTraces[i].stats.evictions, mixTraces[i].stats.dirty_evictions);
+        for (int j = 0; j < numTraces; j++) {
+            printf(" %d:%lu", j, mixTraces[i].evicted[j]);
+        }
+        printf("\n");
+    }
+}
+/**
+ * This function prints the lifetimes of the lines evicted from the data cache: the share of the lines that were never hit (dead on arrival), 
+ * and the share of the time the lines were resident that came after their last use (dead time), 
+ * followed by the histograms of the accesses they were resident, the accesses since their last use, and their hits. 
+ * Every bucket of a histogram is printed as its lower bound and its number of lines; the bucket of n holds [n, 2n), and empty buckets are left out. 
+*/
+void printLifetimes(void) {
+    const char *names[3] = {"resident", "idle", "hits"};
+    const unsigned long *histograms[3] = {lifetimes.resident, lifetimes.idle, lifetimes.hits};
+    printf("lifetimes evictions:%lu dead_on_arrival:%.2f%% dead_time:%.2f%%\n", lifetimes.evictions, 
+           lifetimes.evictions > 0 ? 100.0 * (double)lifetimes.dead_on_arrival / (double)lifetimes.evictions : 0.0, 
+           lifetimes.resident_time > 0 ? 100.0 * (double)lifetimes.dead_time / (double)lifetimes.resident_time : 0.0);
+    for (int h = 0; h < 3; h++) {
+        printf("lifetime %s", names[h]);
+        for (int k = 0; k < CACHE_LIFETIME_BUCKETS; k++) {
+            if (histograms[h][k] > 0) {
+                printf(" %lu:%lu", k == 0 ? 0UL : 1UL << (k - 1), histograms[h][k]);
+            }
+        }
+        printf("\n");
+    }
+}
+/**
+ * This function prints the counts of the operations other than loads and stores, if the trace had any: 
+ * modifies and how many of them hit, prefetches and how many of them missed (and so filled a line), 
+ * flushes, how many of them found the block in the cache and how many dirty bytes they wrote back, 
+ * and non-temporal stores and how many cached copies they invalidated. 
+ * Prefetches, flushes and non-temporal stores are not counted as hits or misses in the summary, and modifies count as a load and a store. 
+*/
+void printOperations(void) {
+    const cache_op_stats_t *ops = &cache.ops;
+    if (ops->modifies + ops->prefetches + ops->flushes + ops->nt_stores == 0) {
+        return;
+    }
+    printf("ops modifies:%lu modify_hits:%lu prefetches:%lu prefetch_misses:%lu flushes:%lu flush_hits:%lu "
+           "flush_writeback_bytes:%lu nt_stores:%lu nt_invalidations:%lu\n", ops->modifies, ops->modify_hits, 
+           ops->prefetches, ops->prefetch_misses, ops->flushes, ops->flush_hits, ops->flush_writebacks, 
+           ops->nt_stores, ops->nt_invalidations);
+}
+/**
+ * This function saves the named statistics to ".csim_stats" (see "namedCounters" and "namedHistograms"). 
+ * It registers every metric, stores the final counts of the engines in the registry and writes it out. 
+ * Like printSummary, it only reports an error if the file cannot be written. 
+*/
+void saveStatistics(void) {
+    stats_registry_t registry;
+    size_t counterSlots[sizeof(namedCounters) / sizeof(namedCounters[0])];
+    size_t histogramSlots[sizeof(namedHistograms) / sizeof(namedHistograms[0])];
+    int ok = 1;
+    stats_init(&registry);
+    for (size_t i = 0; i < sizeof(namedCounters) / sizeof(namedCounters[0]); i++) {
+        ok = ok && stats_counter(&registry, namedCounters[i].name, &counterSlots[i]);
+    }
+    for (size_t i = 0; i < sizeof(namedHistograms) / sizeof(namedHistograms[0]); i++) {
+        ok = ok && stats_histogram(&registry, namedHistograms[i].name, namedHistograms[i].count, &histogramSlots[i]);
+    }
+    for (size_t i = 0; ok && i < sizeof(namedCounters) / sizeof(namedCounters[0]); i++) {
+        ok = stats_add(&registry, counterSlots[i], *namedCounters[i].value);
+    }
+    for (size_t i = 0; ok && i < sizeof(namedHistograms) / sizeof(namedHistograms[0]); i++) {
+        for (size_t k = 0; ok && k < namedHistograms[i].count; k++) {
+            ok = stats_add(&registry, histogramSlots[i] + k, namedHistograms[i].buckets[k]);
+        }
+    }
+    if (ok) {
+        stats_write(&registry, ".csim_stats");
+    } else {
+        fprintf(stderr, "Error: failed to collect the named statistics\n");
+    }
+    stats_free(&registry);
+}
+/**
+ * This function prints the number of lines of the data cache held by every class of the partition, 
+ * or by every trace without a partition, after the current number of data accesses. 
+*/
+void printOccupancy(void) {
+    unsigned int classes = partition.num_classes > (unsigned int)numTraces ? partition.num_classes : (unsigned int)numTraces;
+    printf("occupancy after %lu accesses:", cache.clock);
+    for (unsigned int c = 0; c < classes; c++) {
+        printf(" %u:%lu", c, cache.occupancy[c]);
+    }
+    printf("\n");
+}
+/**
+ * The main function. 
+ * It first calls "getArguments" to acquire the set bit, lines per set, and block bits. 
+ * If any of these are invalid, it tells the user that the input is invalid, and return 1 indicates that an error occurred. 
+ * 
+ * It then calls "cache_init" to allocate memory to the tag array and the line state array of the cache (and of the instruction cache, if enabled), 
+ * or "cache_init_mapped" and "spill_open" in the out-of-core mode, and if any memory allocation fails, it returns 1, indicating that an error occurred. 
+ * 
+ * It then calls the function "main process" to parse the trace file and simulate the cache. 
+ * Without the verbose mode and regions, the batch mode is used (see "simulateBatch"). 
+ * In the out-of-core mode, the spill files written during the trace are then simulated by "spill_run". 
+ * If any line of the trace file is invalid, it returns 1 indicating that an error occurred. 
+ * 
+ * After the simulation is done, it clear the memory allocated for the cache by calling the function "cache_free."
+ * 
+ * If the instruction cache is enabled, its number of hits, misses and evictions are printed first, 
+ * followed by the statistics of every region if --regions is given. 
+ * Finally, it calls the function printSummary to print out the number of the cache hit, cache miss, cache eviction, dirty bytes existing, and dirty bytes evicted. 
+ * The source code of "printSummary" is inside provided "cachelab.h" file. 
+ * The same numbers and every other named statistic are then saved to ".csim_stats" by "saveStatistics". 
+*/
+int main(int argc, char **argv) {
+    getArguments(argc, argv);
+    if (sweepEnabled == 1 || directEnabled == 1) {
+        return sweepMain();
+    }
+    if (quit == 1 || setBit < 0 || blockBit < 0 || linesPerSet <= 0 || fileName[0] == 0 || setBit + blockBit >= 64) {
+        printf("Invalid Argument!\n");
+        printMessage();
+        return 1;
+    }
+    if (icacheEnabled == 1 && (icacheSetBit < 0 || icacheBlockBit < 0 || icacheLinesPerSet <= 0 || icacheSetBit + icacheBlockBit >= 64)) {
+        printf("Invalid Argument!\n");
+        printMessage();
+        return 1;
+    }
+    if (numTraces > 1 && (outOfCore == 1 || regionsEnabled == 1 || filterName[0] != 0 || 
+        (mixPolicy == MIX_RATIO && numMixWeights != numTraces))) {
+        printf("Mixing traces cannot be used with --out-of-core, regions or --filter, and needs one ratio per trace!\n");
+        return 1;
+    }
+    if (outOfCore == 1 && (verbose == 1 || regionsEnabled == 1 || partitionName[0] != 0 || occupancyInterval > 0 || dramEnabled == 1)) {
+        printf("The out-of-core mode cannot be used with -v, regions, --ways, --occupancy or --dram!\n");
+        return 1;
+    }
+    if (outOfCore == 1) {
+        char statePath[FILENAMELENGTH + 64];
+        snprintf(statePath, sizeof(statePath), "%s/csim-state.%ld", outOfCoreDir, (long)getpid());
+        if (!cache_init_mapped(&cache, setBit, linesPerSet, blockBit, statePath)) {
+            return 1;
+        }
+        if (!spill_open(&spill, &cache, outOfCoreDir, outOfCoreBudget << 20)) {
+            cache_free(&cache);
+            return 1;
+        }
+    } else if (!cache_init(&cache, setBit, linesPerSet, blockBit)) {
+        return 1;
+    }
+    if (replacementPolicy != CACHE_LRU && (outOfCore == 1 || partitionName[0] != 0 || 
+        !(replacementPolicy == CACHE_SHIP ? cache_set_ship(&cache, shipGranuleBits, shipBypass == 1) : cache_set_policy(&cache, replacementPolicy)))) {
+        printf("ARC, CLOCK-Pro and W-TinyLFU need -s 0, SHiP a granule of at least b bits, and none can be used with --out-of-core or --ways!\n");
+        cache_free(&cache);
+        spill_close(&spill);
+        return 1;
+    }
+    if (icacheEnabled == 1 && !cache_init(&icache, icacheSetBit, icacheLinesPerSet, icacheBlockBit)) {
+        cache_free(&cache);
+        spill_close(&spill);
+        return 1;
+    }
+    if (partitionName[0] != 0 && (!partition_load(&partition, partitionName, linesPerSet) || 
+        !cache_set_way_masks(&cache, partition.masks))) {
+        printf("Invalid way partition!\n");
+        cache_free(&cache);
+        cache_free(&icache);
+        spill_close(&spill);
+        partition_free(&partition);
+        return 1;
+    }
+    if (dramEnabled == 1 && !dram_init(&dram, &dramConfig, blockBit)) {
+        printf("Invalid DRAM configuration!\n");
+        cache_free(&cache);
+        cache_free(&icache);
+        spill_close(&spill);
+        partition_free(&partition);
+        return 1;
+    }
+    if (occupancyInterval > 0 && !cache_track_owners(&cache)) {
+        cache_free(&cache);
+        cache_free(&icache);
+        spill_close(&spill);
+        partition_free(&partition);
+        return 1;
+    }
+    if (lifetimesEnabled == 1 && !cache_track_lifetimes(&cache, &lifetimes)) {
+        printf("--lifetimes cannot be used with --out-of-core, arc, clockpro or tinylfu!\n");
+        cache_free(&cache);
+        cache_free(&icache);
+        spill_close(&spill);
+        partition_free(&partition);
+        return 1;
+    }
+    if (verbose == 0 && regionsEnabled == 0 && partitionName[0] == 0 && occupancyInterval == 0 && dramEnabled == 0) {
+        batchMode = 1;
+    }
+    if ((numTraces > 1 ? mixProcess() : mainProcess(fileName)) == 1 || (outOfCore == 1 && !spill_run(&spill))) {
+        cache_free(&cache);
+        cache_free(&icache);
+        spill_close(&spill);
+        partition_free(&partition);
+        dram_free(&dram);
+        free(regions);
+        return 1;
+    };
+    if (cache.ship != NULL) {
+        ship_stats(cache.ship, &shipStats);
+    }
+    spill_close(&spill);
+    partition_free(&partition);
+    dram_free(&dram);
+    cache_free(&cache);
+    cache_free(&icache);
+    printRegions();
+    free(regions);
+    if (occupancyInterval > 0 && cache.clock % occupancyInterval != 0) {
+        printOccupancy();
+    }
+    if (numTraces > 1) {
+        printMix();
+    }
+    if (dramEnabled == 1) {
+        printf("dram reads:%lu writes:%lu row_hits:%lu row_misses:%lu row_conflicts:%lu cycles:%lu bandwidth:%.2fGB/s\n", 
+               dram.stats.reads, dram.stats.writes, dram.stats.row_hits, dram.stats.row_misses, dram.stats.row_conflicts, 
+               dram.stats.cycles, dram_bandwidth(&dram));
+    }
+    if (replacementPolicy == CACHE_SHIP) {
+        printf("ship predictions:%lu accuracy:%.2f%% dead:%lu bypasses:%lu bypass_rate:%.2f%%\n", shipStats.predictions, 
+               shipStats.predictions > 0 ? 100.0 * (double)shipStats.correct / (double)shipStats.predictions : 0.0, shipStats.dead, 
+               shipStats.bypasses, cache.stats.misses > 0 ? 100.0 * (double)shipStats.bypasses / (double)cache.stats.misses : 0.0);
+    }
+    if (lifetimesEnabled == 1) {
+        printLifetimes();
+    }
+    printOperations();
+    if (icacheEnabled == 1) {
+        printf("icache hits:%lu misses:%lu evictions:%lu\n", icache.stats.hits, icache.stats.misses, icache.stats.evictions);
+    }
+    printSummary(&cache.stats);
+    saveStatistics();
+    return 0;
+}
+/**
+ * This function processes the user input command line arguments. It checks if verbose mode is enabled, 
+ * if a helper usage message needs to be printed, and the value of the set bit, lines per set, and block bits. 
+ * If the input is invalid, it sets the global variable "quit" to 1, and this global variable will determine if the program should be aborted in the main function. 
+ * The main structure of the function is acquired from the recitation slides of Spring 2022. The site is https://www.cs.cmu.edu/afs/cs/academic/class/15213-s22/www/recitations/rec06_slides.pdf
+*/
+void getArguments(int argc, char ** argv) {
+    int opt;
+    char *left;
+    static struct option longOptions[] = {
+        {"chunks", required_argument, NULL, 'c'},
+        {"format", required_argument, NULL, 'f'},
+        {"icache", required_argument, NULL, 'i'},
+        {"on-error", required_argument, NULL, 'e'},
+        {"filter", required_argument, NULL, 'F'},
+        {"regions", no_argument, NULL, 'r'},
+        {"cold-regions", no_argument, NULL, 'R'},
+        {"sweep", required_argument, NULL, 'w'},
+        {"direct", required_argument, NULL, 'd'},
+        {"out-of-core", required_argument, NULL, 'o'},
+        {"mix", required_argument, NULL, 'm'},
+        {"ways", required_argument, NULL, 'W'},
+        {"translate", required_argument, NULL, 'T'},
+        {"dram", required_argument, NULL, 'D'},
+        {"occupancy", required_argument, NULL, 'O'},
+        {"policy", required_argument, NULL, 'P'},
+        {"lifetimes", no_argument, NULL, 'L'},
+        {NULL, 0, NULL, 0}
+    };
+    while ((opt = getopt_long(argc, argv, "vs:E:b:t:j:h", longOptions, NULL)) != -1) {
+        switch(opt) {
+            case 'v':
+                verbose = 1;
+                break;
+            case 's':
+                setBit = atoi(optarg);
+                break;
+            case 'E':
+                linesPerSet = atoi(optarg);
+                break;
+            case 'b':
+                blockBit = atoi(optarg);
+                break;
+            case 't':
+                if (numTraces == MAXTRACES) {
+                    quit = 1;
+                    break;
+                }
+                if (numTraces == 0) {
+                    strcpy(fileName, optarg);
+                }
+                strncpy(traceNames[numTraces], optarg, FILENAMELENGTH - 1);
+                numTraces++;
+                break;
+            case 'j':
+                traceOptions.threads = atoi(optarg);
+                break;
+            case 'c':
+                traceOptions.first_chunk = strtoul(optarg, &left, 10);
+                if (*left == ':') {
+                    traceOptions.num_chunks = strtoul(left + 1, &left, 10);
+                }
+                if (*left != 0) {
+                    quit = 1;
+                }
+                break;
+            case 'f':
+                if (!trace_format_parse(optarg, &traceOptions.format)) {
+                    quit = 1;
+                }
+                break;
+            case 'i':
+                icacheEnabled = 1;
+                if (sscanf(optarg, "%d:%d:%d", &icacheSetBit, &icacheLinesPerSet, &icacheBlockBit) != 3) {
+                    quit = 1;
+                }
+                break;
+            case 'e':
+                if (strcmp(optarg, "skip") == 0) {
+                    traceOptions.on_error = TRACE_ON_ERROR_SKIP;
+                } else if (strcmp(optarg, "abort") == 0) {
+                    traceOptions.on_error = TRACE_ON_ERROR_ABORT;
+                } else {
+                    quit = 1;
+                }
+                break;
+            case 'F':
+                strncpy(filterName, optarg, FILENAMELENGTH - 1);
+                break;
+            case 'r':
+                regionsEnabled = 1;
+                break;
+            case 'R':
+                regionsEnabled = 1;
+                coldRegions = 1;
+                break;
+            case 'w':
+                sweepEnabled = 1;
+                if (sscanf(optarg, "%d:%d", &sweepSetBit, &sweepLinesPerSet) != 2) {
+                    quit = 1;
+                }
+                break;
+            case 'W':
+                strncpy(partitionName, optarg, FILENAMELENGTH - 1);
+                break;
+            case 'D':
+                dramEnabled = 1;
+                if (parseDram(optarg) == 1) {
+                    quit = 1;
+                }
+                break;
+            case 'T':
+                translateEnabled = 1;
+                left = strchr(optarg, ':');
+                if (left != NULL) {
+                    *left = 0;
+                    if (sscanf(left + 1, "%d", &translatePageBits) != 1) {
+                        quit = 1;
+                    }
+                }
+                if (!translate_parse(optarg, &translateAlloc)) {
+                    quit = 1;
+                }
+                break;
+            case 'O':
+                if (sscanf(optarg, "%lu", &occupancyInterval) != 1 || occupancyInterval == 0) {
+                    quit = 1;
+                }
+                break;
+            case 'L':
+                lifetimesEnabled = 1;
+                break;
+            case 'P':
+                if (parseShip(optarg) == 1 || !cache_policy_parse(optarg, &replacementPolicy)) {
+                    quit = 1;
+                }
+                break;
+            case 'm':
+                if (parseMix(optarg) == 1) {
+                    quit = 1;
+                }
+                break;
+            case 'o':
+                outOfCore = 1;
+                strncpy(outOfCoreDir, optarg, FILENAMELENGTH - 1);
+                left = strrchr(outOfCoreDir, ':');
+                if (left != NULL) {
+                    *left = 0;
+                    if (sscanf(left + 1, "%lu", &outOfCoreBudget) != 1 || outOfCoreBudget == 0) {
+                        quit = 1;
+                    }
+                }
+                break;
+            case 'd':
+                directEnabled = 1;
+                if (parseDirect(optarg) == 1) {
+                    quit = 1;
+                }
+                break;
+            case 'h':
+                printMessage();
+                break;
+            default:
+                quit = 1;
+                printMessage();
+                break;
+        }
+    }
+}
+/**
+ * This function prints out the usage instruction of this simulator if the user inputs invalid command or typed -h in the command. 
+*/
+void printMessage(void) {
+    printf("Usage :  ./csim -ref [-v] -s <s> -E <E> -b <b> -t <trace>\n");
+    printf("./csim -h\n");
+    printf("    -h    Print this help message and exit\n");
+    printf("    -v    Verbose mode: report effects of each memory operation\n");
+    printf("    -s <s>    Number of set index bits (there are 2**s sets\n");
+    printf("    -b <b>    Number of block bits (there are 2**b blocks)\n");
+    printf("    -E <E>    Number of lines per set (associativity)\n");
+    printf("    -t <trace >    File name of the memory trace to process (give it more than once to mix traces in a shared cache)\n");
+    printf("    -j <threads>    Threads parsing or decoding the trace\n");
+    printf("    --chunks <first>[:<count>]    Only simulate these chunks of a binary trace\n");
+    printf("    --format <format>    Trace format: auto, text, lackey, drmemtrace or binary (default auto)\n");
+    printf("    --icache <s>:<E>:<b>    Simulate instruction fetches in a separate instruction cache\n");
+    printf("    --filter <rules>    Include, exclude or remap address ranges before simulating (see filter.h)\n");
+    printf("    --regions    Also report the statistics of every region marked in the trace\n");
+    printf("    --cold-regions    Same, but start every region with an empty cache\n");
+    printf("    --on-error <skip|abort>    Skip malformed trace lines, or stop at the first one (default abort)\n");
+    printf("    --sweep <s>:<E>    Simulate every cache with up to s set bits and E lines per set in one pass\n");
+    printf("    --out-of-core <dir>[:<MiB>]    Keep the cache in files in dir, simulating MiB of it at a time (default 256)\n");
+    printf("    --mix <rr[:n]|ratio:n:n...|time>    How mixed traces are interleaved (default rr)\n");
+    printf("    --translate <seq|random|color>[:<page bits>]    Translate addresses to physical ones, allocating frames on first touch (default 12 page bits)\n");
+    printf("    --dram <default|channels:ranks:banks:row bytes[:order]>    Simulate the DRAM behind the cache (see dram.h)\n");
+    printf("    --ways <rules>    Limit the ways each class of accesses may fill (see partition.h)\n");
+    printf("    --policy <lru|arc|clockpro|tinylfu|ship[:<bits>][:bypass]>    Replacement policy of the data cache (arc, clockpro and tinylfu need -s 0)\n");
+    printf("        ship keys its predictor on 2**bits byte regions (default %d bits), and may bypass blocks predicted dead\n", SHIP_GRANULE_BITS);
+    printf("    --lifetimes    Report histograms of how long evicted lines were resident, how long since their last use, and their hits\n");
+    printf("    --occupancy <n>    Print the lines held by each class or trace every n accesses\n");
+    printf("    --direct <s>:<b>[,<s>:<b>...]    Simulate up to %d direct-mapped caches side by side\n", DM_SWEEP_LANES);
+    printf("Besides L, S and I, text traces may hold M (modify), P (prefetch), F (flush) and N (non-temporal store) operations.\n");
+    printf("The -s, -b, -E, and -t options must be supplied for all simulations (only -b and -t with --sweep, only -t with --direct).\n");
+}
+/**
+ * This function takes the input of a string which should be the user input trace file name. 
+ * The trace file can either be a text trace, where every line is an operation type, an address, and a visited byte number, 
+ * the output of Valgrind Lackey (where a modify 'M' is read as a load followed by a store), an uncompressed DynamoRIO drcachesim trace, 
+ * or a binary trace made by "trace-pack", where the accesses are compressed in chunks. 
+ * The reader in "trace.c" tells them apart by the first bytes of the file, unless the --format option is given. 
+ * The reader checks the validity of every line or chunk and hands out the accesses in batches, in the order of the trace. 
+ * The trace can be parsed by several threads at the same time (the -j option): a text trace is cut into byte ranges, 
+ * and every thread starts its range at the first complete line, while a binary trace is decompressed one chunk per thread. 
+ * The parsed ranges or chunks are given back to this function in their original order. 
+ * For a binary trace, the simulation can start at any chunk and stop after some chunks (the --chunks option), so parts of a huge trace can be simulated without reading the rest. 
+ * If a filter rule file is given, each batch is filtered and remapped by "filter_apply" first, 
+ * and with --translate, the virtual addresses of the batch are then translated to physical ones by "translate_apply". 
+ * Region markers are handled by "regionMarker" and are not simulated. 
+ * The operation type, address, and byte number of every access are then used as parameters to call the function "cacheOperation."
+ * Blank lines and lines starting with '#' are ignored. A line of any other kind that is not a valid access is malformed, 
+ * and the reader prints its line number. With "--on-error skip", malformed lines are skipped and counted, and the number of them is printed at the end. 
+ * Otherwise (the default, "--on-error abort"), the trace stops at the first malformed line. 
+ * Since the lines of the trace files may be invalid or the input file may not exist or failed to open, 
+ * this function will return 1, indicating an error occurred. Otherwise, it will process all accesses of the trace file and finally return 0.
+ * In both cases the trace file is closed before returning.
+*/
+int mainProcess(char *afile) {
+    if (filterName[0] != 0 && !filter_load(&addrFilter, filterName)) {
+        return 1;
+    }
+    trace_reader_t *reader = trace_open(afile, &traceOptions);
+    if (!reader) {
+        printf("Failed open trace file!\n");
+        filter_free(&addrFilter);
+        return 1;
+    }
+    const trace_access_t *batch;
+    trace_access_t *filtered = NULL;
+    size_t filteredSize = 0;
+    size_t count;
+    int result = initTranslator();
+    while (result == 0 && (batch = trace_next(reader, &count))) {
+        if (filterName[0] != 0 || translateEnabled == 1) {
+            if (count > filteredSize) {
+                trace_access_t *grown = realloc(filtered, count * sizeof(*filtered));
+                if (!grown) {
+                    result = 1;
+                    break;
+                }
+                filtered = grown;
+                filteredSize = count;
+            }
+            if (filterName[0] != 0) {
+                count = filter_apply(&addrFilter, batch, count, filtered);
+            } else {
+                memcpy(filtered, batch, count * sizeof(*filtered));
+            }
+            if (translateEnabled == 1 && !translate_apply(&translator, 0, filtered, count)) {
+                printf("Out of physical memory!\n");
+                result = 1;
+                break;
+            }
+            batch = filtered;
+        }
+        if (batchMode == 1) {
+            result = simulateBatch(batch, count);
+            continue;
+        }
+        for (size_t i = 0; i < count; i++) {
+            if (batch[i].op == TRACE_REGION_BEGIN || batch[i].op == TRACE_REGION_END) {
+                if (regionMarker(batch[i].op, batch[i].addr) == 1) {
+                    result = 1;
+                    break;
+                }
+                continue;
+            }
+            if (verbose == 1) {
+                printf("%c %lx,%u ", trace_op_char(batch[i].op), batch[i].addr, batch[i].size);
+            }
+            if (cacheOperation(batch[i].op, batch[i].addr, batch[i].size) == 1) {
+                result = 1;
+                break;
+            }
+        }
+    }
+    free(filtered);
+    translate_free(&translator);
+    free(requests);
+    requests = NULL;
+    requestsSize = 0;
+    filter_free(&addrFilter);
+    size_t errors = trace_errors(reader);
+    if (!trace_close(reader)) {
+        return 1;
+    }
+    if (errors > 0) {
+        fprintf(stderr, "Skipped %zu malformed lines\n", errors);
+    }
+    return result;
+}
@@ -0,0 +1,144 @@
+/**
+ * @file ct-src.c
+ * @brief Portable tracing runtime for tracegen-src
+ *
+ * tracegen-ct gets its trace from the CT instrumentation pass, which only
+ * exists as a prebuilt plugin for LLVM 7. tracegen-src is the same driver
+ * (tracegen-ct.c) linked with this runtime instead, and with a trans.c
+ * built with -DCACHELAB_TRACE_SRC, whose TRANS_LD()/TRANS_ST() accessors
+ * record every access to A, B and tmp straight into an in-memory buffer.
+ *
+ * The buffer holds 8-byte words in the encoding of the CT runtime (address
+ * in the low 50 bits, store flag at bit 58, log2 of the size at bit 59),
+ * and the CT entry points that tracegen-ct.c uses to add region markers
+ * work on the same buffer. Full buffers and the buffer of each region of
+ * interest are written out as a text trace, to $CONTECH_TRACE or
+ * default.trace, in the same format as the CT runtime.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define CACHELAB_TRACE_SRC
+#include "cachelab.h"
+
+/** @brief Words in the trace buffer */
+#define CT_SRC_WORDS (1 << 17)
+
+/** @brief Room left for instrumented code before a buffer is handed off */
+#define CT_SRC_SLACK_BYTES 1024
+
+/**
+ * @brief The trace buffer, shaped like the CT runtime's serial buffer
+ */
+typedef struct {
+    unsigned int pos; /* bytes used, kept up to date for __ctGetBufferPos */
+    uint64_t data[CT_SRC_WORDS];
+} ct_src_buffer_t;
+
+static ct_src_buffer_t buffer;
+static bool roi_active;
+static FILE *trace_file;
+
+uint64_t *__ctSrcPos = buffer.data;
+uint64_t *__ctSrcEnd = buffer.data;
+
+/* Entry point of the traced program (tracegen-ct.c) */
+extern int entry(int argc, char *argv[]);
+
+/**
+ * @brief Writes out the recorded accesses and empties the buffer.
+ *
+ * Outside a region of interest the end pointer equals the start of the
+ * buffer, so stray accesses come here and are dropped.
+ */
+void __ctSrcFlush(void) {
+    uint64_t *end = __ctSrcPos;
+    if (roi_active && trace_file != NULL) {
+        for (uint64_t *p = buffer.data; p < end; p++) {
+            uint64_t w = *p;
+            fprintf(trace_file, "%c %llx,%d\n", (w >> 58) & 1 ? 'S' : 'L',
+                    (unsigned long long)(w & 0x3ffffffffffffULL),
+                    1 << ((w >> 59) & 7));
+        }
+    }
+    __ctSrcPos = buffer.data;
+    __ctSrcEnd = roi_active ? buffer.data + CT_SRC_WORDS : buffer.data;
+    buffer.pos = 0;
+}
+
+/*
+ * Entry points of the CT runtime
+ */
+
+void __roi_begin(void) {
+    __ctSrcFlush();
+    roi_active = true;
+    __ctSrcEnd = buffer.data + CT_SRC_WORDS;
+}
+
+void __roi_end(void) {
+    __ctSrcFlush();
+    roi_active = false;
+    __ctSrcEnd = buffer.data;
+}
+
+void *__ctGetBuffer(void) {
+    if (!roi_active)
+        return NULL;
+    buffer.pos = (unsigned int)((char *)__ctSrcPos - (char *)buffer.data);
+    return &buffer;
+}
+
+unsigned int __ctGetBufferPos(void *buf) {
+    return ((ct_src_buffer_t *)buf)->pos;
+}
+
+void __ctCheckBufferSize(unsigned int pos) {
+    if (pos > sizeof(buffer.data) - CT_SRC_SLACK_BYTES)
+        __ctSrcFlush();
+}
+
+char *__ctStoreBasicBlock(unsigned int id, unsigned int pos, void *buf) {
+    return (char *)((ct_src_buffer_t *)buf)->data + pos;
+}
+
+void __ctStoreMemOp(void *addr, char isWrite, unsigned int sizeLog2,
+                    unsigned int index, char *base) {
+    uint64_t w = ((uint64_t)(uintptr_t)addr & 0x3ffffffffffffULL) |
+                 (uint64_t)(isWrite & 1) << 58 | (uint64_t)(sizeLog2 & 7)
+                                                     << 59;
+    ((uint64_t *)(void *)base)[index] = w;
+}
+
+unsigned int __ctStoreBasicBlockComplete(unsigned int numOps, unsigned int pos,
+                                         void *buf) {
+    ct_src_buffer_t *b = buf;
+    b->pos = numOps * 8 + pos;
+    __ctSrcPos = b->data + b->pos / 8;
+    return b->pos;
+}
+
+/**
+ * @brief Main routine: opens the trace and runs the traced program.
+ */
+int main(int argc, char *argv[]) {
+    const char *path = getenv("CONTECH_TRACE");
+    if (path == NULL)
+        path = "default.trace";
+    trace_file = fopen(path, "w");
+    if (trace_file == NULL) {
+        fprintf(stderr, "Failure to open trace file for writing.\n");
+        return 1;
+    }
+
+    int status = entry(argc, argv);
+    __ctSrcFlush();
+    if (fclose(trace_file) != 0 && status == 0)
+        status = 1;
+    return status;
+}
@@ -0,0 +1,179 @@
+/**
+ * @file dram.c
+ * @brief Open-page DRAM model behind the simulated cache
+ *
+ * Timing is kept per bank (the cycle the bank can take its next command)
+ * and per channel (the cycle its data bus is free). An access starts when
+ * its bank is ready, spends tRP closing the open row on a conflict and
+ * tRCD opening the new row unless it hits, and then issues its column
+ * command, whose data follows tCL later and takes tBURST cycles on the
+ * channel's bus; the column command is delayed as needed for the bus to
+ * be free. Column commands to an open row are pipelined, one every
+ * tBURST cycles, so streaming through a row runs at the full bus rate.
+ * Refresh, write-to-read turnaround and the rank-level limits on
+ * activations are not modeled.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "dram.h"
+
+/** @brief Field letters, in the order of dram_t.shift */
+static const char dram_fields[DRAM_FIELDS + 1] = "rkbhc";
+
+/**
+ * @brief Fills in a default configuration.
+ *
+ * One channel of DDR4-3200 (1600 MHz, 22-22-22) with 2 ranks of 16 banks
+ * and 8 KiB rows, mapped row:rank:bank:channel:column.
+ */
+void dram_default_config(dram_config_t *config) {
+    memset(config, 0, sizeof(*config));
+    config->channels = 1;
+    config->ranks = 2;
+    config->banks = 16;
+    config->row_bytes = 8192;
+    strcpy(config->order, "rkbhc");
+    config->tCL = 22;
+    config->tRCD = 22;
+    config->tRP = 22;
+    config->tBURST = 4;
+    config->clock_mhz = 1600.0;
+}
+
+static bool power_of_two(unsigned long x) {
+    return x != 0 && (x & (x - 1)) == 0;
+}
+
+static int log2_of(unsigned long x) {
+    int bits = 0;
+    while (x >>= 1)
+        bits++;
+    return bits;
+}
+
+/**
+ * @brief Creates a DRAM model.
+ *
+ * @param[out] dram       The model to initialize
+ * @param[in]  config     Its geometry and timing
+ * @param[in]  line_bits  log2 of the block size of the cache
+ *
+ * @return True on success, false if the configuration is invalid or the
+ * memory could not be allocated
+ */
+bool dram_init(dram_t *dram, const dram_config_t *config, int line_bits) {
+    memset(dram, 0, sizeof(*dram));
+    if (!power_of_two(config->channels) || !power_of_two(config->ranks) ||
+        !power_of_two(config->banks) || !power_of_two(config->row_bytes) ||
+        config->row_bytes < (1UL << line_bits) ||
+        strlen(config->order) != DRAM_FIELDS)
+        return false;
+    dram->config = *config;
+    dram->line_bits = line_bits;
+
+    int bits[DRAM_FIELDS] = {
+        0, /* rows take all the bits left */
+        log2_of(config->ranks),
+        log2_of(config->banks),
+        log2_of(config->channels),
+        log2_of(config->row_bytes) - line_bits,
+    };
+    int shift = 0;
+    bool seen[DRAM_FIELDS] = {false};
+    for (int i = DRAM_FIELDS - 1; i >= 0; i--) {
+        const char *f = strchr(dram_fields, config->order[i]);
+        if (f == NULL || config->order[i] == '\0' || seen[f - dram_fields])
+            return false;
+        int field = (int)(f - dram_fields);
+        seen[field] = true;
+        dram->shift[field] = shift;
+        dram->mask[field] = field == 0 ? ~0UL : (1UL << bits[field]) - 1;
+        shift += bits[field];
+    }
+    if (dram->shift[0] != shift)
+        return false; /* the row field must come first */
+
+    size_t banks = (size_t)config->channels * config->ranks * config->banks;
+    dram->open_row = calloc(banks, sizeof(*dram->open_row));
+    dram->bank_ready = calloc(banks, sizeof(*dram->bank_ready));
+    dram->bus_free = calloc(config->channels, sizeof(*dram->bus_free));
+    if (dram->open_row == NULL || dram->bank_ready == NULL ||
+        dram->bus_free == NULL) {
+        dram_free(dram);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Releases the memory held by a DRAM model.
+ */
+void dram_free(dram_t *dram) {
+    free(dram->open_row);
+    free(dram->bank_ready);
+    free(dram->bus_free);
+    dram->open_row = NULL;
+    dram->bank_ready = NULL;
+    dram->bus_free = NULL;
+}
+
+static unsigned long field_of(const dram_t *dram, unsigned long line,
+                              int field) {
+    return (line >> dram->shift[field]) & dram->mask[field];
+}
+
+/**
+ * @brief Reads or writes the block holding an address.
+ */
+void dram_access(dram_t *dram, unsigned long addr, bool write) {
+    const dram_config_t *config = &dram->config;
+    unsigned long line = addr >> dram->line_bits;
+    unsigned long row = field_of(dram, line, 0);
+    unsigned long channel = field_of(dram, line, 3);
+    size_t bank = ((size_t)channel * config->ranks + field_of(dram, line, 1)) *
+                      config->banks +
+                  field_of(dram, line, 2);
+
+    if (write)
+        dram->stats.writes++;
+    else
+        dram->stats.reads++;
+
+    unsigned long cas = dram->bank_ready[bank];
+    if (dram->open_row[bank] == row + 1) {
+        dram->stats.row_hits++;
+    } else if (dram->open_row[bank] == 0) {
+        dram->stats.row_misses++;
+        cas += config->tRCD;
+    } else {
+        dram->stats.row_conflicts++;
+        cas += config->tRP + config->tRCD;
+    }
+    dram->open_row[bank] = row + 1;
+
+    unsigned long data = cas + config->tCL;
+    if (data < dram->bus_free[channel])
+        data = dram->bus_free[channel];
+    unsigned long done = data + config->tBURST;
+    dram->bus_free[channel] = done;
+    dram->bank_ready[bank] = data - config->tCL + config->tBURST;
+    if (done > dram->stats.cycles)
+        dram->stats.cycles = done;
+}
+
+/**
+ * @brief Returns the bandwidth reached by the traffic so far, in GB/s.
+ */
+double dram_bandwidth(const dram_t *dram) {
+    if (dram->stats.cycles == 0)
+        return 0.0;
+    double bytes = (double)((dram->stats.reads + dram->stats.writes)
+                            << dram->line_bits);
+    double seconds =
+        (double)dram->stats.cycles / (dram->config.clock_mhz * 1e6);
+    return bytes / seconds / 1e9;
+}
@@ -0,0 +1,86 @@
+/**
+ * @file dram.h
+ * @brief Open-page DRAM model behind the simulated cache
+ *
+ * Every miss reads its block from DRAM and every dirty eviction writes one
+ * back. The block address is cut into channel, rank, bank, row and column
+ * fields in a configurable order, and each bank keeps its row buffer open
+ * after an access, so an access is a row hit (the row is open), a row miss
+ * (the bank has no open row) or a row conflict (another row is open and has
+ * to be closed first).
+ *
+ * Requests are issued back to back in trace order, as fast as banks and
+ * data buses allow, which gives the time the traffic needs at best: the
+ * bandwidth-limited completion time of the cache's DRAM traffic.
+ */
+
+#ifndef DRAM_H
+#define DRAM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/** @brief Number of address fields of the mapping */
+#define DRAM_FIELDS 5
+
+/**
+ * @brief Geometry and timing of the DRAM, timings in DRAM clock cycles
+ */
+typedef struct {
+    unsigned int channels;   /* independent channels, a power of two */
+    unsigned int ranks;      /* ranks per channel, a power of two */
+    unsigned int banks;      /* banks per rank, a power of two */
+    unsigned long row_bytes; /* bytes of a row buffer, a power of two */
+    char order[DRAM_FIELDS + 1]; /* fields from the most to the least
+                                    significant address bits: r(ow),
+                                    k (rank), b(ank), h (channel) and
+                                    c(olumn), e.g. "rkbhc" */
+    unsigned int tCL;        /* column access to data */
+    unsigned int tRCD;       /* row activation to column access */
+    unsigned int tRP;        /* precharge (closing a row) */
+    unsigned int tBURST;     /* data bus cycles per block */
+    double clock_mhz;        /* DRAM clock */
+} dram_config_t;
+
+/**
+ * @brief Statistics of the DRAM traffic
+ */
+typedef struct {
+    unsigned long reads;         /* blocks read for misses */
+    unsigned long writes;        /* blocks written back */
+    unsigned long row_hits;      /* accesses to the open row */
+    unsigned long row_misses;    /* accesses to a bank with no open row */
+    unsigned long row_conflicts; /* accesses that had to close a row */
+    unsigned long cycles;        /* completion time of all the traffic */
+} dram_stats_t;
+
+/**
+ * @brief State of the DRAM model
+ */
+typedef struct {
+    dram_config_t config;
+    int line_bits;               /* log2 of the block size */
+    int shift[DRAM_FIELDS];      /* first bit of each field, as in "rkbhc" */
+    unsigned long mask[DRAM_FIELDS];
+    unsigned long *open_row;     /* per bank: open row + 1, 0 if closed */
+    unsigned long *bank_ready;   /* per bank: cycle it can start a command */
+    unsigned long *bus_free;     /* per channel: cycle its data bus is free */
+    dram_stats_t stats;
+} dram_t;
+
+/** @brief Fills in the default geometry (1:2:16:8192, "rkbhc") and timing */
+void dram_default_config(dram_config_t *config);
+
+/** @brief Creates a DRAM model for blocks of 2**line_bits bytes */
+bool dram_init(dram_t *dram, const dram_config_t *config, int line_bits);
+
+/** @brief Releases the memory held by a DRAM model */
+void dram_free(dram_t *dram);
+
+/** @brief Reads or writes the block holding an address */
+void dram_access(dram_t *dram, unsigned long addr, bool write);
+
+/** @brief Returns the bandwidth reached, in GB/s */
+double dram_bandwidth(const dram_t *dram);
+
+#endif /* DRAM_H */
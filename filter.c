@@ -0,0 +1,174 @@
+/**
+ * @file filter.c
+ * @brief Address filtering and remapping between trace reader and simulator
+ *
+ * Rules are applied to a batch in blocks of FILTER_BLOCK accesses. The
+ * addresses of a block are first copied into a local array, and each rule
+ * then runs as one branch-free loop over that array, which the compiler
+ * can vectorize; the kept accesses are compacted into the output last.
+ * Region markers are passed through untouched.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "filter.h"
+
+/** @brief Accesses per block of filter_apply() */
+#define FILTER_BLOCK 256
+
+/** @brief Longest line of a rule file */
+#define FILTER_LINE 256
+
+static bool add_range(filter_range_t **ranges, size_t *num,
+                      const filter_range_t *range) {
+    filter_range_t *grown = realloc(*ranges, (*num + 1) * sizeof(**ranges));
+    if (grown == NULL)
+        return false;
+    grown[(*num)++] = *range;
+    *ranges = grown;
+    return true;
+}
+
+static bool parse_number(char **p, unsigned long *value) {
+    char *end;
+    *value = strtoul(*p, &end, 0);
+    if (end == *p)
+        return false;
+    *p = end;
+    return true;
+}
+
+/**
+ * @brief Loads a filter from a rule file.
+ *
+ * @param[out] filter  The filter to fill in
+ * @param[in]  path    The rule file
+ *
+ * @return True on success; false with an error message printed otherwise.
+ */
+bool filter_load(addr_filter_t *filter, const char *path) {
+    memset(filter, 0, sizeof(*filter));
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL) {
+        perror(path);
+        return false;
+    }
+
+    char line[FILTER_LINE];
+    unsigned long lineno = 0;
+    bool ok = true;
+    while (ok && fgets(line, sizeof(line), fp) != NULL) {
+        lineno++;
+        char *hash = strchr(line, '#');
+        if (hash != NULL)
+            *hash = '\0';
+
+        char kind[16];
+        int used;
+        if (sscanf(line, " %15s%n", kind, &used) != 1)
+            continue;
+
+        char *p = line + used;
+        unsigned long lo, hi;
+        filter_range_t range = {0};
+        ok = parse_number(&p, &lo) && parse_number(&p, &hi) && lo < hi;
+        range.lo = lo;
+        range.len = hi - lo;
+        if (ok && strcmp(kind, "include") == 0)
+            ok = add_range(&filter->include, &filter->num_include, &range);
+        else if (ok && strcmp(kind, "exclude") == 0)
+            ok = add_range(&filter->exclude, &filter->num_exclude, &range);
+        else if (ok && strcmp(kind, "remap") == 0)
+            ok = parse_number(&p, &range.base) &&
+                 add_range(&filter->remap, &filter->num_remap, &range);
+        else
+            ok = false;
+        while (ok && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n'))
+            p++;
+        if (ok && *p != '\0')
+            ok = false;
+    }
+    fclose(fp);
+
+    if (!ok) {
+        fprintf(stderr, "%s:%lu: invalid filter rule\n", path, lineno);
+        filter_free(filter);
+    }
+    return ok;
+}
+
+/**
+ * @brief Releases the rules of a filter.
+ */
+void filter_free(addr_filter_t *filter) {
+    free(filter->include);
+    free(filter->exclude);
+    free(filter->remap);
+    memset(filter, 0, sizeof(*filter));
+}
+
+/**
+ * @brief Filters and remaps a batch of accesses.
+ *
+ * @param[in]  filter  The filter
+ * @param[in]  in      The batch
+ * @param[in]  count   Number of accesses in the batch
+ * @param[out] out     Room for count accesses; may be the same as in
+ *
+ * @return The number of accesses kept in out
+ */
+size_t filter_apply(const addr_filter_t *filter, const trace_access_t *in,
+                    size_t count, trace_access_t *out) {
+    unsigned long addr[FILTER_BLOCK];
+    unsigned long moved[FILTER_BLOCK];
+    unsigned char keep[FILTER_BLOCK];
+    unsigned char done[FILTER_BLOCK];
+    unsigned char marker[FILTER_BLOCK];
+    size_t kept = 0;
+
+    for (size_t start = 0; start < count; start += FILTER_BLOCK) {
+        size_t n = count - start < FILTER_BLOCK ? count - start : FILTER_BLOCK;
+        for (size_t i = 0; i < n; i++) {
+            addr[i] = in[start + i].addr;
+            moved[i] = addr[i];
+            marker[i] = in[start + i].op == TRACE_REGION_BEGIN ||
+                        in[start + i].op == TRACE_REGION_END;
+            keep[i] = filter->num_include == 0;
+            done[i] = marker[i];
+        }
+
+        for (size_t r = 0; r < filter->num_include; r++) {
+            const filter_range_t *rule = &filter->include[r];
+            for (size_t i = 0; i < n; i++)
+                keep[i] |= addr[i] - rule->lo < rule->len;
+        }
+        for (size_t r = 0; r < filter->num_exclude; r++) {
+            const filter_range_t *rule = &filter->exclude[r];
+            for (size_t i = 0; i < n; i++)
+                keep[i] &= addr[i] - rule->lo >= rule->len;
+        }
+        for (size_t i = 0; i < n; i++)
+            keep[i] |= marker[i];
+        for (size_t r = 0; r < filter->num_remap; r++) {
+            const filter_range_t *rule = &filter->remap[r];
+            unsigned long offset = rule->base - rule->lo;
+            for (size_t i = 0; i < n; i++) {
+                unsigned char hit =
+                    (addr[i] - rule->lo < rule->len) & (done[i] ^ 1);
+                moved[i] += offset & (0UL - hit);
+                done[i] |= hit;
+            }
+        }
+
+        for (size_t i = 0; i < n; i++) {
+            out[kept] = in[start + i];
+            out[kept].addr = moved[i];
+            kept += keep[i];
+        }
+    }
+    return kept;
+}
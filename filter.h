@@ -0,0 +1,56 @@
+/**
+ * @file filter.h
+ * @brief Address filtering and remapping between trace reader and simulator
+ *
+ * A filter is loaded from a small text file with one rule per line:
+ *
+ *   include <lo> <hi>          keep only accesses in [lo, hi)
+ *   exclude <lo> <hi>          drop accesses in [lo, hi)
+ *   remap <lo> <hi> <base>     move accesses in [lo, hi) to base + (addr - lo)
+ *
+ * Numbers may be decimal or 0x-prefixed hex; '#' starts a comment. If there
+ * are include rules, an access must match one of them to be kept. Excludes
+ * are applied next, and then the first matching remap. Ranges are tested
+ * against the original address.
+ */
+
+#ifndef FILTER_H
+#define FILTER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "trace.h"
+
+/**
+ * @brief An address range of a filter rule
+ */
+typedef struct {
+    unsigned long lo;   /* first address of the range */
+    unsigned long len;  /* bytes in the range */
+    unsigned long base; /* new address of lo, for remaps */
+} filter_range_t;
+
+/**
+ * @brief The rules of a filter, grouped by kind
+ */
+typedef struct {
+    filter_range_t *include;
+    size_t num_include;
+    filter_range_t *exclude;
+    size_t num_exclude;
+    filter_range_t *remap;
+    size_t num_remap;
+} addr_filter_t;
+
+/** @brief Loads a filter from a rule file */
+bool filter_load(addr_filter_t *filter, const char *path);
+
+/** @brief Releases the rules of a filter */
+void filter_free(addr_filter_t *filter);
+
+/** @brief Filters and remaps a batch of accesses into out */
+size_t filter_apply(const addr_filter_t *filter, const trace_access_t *in,
+                    size_t count, trace_access_t *out);
+
+#endif /* FILTER_H */
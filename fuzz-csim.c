@@ -0,0 +1,966 @@
+/**
+ * @file fuzz-csim.c
+ * @brief Differential fuzzer for the cache engine
+ *
+ * Runs the flat-array engine in cache.c side by side with a slow reference
+ * model, which is the original linked-list implementation of csim: one
+ * doubly-linked list per set, ordered from least to most recently used,
+ * with a node allocated for every fill. Every field of csim_stats_t is
+ * compared after every access, and any difference aborts with the failing
+ * configuration and trace.
+ *
+ * The other checks cost several times as much per access, so they run on
+ * one case in full_every only: every case under libFuzzer, and one in
+ * FULL_EVERY by default when standalone (see -f), which keeps the LRU
+ * check at millions of cases per minute. On those cases the trace also
+ * runs through a sweep over all the geometries of the fuzzer (sweep.c),
+ * whose hits, misses and evictions for the case's geometry must match at
+ * the end. Direct-mapped cases also run through a direct-mapped sweep,
+ * next to lanes of other geometries, whose full statistics must match as
+ * well. So must those of a cache with way masks that allow every way,
+ * which takes the masked fill and victim paths of the engine.
+ *
+ * Two more passes follow on those cases. The first runs the trace through
+ * a fully associative cache of E lines under ARC (adaptive.c), checked
+ * after every access against a reference ARC that keeps its four lists as
+ * plain arrays and follows the pseudocode of the paper line by line, and
+ * under CLOCK-Pro and W-TinyLFU, whose statistics must stay consistent:
+ * every access a hit or a miss, at most E blocks resident, and the dirty
+ * bytes accounted for. So must those of the case's geometry under SHiP
+ * (ship.c), with and without bypass.
+ *
+ * The second runs the same trace with some accesses turned into the
+ * other operations of the engine (modifies, prefetches, flushes and
+ * non-temporal stores), picked from the bytes of each access. LRU caches
+ * with and without way masks must match the reference model, which drops
+ * the node of an invalidated block, after every access; ARC, CLOCK-Pro,
+ * W-TinyLFU and SHiP with bypass must stay consistent.
+ *
+ * One fully checked case in BATCH_EVERY also replays its accesses, spread
+ * over more sets, through a cache of over 1 MiB in batches long enough for
+ * cache_access_batch() to group them by set. Its statistics, dirty bytes
+ * included, must match those of the same requests given one at a time.
+ *
+ * Each fuzz input encodes one test case:
+ *
+ *   byte 0      s (mod 8)
+ *   byte 1      b (mod 7)
+ *   byte 2      E - 1 (mod 24)
+ *   4n bytes    one access each: bit 0 of the first byte selects a store,
+ *               the rest of the first byte is a shift applied to the 24-bit
+ *               address held in the other three bytes
+ *
+ * Built with -DFUZZ_LIBFUZZER this file is a libFuzzer target. Otherwise
+ * it is a standalone program that generates random cases in a loop.
+ */
+
+#define _GNU_SOURCE
+
+#include <getopt.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "cache.h"
+#include "ship.h"
+#include "sweep.h"
+#include "cachelab.h"
+
+/** @brief Bytes of input before the first access */
+#define HEADER_BYTES 3
+
+/** @brief Bytes of input per access */
+#define ACCESS_BYTES 4
+
+/** @brief Cases per fully checked case when run standalone */
+#define FULL_EVERY 32
+
+/** @brief Every check runs on one case in this many, the others check LRU */
+static unsigned long full_every = 1;
+
+/** @brief Number of cases run so far */
+static unsigned long case_number;
+
+/**
+ * @brief A line of the reference model
+ */
+typedef struct ref_node {
+    struct ref_node *next;
+    struct ref_node *prev;
+    unsigned long tag;
+    bool dirty;
+} ref_node_t;
+
+/**
+ * @brief A set of the reference model, with placeholder head and tail nodes
+ */
+typedef struct {
+    ref_node_t head;
+    ref_node_t tail;
+} ref_set_t;
+
+/**
+ * @brief The reference model of a whole cache
+ */
+typedef struct {
+    int s;
+    int E;
+    int b;
+    ref_set_t *sets;
+    csim_stats_t stats;
+} ref_cache_t;
+
+static bool ref_init(ref_cache_t *ref, int s, int E, int b) {
+    unsigned long num_sets = 1UL << s;
+    memset(ref, 0, sizeof(*ref));
+    ref->s = s;
+    ref->E = E;
+    ref->b = b;
+    ref->sets = malloc(num_sets * sizeof(*ref->sets));
+    if (ref->sets == NULL)
+        return false;
+    for (unsigned long i = 0; i < num_sets; i++) {
+        ref->sets[i].head.next = &ref->sets[i].tail;
+        ref->sets[i].tail.prev = &ref->sets[i].head;
+    }
+    return true;
+}
+
+static void ref_free(ref_cache_t *ref) {
+    unsigned long num_sets = 1UL << ref->s;
+    for (unsigned long i = 0; i < num_sets; i++) {
+        ref_node_t *curr = ref->sets[i].head.next;
+        while (curr != &ref->sets[i].tail) {
+            ref_node_t *next = curr->next;
+            free(curr);
+            curr = next;
+        }
+    }
+    free(ref->sets);
+}
+
+static void ref_unlink(ref_node_t *n) {
+    n->prev->next = n->next;
+    n->next->prev = n->prev;
+}
+
+static void ref_add_last(ref_set_t *set, ref_node_t *n) {
+    n->prev = set->tail.prev;
+    n->next = &set->tail;
+    set->tail.prev->next = n;
+    set->tail.prev = n;
+}
+
+/**
+ * @brief Simulates one access in the reference model.
+ *
+ * This follows the original cacheOperation() of csim step by step: count
+ * the lines of the set, walk the list for a match, and on a miss in a full
+ * set free the node after the head.
+ */
+static void ref_access(ref_cache_t *ref, unsigned long addr, bool store) {
+    unsigned long tag = addr >> (ref->s + ref->b);
+    unsigned long index = (addr >> ref->b) & ((1UL << ref->s) - 1);
+    unsigned long bytes = 1UL << ref->b;
+    ref_set_t *set = &ref->sets[index];
+
+    int size = 0;
+    ref_node_t *hit = NULL;
+    for (ref_node_t *n = set->head.next; n != &set->tail; n = n->next) {
+        size++;
+        if (hit == NULL && n->tag == tag)
+            hit = n;
+    }
+
+    if (hit != NULL) {
+        ref->stats.hits++;
+        if (store && !hit->dirty) {
+            hit->dirty = true;
+            ref->stats.dirty_bytes += bytes;
+        }
+        ref_unlink(hit);
+        ref_add_last(set, hit);
+        return;
+    }
+
+    ref->stats.misses++;
+    if (size == ref->E) {
+        ref_node_t *victim = set->head.next;
+        ref->stats.evictions++;
+        if (victim->dirty) {
+            ref->stats.dirty_evictions += bytes;
+            ref->stats.dirty_bytes -= bytes;
+        }
+        ref_unlink(victim);
+        free(victim);
+    }
+
+    ref_node_t *n = malloc(sizeof(*n));
+    if (n == NULL) {
+        fprintf(stderr, "Error: out of memory\n");
+        abort();
+    }
+    n->tag = tag;
+    n->dirty = store;
+    if (store)
+        ref->stats.dirty_bytes += bytes;
+    ref_add_last(set, n);
+}
+
+/**
+ * @brief Drops the node of a block from the reference model, if any.
+ *
+ * @return True if the block was cached
+ */
+static bool ref_invalidate(ref_cache_t *ref, unsigned long addr) {
+    unsigned long tag = addr >> (ref->s + ref->b);
+    unsigned long index = (addr >> ref->b) & ((1UL << ref->s) - 1);
+    ref_set_t *set = &ref->sets[index];
+    for (ref_node_t *n = set->head.next; n != &set->tail; n = n->next) {
+        if (n->tag == tag) {
+            if (n->dirty)
+                ref->stats.dirty_bytes -= 1UL << ref->b;
+            ref_unlink(n);
+            free(n);
+            return true;
+        }
+    }
+    return false;
+}
+
+/** @brief Largest list of the reference ARC: at most 2E <= 48 entries */
+#define REF_ARC_MAX 48
+
+/**
+ * @brief One of the lists of the reference ARC, most recently used first
+ */
+typedef struct {
+    unsigned long block[REF_ARC_MAX];
+    bool dirty[REF_ARC_MAX];
+    int size;
+} ref_list_t;
+
+/**
+ * @brief The reference ARC: lists T1, T2, B1, B2 and the target p
+ */
+typedef struct {
+    int c;
+    int b;
+    ref_list_t t1, t2, b1, b2;
+    int p;
+    csim_stats_t stats;
+} ref_arc_t;
+
+static int ref_find(const ref_list_t *l, unsigned long block) {
+    for (int i = 0; i < l->size; i++) {
+        if (l->block[i] == block)
+            return i;
+    }
+    return -1;
+}
+
+/** @brief Removes entry i of a list, returning whether it was dirty */
+static bool ref_take(ref_list_t *l, int i) {
+    bool dirty = l->dirty[i];
+    memmove(l->block + i, l->block + i + 1,
+            (size_t)(l->size - i - 1) * sizeof(*l->block));
+    memmove(l->dirty + i, l->dirty + i + 1,
+            (size_t)(l->size - i - 1) * sizeof(*l->dirty));
+    l->size--;
+    return dirty;
+}
+
+static void ref_push(ref_list_t *l, unsigned long block, bool dirty) {
+    memmove(l->block + 1, l->block, (size_t)l->size * sizeof(*l->block));
+    memmove(l->dirty + 1, l->dirty, (size_t)l->size * sizeof(*l->dirty));
+    l->block[0] = block;
+    l->dirty[0] = dirty;
+    l->size++;
+}
+
+/** @brief Evicts the LRU block of from into the ghost list to */
+static void ref_arc_evict(ref_arc_t *arc, ref_list_t *from, ref_list_t *to) {
+    unsigned long block = from->block[from->size - 1];
+    arc->stats.evictions++;
+    if (ref_take(from, from->size - 1)) {
+        arc->stats.dirty_evictions += 1UL << arc->b;
+        arc->stats.dirty_bytes -= 1UL << arc->b;
+    }
+    if (to != NULL)
+        ref_push(to, block, false);
+}
+
+/** @brief REPLACE(x, p) of the paper */
+static void ref_arc_replace(ref_arc_t *arc, bool in_b2) {
+    if (arc->t1.size >= 1 &&
+        ((in_b2 && arc->t1.size == arc->p) || arc->t1.size > arc->p))
+        ref_arc_evict(arc, &arc->t1, &arc->b1);
+    else
+        ref_arc_evict(arc, &arc->t2, &arc->b2);
+}
+
+/**
+ * @brief Simulates one access in the reference ARC, cases I to IV of the
+ * paper.
+ */
+static void ref_arc_access(ref_arc_t *arc, unsigned long addr, bool store) {
+    unsigned long block = addr >> arc->b;
+    unsigned long bytes = 1UL << arc->b;
+    int c = arc->c;
+    int i;
+
+    if ((i = ref_find(&arc->t1, block)) >= 0 ||
+        (i = ref_find(&arc->t2, block)) >= 0) {
+        ref_list_t *l = ref_find(&arc->t1, block) >= 0 ? &arc->t1 : &arc->t2;
+        bool dirty = ref_take(l, i);
+        arc->stats.hits++;
+        if (store && !dirty)
+            arc->stats.dirty_bytes += bytes;
+        ref_push(&arc->t2, block, dirty || store);
+        return;
+    }
+
+    arc->stats.misses++;
+    if ((i = ref_find(&arc->b1, block)) >= 0) {
+        int delta = arc->b1.size >= arc->b2.size
+                        ? 1
+                        : arc->b2.size / arc->b1.size;
+        arc->p = arc->p + delta < c ? arc->p + delta : c;
+        ref_arc_replace(arc, false);
+        ref_take(&arc->b1, ref_find(&arc->b1, block));
+        ref_push(&arc->t2, block, store);
+    } else if ((i = ref_find(&arc->b2, block)) >= 0) {
+        int delta = arc->b2.size >= arc->b1.size
+                        ? 1
+                        : arc->b1.size / arc->b2.size;
+        arc->p = arc->p - delta > 0 ? arc->p - delta : 0;
+        ref_arc_replace(arc, true);
+        ref_take(&arc->b2, ref_find(&arc->b2, block));
+        ref_push(&arc->t2, block, store);
+    } else {
+        int l1 = arc->t1.size + arc->b1.size;
+        int total = l1 + arc->t2.size + arc->b2.size;
+        if (l1 == c) {
+            if (arc->t1.size < c) {
+                ref_take(&arc->b1, arc->b1.size - 1);
+                ref_arc_replace(arc, false);
+            } else {
+                ref_arc_evict(arc, &arc->t1, NULL);
+            }
+        } else if (total >= c) {
+            if (total == 2 * c)
+                ref_take(&arc->b2, arc->b2.size - 1);
+            ref_arc_replace(arc, false);
+        }
+        ref_push(&arc->t1, block, store);
+    }
+    if (store)
+        arc->stats.dirty_bytes += bytes;
+}
+
+/**
+ * @brief Operations of the second pass
+ */
+typedef enum {
+    OP_ACCESS,   /* the load or store of the input */
+    OP_MODIFY,   /* cache_modify() */
+    OP_PREFETCH, /* cache_prefetch() */
+    OP_FLUSH,    /* cache_flush_block() */
+    OP_NT_STORE, /* cache_nt_store() */
+} fuzz_op_t;
+
+/**
+ * @brief Picks the operation of an access in the second pass: one in four
+ * is not a plain load or store.
+ */
+static fuzz_op_t pick_op(const uint8_t *p, size_t i) {
+    unsigned int pick = (p[1] ^ p[2] ^ (unsigned int)(i * 37)) % 16;
+    return pick < 12 ? OP_ACCESS : (fuzz_op_t)(pick - 11);
+}
+
+static char op_char(fuzz_op_t op, bool store) {
+    static const char chars[] = "LMPFN";
+    return op == OP_ACCESS && store ? 'S' : chars[op];
+}
+
+/**
+ * @brief Runs one operation of the second pass on the engine.
+ */
+static void run_op(cache_t *cache, fuzz_op_t op, unsigned long addr,
+                   bool store) {
+    switch (op) {
+    case OP_MODIFY:
+        cache_modify(cache, addr);
+        break;
+    case OP_PREFETCH:
+        cache_prefetch(cache, addr);
+        break;
+    case OP_FLUSH:
+        cache_flush_block(cache, addr);
+        break;
+    case OP_NT_STORE:
+        cache_nt_store(cache, addr);
+        break;
+    default:
+        cache_access(cache, addr, store);
+        break;
+    }
+}
+
+/**
+ * @brief Runs one operation of the second pass on the reference model.
+ *
+ * @return True if the operation invalidated a cached block
+ */
+static bool ref_run_op(ref_cache_t *ref, fuzz_op_t op, unsigned long addr,
+                       bool store) {
+    csim_stats_t before = ref->stats;
+    switch (op) {
+    case OP_MODIFY:
+        ref_access(ref, addr, false);
+        ref_access(ref, addr, true);
+        return false;
+    case OP_PREFETCH:
+        ref_access(ref, addr, false);
+        ref->stats.hits = before.hits;
+        ref->stats.misses = before.misses;
+        return false;
+    case OP_FLUSH:
+    case OP_NT_STORE:
+        return ref_invalidate(ref, addr);
+    default:
+        ref_access(ref, addr, store);
+        return false;
+    }
+}
+
+static bool stats_equal(const csim_stats_t *a, const csim_stats_t *b) {
+    return a->hits == b->hits && a->misses == b->misses &&
+           a->evictions == b->evictions && a->dirty_bytes == b->dirty_bytes &&
+           a->dirty_evictions == b->dirty_evictions;
+}
+
+/**
+ * @brief Checks the statistics of a cache that no model predicts exactly:
+ * every demand access is a hit or a miss, at most all the lines are
+ * resident, and only resident blocks hold dirty bytes. Bypassed misses
+ * fill no line; prefetch misses fill one, and flushes and non-temporal
+ * stores may drop one.
+ */
+static bool stats_consistent(const cache_t *cache, size_t accesses,
+                             unsigned long bypasses) {
+    const csim_stats_t *st = &cache->stats;
+    const cache_op_stats_t *ops = &cache->ops;
+    unsigned long lines = cache->num_sets * (unsigned long)cache->E;
+    unsigned long fills = st->misses + ops->prefetch_misses - bypasses;
+    unsigned long resident = fills - st->evictions - ops->flush_hits -
+                             ops->nt_invalidations;
+    return st->hits + st->misses == accesses &&
+           st->evictions + bypasses <= st->misses + ops->prefetch_misses &&
+           resident <= lines && st->dirty_bytes <= resident << cache->b;
+}
+
+static void print_stats(const char *who, const csim_stats_t *st) {
+    fprintf(stderr, "  %-9s hits:%lu misses:%lu evictions:%lu "
+                    "dirty_bytes:%lu dirty_evictions:%lu\n",
+            who, st->hits, st->misses, st->evictions, st->dirty_bytes,
+            st->dirty_evictions);
+}
+
+static unsigned long decode_addr(const uint8_t *p) {
+    unsigned long raw = (unsigned long)p[1] | (unsigned long)p[2] << 8 |
+                        (unsigned long)p[3] << 16;
+    return raw << ((p[0] >> 1) % 41);
+}
+
+/**
+ * @brief Reports a mismatch with everything needed to reproduce it.
+ */
+static void report_mismatch(const uint8_t *data, size_t count, int s, int E,
+                            int b, const cache_t *cache,
+                            const ref_cache_t *ref, bool ops) {
+    fprintf(stderr, "Mismatch after access %zu with s=%d E=%d b=%d\n",
+            count, s, E, b);
+    print_stats("engine", &cache->stats);
+    print_stats("reference", &ref->stats);
+    fprintf(stderr, "Trace:\n");
+    for (size_t i = 0; i < count; i++) {
+        const uint8_t *p = data + HEADER_BYTES + i * ACCESS_BYTES;
+        fuzz_op_t op = ops ? pick_op(p, i) : OP_ACCESS;
+        fprintf(stderr, "%c %lx,1\n", op_char(op, p[0] & 1), decode_addr(p));
+    }
+}
+
+/**
+ * @brief Runs the second pass of a test case, with some accesses turned
+ * into other operations.
+ *
+ * Aborts on the first difference or inconsistency.
+ */
+static void run_ops_pass(const uint8_t *data, size_t count, int s, int E,
+                         int b) {
+    static const cache_policy_t POLICIES[] = {CACHE_ARC, CACHE_CLOCKPRO,
+                                              CACHE_TINYLFU};
+    static unsigned long all_ways[CACHE_MAX_OWNERS];
+    cache_t cache;
+    cache_t masked;
+    cache_t adaptive[3];
+    cache_t ship;
+    ref_cache_t ref;
+    memset(all_ways, 0xff, sizeof(all_ways));
+    if (!cache_init(&cache, s, E, b) || !ref_init(&ref, s, E, b) ||
+        !cache_init(&masked, s, E, b) ||
+        !cache_set_way_masks(&masked, all_ways) ||
+        !cache_init(&ship, s, E, b) || !cache_set_ship(&ship, b + 4, true))
+        abort();
+    for (int k = 0; k < 3; k++) {
+        if (!cache_init(&adaptive[k], 0, E, b) ||
+            !cache_set_policy(&adaptive[k], POLICIES[k]))
+            abort();
+    }
+
+    size_t accesses = 0;
+    unsigned long dropped = 0;
+    for (size_t i = 0; i < count; i++) {
+        const uint8_t *p = data + HEADER_BYTES + i * ACCESS_BYTES;
+        unsigned long addr = decode_addr(p);
+        bool store = p[0] & 1;
+        fuzz_op_t op = pick_op(p, i);
+        accesses += op == OP_MODIFY ? 2 : op == OP_ACCESS;
+        run_op(&cache, op, addr, store);
+        run_op(&masked, op, addr, store);
+        run_op(&ship, op, addr, store);
+        for (int k = 0; k < 3; k++)
+            run_op(&adaptive[k], op, addr, store);
+        dropped += ref_run_op(&ref, op, addr, store);
+
+        const cache_t *engines[2] = {&cache, &masked};
+        for (int k = 0; k < 2; k++) {
+            const cache_op_stats_t *ops = &engines[k]->ops;
+            if (!stats_equal(&engines[k]->stats, &ref.stats) ||
+                ops->flush_hits + ops->nt_invalidations != dropped) {
+                fprintf(stderr, "%sOperations:\n",
+                        k == 1 ? "Way-masked cache, " : "");
+                report_mismatch(data, i + 1, s, E, b, engines[k], &ref, true);
+                abort();
+            }
+        }
+        ship_stats_t predictor;
+        ship_stats(ship.ship, &predictor);
+        if (!stats_consistent(&ship, accesses, predictor.bypasses) ||
+            predictor.predictions != ship.stats.evictions) {
+            fprintf(stderr, "SHiP inconsistent under operations with s=%d "
+                            "E=%d b=%d after %zu accesses\n",
+                    s, E, b, i + 1);
+            print_stats("ship", &ship.stats);
+            abort();
+        }
+        for (int k = 0; k < 3; k++) {
+            if (!stats_consistent(&adaptive[k], accesses, 0)) {
+                fprintf(stderr, "Policy %d inconsistent under operations "
+                                "with E=%d b=%d after %zu accesses\n",
+                        (int)POLICIES[k], E, b, i + 1);
+                print_stats("adaptive", &adaptive[k].stats);
+                abort();
+            }
+        }
+    }
+
+    cache_free(&cache);
+    cache_free(&masked);
+    cache_free(&ship);
+    for (int k = 0; k < 3; k++)
+        cache_free(&adaptive[k]);
+    ref_free(&ref);
+}
+
+/**
+ * @brief Runs the trace of a test case through the other replacement
+ * policies: ARC against the reference ARC, and CLOCK-Pro, W-TinyLFU and
+ * SHiP with and without bypass for consistency.
+ *
+ * Aborts on the first difference or inconsistency.
+ */
+static void run_policy_pass(const uint8_t *data, size_t count, int s, int E,
+                            int b) {
+    cache_t arc;
+    cache_t clockpro;
+    cache_t tinylfu;
+    cache_t ship[2];
+    ref_arc_t ref_arc = {.c = E, .b = b};
+    if (!cache_init(&arc, 0, E, b) || !cache_set_policy(&arc, CACHE_ARC) ||
+        !cache_init(&clockpro, 0, E, b) ||
+        !cache_set_policy(&clockpro, CACHE_CLOCKPRO) ||
+        !cache_init(&tinylfu, 0, E, b) ||
+        !cache_set_policy(&tinylfu, CACHE_TINYLFU))
+        abort();
+    for (int k = 0; k < 2; k++) {
+        if (!cache_init(&ship[k], s, E, b) ||
+            !cache_set_ship(&ship[k], b + k * 4, k == 1))
+            abort();
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        const uint8_t *p = data + HEADER_BYTES + i * ACCESS_BYTES;
+        unsigned long addr = decode_addr(p);
+        bool store = p[0] & 1;
+        cache_access(&arc, addr, store);
+        ref_arc_access(&ref_arc, addr, store);
+        cache_access(&clockpro, addr, store);
+        cache_access(&tinylfu, addr, store);
+        cache_access(&ship[0], addr, store);
+        cache_access(&ship[1], addr, store);
+        if (!stats_equal(&arc.stats, &ref_arc.stats)) {
+            fprintf(stderr, "ARC mismatch with E=%d b=%d after %zu accesses\n",
+                    E, b, i + 1);
+            print_stats("arc", &arc.stats);
+            print_stats("reference", &ref_arc.stats);
+            abort();
+        }
+        if (!stats_consistent(&clockpro, i + 1, 0)) {
+            fprintf(stderr, "CLOCK-Pro inconsistent with E=%d b=%d after "
+                            "%zu accesses\n",
+                    E, b, i + 1);
+            print_stats("clockpro", &clockpro.stats);
+            abort();
+        }
+        if (!stats_consistent(&tinylfu, i + 1, 0)) {
+            fprintf(stderr, "W-TinyLFU inconsistent with E=%d b=%d after "
+                            "%zu accesses\n",
+                    E, b, i + 1);
+            print_stats("tinylfu", &tinylfu.stats);
+            abort();
+        }
+        for (int k = 0; k < 2; k++) {
+            ship_stats_t predictor;
+            ship_stats(ship[k].ship, &predictor);
+            if (!stats_consistent(&ship[k], i + 1, predictor.bypasses) ||
+                predictor.correct > predictor.predictions ||
+                predictor.predictions != ship[k].stats.evictions) {
+                fprintf(stderr, "SHiP%s inconsistent with s=%d E=%d b=%d "
+                                "after %zu accesses\n",
+                        k == 1 ? " with bypass" : "", s, E, b, i + 1);
+                print_stats("ship", &ship[k].stats);
+                abort();
+            }
+        }
+    }
+
+    cache_free(&arc);
+    cache_free(&clockpro);
+    cache_free(&tinylfu);
+    cache_free(&ship[0]);
+    cache_free(&ship[1]);
+}
+
+/** @brief log2 of the sets of the cache of the batch pass */
+#define BATCH_SET_BITS 15
+
+/** @brief Requests per batch of the batch pass, enough to be sorted */
+#define BATCH_REQUESTS 4096
+
+/** @brief Fully checked cases per case that also runs the batch pass */
+#define BATCH_EVERY 16
+
+/** @brief Number of fully checked cases run so far */
+static unsigned long full_cases;
+
+/**
+ * @brief Runs a long trace derived from a test case through a large cache,
+ * in batches given to cache_access_batch(), and checks that the statistics
+ * are those of a second cache given the same requests one at a time.
+ *
+ * The cache of 2**15 sets of 2 to 4 ways holds over 1 MiB of state, so
+ * batches of BATCH_REQUESTS requests take the path that groups them by set.
+ * Rounds of the case's accesses, each round moved to other sets by the
+ * high bits of the set index, make up two batches or more. At about a
+ * millisecond a pass, it runs on one fully checked case in BATCH_EVERY.
+ *
+ * Aborts on the first difference.
+ */
+static void run_batch_pass(const uint8_t *data, size_t count, int b) {
+    static cache_request_t requests[3 * BATCH_REQUESTS];
+    int E = 2 + data[2] % 3;
+    size_t batches = 2 + data[1] % 2;
+    cache_t batched;
+    cache_t single;
+    if (count == 0)
+        return;
+    if (!cache_init(&batched, BATCH_SET_BITS, E, b) ||
+        !cache_init(&single, BATCH_SET_BITS, E, b))
+        abort();
+
+    for (size_t j = 0; j < batches * BATCH_REQUESTS; j++) {
+        const uint8_t *p = data + HEADER_BYTES + j % count * ACCESS_BYTES;
+        unsigned long round = j / count % 16;
+        requests[j].addr = decode_addr(p) ^ round << (b + BATCH_SET_BITS - 4);
+        requests[j].store = p[0] & 1;
+    }
+    for (size_t k = 0; k < batches; k++) {
+        const cache_request_t *batch = requests + k * BATCH_REQUESTS;
+        cache_access_batch(&batched, batch, BATCH_REQUESTS);
+        for (size_t j = 0; j < BATCH_REQUESTS; j++)
+            cache_access(&single, batch[j].addr, batch[j].store);
+        if (batched.sorted == NULL || !stats_equal(&batched.stats,
+                                                   &single.stats)) {
+            fprintf(stderr, "Batch %zu %s with s=%d E=%d b=%d\n", k,
+                    batched.sorted == NULL ? "not grouped by set"
+                                           : "mismatch",
+                    BATCH_SET_BITS, E, b);
+            print_stats("batched", &batched.stats);
+            print_stats("single", &single.stats);
+            abort();
+        }
+    }
+
+    cache_free(&batched);
+    cache_free(&single);
+}
+
+/**
+ * @brief Runs one encoded test case through both models.
+ *
+ * Aborts on the first difference, which libFuzzer reports as a crash.
+ */
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    if (size < HEADER_BYTES)
+        return 0;
+
+    int s = data[0] % 8;
+    int b = data[1] % 7;
+    int E = 1 + data[2] % 24;
+    size_t count = (size - HEADER_BYTES) / ACCESS_BYTES;
+
+    static unsigned long all_ways[CACHE_MAX_OWNERS];
+    cache_t cache;
+    cache_t masked;
+    ref_cache_t ref;
+    sweep_t sweep;
+    dm_sweep_t direct;
+    int dm_s[DM_SWEEP_LANES];
+    int dm_b[DM_SWEEP_LANES];
+    bool full = case_number++ % full_every == 0;
+    bool dm = full && E == 1 && s + b >= 1;
+    if (!cache_init(&cache, s, E, b))
+        abort();
+    if (!ref_init(&ref, s, E, b))
+        abort();
+    if (full) {
+        memset(all_ways, 0xff, sizeof(all_ways));
+        if (!cache_init(&masked, s, E, b) ||
+            !cache_set_way_masks(&masked, all_ways))
+            abort();
+        if (!sweep_init(&sweep, 7, 24, b))
+            abort();
+    }
+    for (int l = 0; l < DM_SWEEP_LANES; l++) {
+        dm_s[l] = (s + l) % 8;
+        dm_b[l] = 1 + (b + l) % 6;
+    }
+    dm_b[0] = b;
+    if (dm && !dm_sweep_init(&direct, DM_SWEEP_LANES, dm_s, dm_b))
+        abort();
+
+    for (size_t i = 0; i < count; i++) {
+        const uint8_t *p = data + HEADER_BYTES + i * ACCESS_BYTES;
+        unsigned long addr = decode_addr(p);
+        bool store = p[0] & 1;
+        cache_access(&cache, addr, store);
+        ref_access(&ref, addr, store);
+        if (!stats_equal(&cache.stats, &ref.stats)) {
+            report_mismatch(data, i + 1, s, E, b, &cache, &ref, false);
+            abort();
+        }
+        if (!full)
+            continue;
+        cache_access(&masked, addr, store);
+        sweep_access(&sweep, addr);
+        if (dm)
+            dm_sweep_access(&direct, addr, store);
+        if (!stats_equal(&masked.stats, &ref.stats)) {
+            fprintf(stderr, "Way-masked cache:\n");
+            report_mismatch(data, i + 1, s, E, b, &masked, &ref, false);
+            abort();
+        }
+    }
+
+    if (full) {
+        csim_stats_t swept;
+        sweep_stats(&sweep, s, E, &swept);
+        if (swept.hits != ref.stats.hits || swept.misses != ref.stats.misses ||
+            swept.evictions != ref.stats.evictions) {
+            fprintf(stderr, "Sweep mismatch with s=%d E=%d b=%d\n", s, E, b);
+            print_stats("sweep", &swept);
+            report_mismatch(data, count, s, E, b, &cache, &ref, false);
+            abort();
+        }
+        if (dm) {
+            dm_sweep_stats(&direct, 0, &swept);
+            if (!stats_equal(&swept, &ref.stats)) {
+                fprintf(stderr,
+                        "Direct-mapped sweep mismatch with s=%d b=%d\n", s,
+                        b);
+                print_stats("direct", &swept);
+                report_mismatch(data, count, s, E, b, &cache, &ref, false);
+                abort();
+            }
+            dm_sweep_free(&direct);
+        }
+        cache_free(&masked);
+        sweep_free(&sweep);
+    }
+
+    cache_free(&cache);
+    ref_free(&ref);
+    if (full) {
+        run_policy_pass(data, count, s, E, b);
+        run_ops_pass(data, count, s, E, b);
+        if (full_cases++ % BATCH_EVERY == 0)
+            run_batch_pass(data, count, b);
+    }
+    return 0;
+}
+
+#ifndef FUZZ_LIBFUZZER
+
+/** @brief Largest generated case, in accesses */
+#define MAX_ACCESSES 256
+
+/** @brief Largest pool of distinct addresses a case draws from */
+#define MAX_POOL 64
+
+static uint64_t xorshift64(uint64_t *state) {
+    uint64_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    *state = x;
+    return x;
+}
+
+/**
+ * @brief Generates one random test case in the fuzz input encoding.
+ *
+ * Addresses are drawn from a small pool so that cases see hits, refills
+ * and evictions rather than only cold misses.
+ *
+ * @return The number of bytes written to buf.
+ */
+static size_t generate_case(uint64_t *rng, uint8_t *buf) {
+    uint8_t pool[MAX_POOL][ACCESS_BYTES];
+    size_t pool_size = 1 + xorshift64(rng) % MAX_POOL;
+    size_t count = 1 + xorshift64(rng) % MAX_ACCESSES;
+    uint64_t r = xorshift64(rng);
+
+    buf[0] = (uint8_t)r;
+    buf[1] = (uint8_t)(r >> 8);
+    buf[2] = (uint8_t)(r >> 16);
+    /* One shift per case keeps the pool addresses in related sets */
+    uint8_t shift = (uint8_t)(((r >> 24) % 41) << 1);
+    for (size_t i = 0; i < pool_size; i++) {
+        uint64_t a = xorshift64(rng);
+        pool[i][0] = shift;
+        pool[i][1] = (uint8_t)a;
+        pool[i][2] = (uint8_t)(a >> 8);
+        pool[i][3] = (uint8_t)(a >> 16) & (r & (1UL << 40) ? 0xff : 0x03);
+    }
+
+    uint8_t *p = buf + HEADER_BYTES;
+    for (size_t i = 0; i < count; i++, p += ACCESS_BYTES) {
+        uint64_t a = xorshift64(rng);
+        memcpy(p, pool[a % pool_size], ACCESS_BYTES);
+        p[0] |= (uint8_t)((a >> 32) & 1);
+    }
+    return HEADER_BYTES + count * ACCESS_BYTES;
+}
+
+static double elapsed(const struct timespec *start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - start->tv_sec) +
+           (double)(now.tv_nsec - start->tv_nsec) * 1e-9;
+}
+
+static void usage(char *argv[]) {
+    printf("Usage: %s [-h] [-n cases] [-T seconds] [-S seed] [-f every]\n",
+           argv[0]);
+    printf("Options:\n");
+    printf("  -h          Print this help message.\n");
+    printf("  -n cases    Stop after this many cases (default 1000000).\n");
+    printf("  -T seconds  Stop after this many seconds instead.\n");
+    printf("  -S seed     Seed for the random cases.\n");
+    printf("  -f every    Run every check on one case in this many, and only\n"
+           "              the LRU check on the others (default %d).\n",
+           FULL_EVERY);
+}
+
+/**
+ * @brief Main routine
+ */
+int main(int argc, char *argv[]) {
+    unsigned long max_cases = 1000000;
+    double max_seconds = 0;
+    uint64_t seed = (uint64_t)time(NULL);
+    int c;
+
+    full_every = FULL_EVERY;
+    while ((c = getopt(argc, argv, "hn:T:S:f:")) != -1) {
+        switch (c) {
+        case 'n':
+            max_cases = strtoul(optarg, NULL, 10);
+            break;
+        case 'T':
+            max_seconds = atof(optarg);
+            max_cases = ULONG_MAX;
+            break;
+        case 'S':
+            seed = strtoull(optarg, NULL, 0);
+            break;
+        case 'f':
+            full_every = strtoul(optarg, NULL, 10);
+            if (full_every == 0) {
+                usage(argv);
+                exit(1);
+            }
+            break;
+        case 'h':
+            usage(argv);
+            exit(0);
+        default:
+            usage(argv);
+            exit(1);
+        }
+    }
+
+    printf("Fuzzing with seed %llu\n", (unsigned long long)seed);
+    uint64_t rng = seed != 0 ? seed : 1;
+    static uint8_t buf[HEADER_BYTES + MAX_ACCESSES * ACCESS_BYTES];
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    unsigned long cases = 0;
+    unsigned long accesses = 0;
+    while (cases < max_cases) {
+        size_t size = generate_case(&rng, buf);
+        LLVMFuzzerTestOneInput(buf, size);
+        accesses += (size - HEADER_BYTES) / ACCESS_BYTES;
+        cases++;
+        if (max_seconds > 0 && cases % 1024 == 0 &&
+            elapsed(&start) >= max_seconds)
+            break;
+    }
+
+    double seconds = elapsed(&start);
+    printf("%lu cases, %lu accesses in %.2f s (%.0f cases/min): no "
+           "mismatches\n",
+           cases, accesses, seconds,
+           seconds > 0 ? (double)cases * 60.0 / seconds : 0.0);
+    return 0;
+}
+
+#endif /* FUZZ_LIBFUZZER */
@@ -0,0 +1,134 @@
+/**
+ * @file partition.c
+ * @brief Way partitioning of the cache between classes of accesses
+ *
+ * The masks themselves are enforced by the cache engine (see
+ * cache_set_way_masks()); this file only reads the rules and classifies
+ * accesses. Classification is one branch-free pass over the ranges, from
+ * the last to the first so that the first matching range wins.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "partition.h"
+
+/** @brief Longest line of a rule file */
+#define PARTITION_LINE 256
+
+static bool parse_number(char **p, unsigned long *value) {
+    char *end;
+    *value = strtoul(*p, &end, 0);
+    if (end == *p)
+        return false;
+    *p = end;
+    return true;
+}
+
+/**
+ * @brief Loads the rules of a partition.
+ *
+ * @param[out] partition  The partition to fill in
+ * @param[in]  path       The rule file
+ * @param[in]  E          Number of ways of the cache, at most 64
+ *
+ * @return True on success; false with an error message printed otherwise
+ */
+bool partition_load(way_partition_t *partition, const char *path, int E) {
+    memset(partition, 0, sizeof(*partition));
+    if (E > 64) {
+        fprintf(stderr, "Way partitioning needs at most 64 ways\n");
+        return false;
+    }
+    unsigned long all = E == 64 ? ~0UL : (1UL << E) - 1;
+    for (int c = 0; c < CACHE_MAX_OWNERS; c++)
+        partition->masks[c] = all;
+
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL) {
+        perror(path);
+        return false;
+    }
+
+    char line[PARTITION_LINE];
+    unsigned long lineno = 0;
+    bool ok = true;
+    while (ok && fgets(line, sizeof(line), fp) != NULL) {
+        lineno++;
+        char *hash = strchr(line, '#');
+        if (hash != NULL)
+            *hash = '\0';
+
+        char kind[16];
+        int used;
+        if (sscanf(line, " %15s%n", kind, &used) != 1)
+            continue;
+
+        char *p = line + used;
+        unsigned long cls, lo, hi;
+        ok = parse_number(&p, &cls) && cls < CACHE_MAX_OWNERS;
+        if (ok && strcmp(kind, "mask") == 0) {
+            ok = parse_number(&p, &lo) && (lo & all) != 0;
+            if (ok)
+                partition->masks[cls] = lo & all;
+        } else if (ok && strcmp(kind, "range") == 0) {
+            ok = parse_number(&p, &lo) && parse_number(&p, &hi) && lo < hi;
+            partition_range_t *grown =
+                ok ? realloc(partition->ranges, (partition->num_ranges + 1) *
+                                                    sizeof(*grown))
+                   : NULL;
+            ok = grown != NULL;
+            if (ok) {
+                partition->ranges = grown;
+                grown[partition->num_ranges].lo = lo;
+                grown[partition->num_ranges].len = hi - lo;
+                grown[partition->num_ranges].cls = (unsigned short)cls;
+                partition->num_ranges++;
+            }
+        } else {
+            ok = false;
+        }
+        while (ok && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n'))
+            p++;
+        if (ok && *p != '\0')
+            ok = false;
+        if (ok && cls + 1 > partition->num_classes)
+            partition->num_classes = (unsigned int)cls + 1;
+    }
+    fclose(fp);
+
+    if (!ok) {
+        fprintf(stderr, "%s:%lu: invalid partition rule\n", path, lineno);
+        partition_free(partition);
+    }
+    return ok;
+}
+
+/**
+ * @brief Releases the rules of a partition.
+ */
+void partition_free(way_partition_t *partition) {
+    free(partition->ranges);
+    partition->ranges = NULL;
+    partition->num_ranges = 0;
+}
+
+/**
+ * @brief Returns the class of an access.
+ *
+ * @param[in] partition  The partition
+ * @param[in] addr       The address accessed
+ * @param[in] cls        Class of the access if it is in no range
+ */
+unsigned short partition_class(const way_partition_t *partition,
+                               unsigned long addr, unsigned short cls) {
+    for (size_t r = partition->num_ranges; r-- > 0;) {
+        const partition_range_t *range = &partition->ranges[r];
+        bool in = addr - range->lo < range->len;
+        cls = in ? range->cls : cls;
+    }
+    return cls;
+}
@@ -0,0 +1,56 @@
+/**
+ * @file partition.h
+ * @brief Way partitioning of the cache between classes of accesses
+ *
+ * In the style of Intel CAT, every class of accesses gets a mask of the
+ * ways it may fill. A rule file sets the masks and says which address
+ * ranges belong to which class, one rule per line ('#' starts a comment):
+ *
+ *   mask  <class> <ways>    bit w of ways allows the class to fill way w
+ *   range <class> <lo> <hi> accesses to [lo, hi) belong to the class
+ *
+ * Numbers may be decimal, octal or hex (0x...). Classes go from 0 to
+ * CACHE_MAX_OWNERS - 1, and a class without a mask may fill every way.
+ * An access outside every range keeps a default class, the number of its
+ * trace when several traces are mixed and 0 otherwise. When ranges
+ * overlap, the first one in the file wins.
+ */
+
+#ifndef PARTITION_H
+#define PARTITION_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "cache.h"
+
+/**
+ * @brief Address range of a class
+ */
+typedef struct {
+    unsigned long lo;       /* first address of the range */
+    unsigned long len;      /* number of addresses in the range */
+    unsigned short cls;     /* class of the accesses in the range */
+} partition_range_t;
+
+/**
+ * @brief Way masks and address ranges of the classes
+ */
+typedef struct {
+    unsigned long masks[CACHE_MAX_OWNERS]; /* ways each class may fill */
+    partition_range_t *ranges;             /* in the order of the file */
+    size_t num_ranges;
+    unsigned int num_classes;              /* highest class used, plus 1 */
+} way_partition_t;
+
+/** @brief Loads the rules of a partition for a cache with E ways */
+bool partition_load(way_partition_t *partition, const char *path, int E);
+
+/** @brief Releases the rules of a partition */
+void partition_free(way_partition_t *partition);
+
+/** @brief Returns the class of an access */
+unsigned short partition_class(const way_partition_t *partition,
+                               unsigned long addr, unsigned short cls);
+
+#endif /* PARTITION_H */
@@ -0,0 +1,275 @@
+/**
+ * @file ship.c
+ * @brief Signature-based hit prediction (SHiP) without program counters
+ *
+ * This follows SHiP-Mem of Wu et al. (MICRO 2011) on top of SRRIP. Every
+ * line holds a 2-bit re-reference prediction value (RRPV): 0 on a hit,
+ * and the victim of a miss in a full set is the first way with the
+ * largest value, after which the whole set ages by the difference to 3,
+ * exactly as if every line had been aged until some line reached 3.
+ *
+ * The signature of a block is a hash of the granule (2**granule_bits
+ * bytes) holding it. A table of 3-bit saturating counters, one per
+ * signature, counts up when a line of that signature hits and down when
+ * one is evicted without having been reused. A new block whose counter is
+ * 0 is predicted dead and inserted with an RRPV of 3, first in line for
+ * eviction; any other block is inserted with 2. With bypass, a block
+ * predicted dead does not fill a line at all, except for one in every
+ * SHIP_BYPASS_SAMPLE, which is inserted so that a signature whose
+ * behaviour changes can still be retrained.
+ *
+ * The prediction made for a line is checked when the line is evicted:
+ * it was right if the line was predicted dead and never hit, or predicted
+ * live and hit at least once.
+ *
+ * A line invalidated by a flush or a non-temporal store (see
+ * cache_flush_block()) gets an RRPV above the largest, so the next miss in
+ * its set refills it before evicting anything, and without training.
+ *
+ * The tag, valid and dirty state stays in the arrays of cache.c; only the
+ * RRPV, signature and prediction of each line live here, in a parallel
+ * array of 4-byte entries.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ship.h"
+
+/** @brief log2 of the number of counters in the prediction table */
+#define SHIP_SIGNATURE_BITS 14
+
+/** @brief Largest value of a counter of the prediction table */
+#define SHIP_COUNTER_MAX 7
+
+/** @brief Value of every counter of a new prediction table */
+#define SHIP_COUNTER_INIT 1
+
+/** @brief Largest RRPV, for lines expected to be re-referenced last */
+#define SHIP_RRPV_MAX 3
+
+/** @brief Blocks predicted dead per block inserted anyway under bypass */
+#define SHIP_BYPASS_SAMPLE 32
+
+/** @brief RRPV of a line invalidated by a flush, the first victim of all */
+#define SHIP_RRPV_INVALID (SHIP_RRPV_MAX + 1)
+
+/** @brief Line flag: the line hit since it was filled */
+#define SHIP_REUSED 1
+
+/** @brief Line flag: the line was predicted dead when it was filled */
+#define SHIP_PREDICTED_DEAD 2
+
+/**
+ * @brief SHiP state of one line
+ */
+typedef struct {
+    uint16_t signature; /* signature of the block */
+    unsigned char rrpv; /* re-reference prediction value */
+    unsigned char flags; /* SHIP_REUSED, SHIP_PREDICTED_DEAD */
+} ship_line_t;
+
+struct ship {
+    int granule_bits;   /* log2 of the bytes per signature */
+    bool bypass;        /* blocks predicted dead bypass the cache */
+    ship_line_t *lines; /* same layout as the tags of the cache */
+    size_t num_lines;
+    unsigned long sampled; /* blocks predicted dead under bypass */
+    ship_stats_t stats;
+    unsigned char counters[1 << SHIP_SIGNATURE_BITS];
+};
+
+/**
+ * @brief Allocates the state of SHiP for a cache.
+ *
+ * @param[in] cache         The cache, whose geometry is used
+ * @param[in] granule_bits  log2 of the bytes per signature, in [b, 63]
+ * @param[in] bypass        Whether blocks predicted dead bypass the cache
+ *
+ * @return The state, or NULL if the granule is out of range or memory ran
+ * out
+ */
+ship_t *ship_new(const cache_t *cache, int granule_bits, bool bypass) {
+    if (granule_bits < cache->b || granule_bits >= 64)
+        return NULL;
+    ship_t *state = calloc(1, sizeof(*state));
+    if (state == NULL)
+        return NULL;
+    state->granule_bits = granule_bits;
+    state->bypass = bypass;
+    state->num_lines = (size_t)cache->num_sets * (size_t)cache->E;
+    state->lines = calloc(state->num_lines, sizeof(*state->lines));
+    if (state->lines == NULL) {
+        free(state);
+        return NULL;
+    }
+    ship_reset(state);
+    return state;
+}
+
+/**
+ * @brief Releases the state of SHiP.
+ */
+void ship_delete(ship_t *state) {
+    if (state == NULL)
+        return;
+    free(state->lines);
+    free(state);
+}
+
+/**
+ * @brief Forgets the lines and what the predictor learned. The statistics
+ * of the predictor are kept.
+ */
+void ship_reset(ship_t *state) {
+    memset(state->lines, 0, state->num_lines * sizeof(*state->lines));
+    memset(state->counters, SHIP_COUNTER_INIT, sizeof(state->counters));
+    state->sampled = 0;
+}
+
+/**
+ * @brief Gets the statistics of the predictor.
+ */
+void ship_stats(const ship_t *state, ship_stats_t *stats) {
+    *stats = state->stats;
+}
+
+static uint16_t signature(const ship_t *state, unsigned long addr) {
+    unsigned long granule = addr >> state->granule_bits;
+    return (uint16_t)((granule * 0x9e3779b97f4a7c15UL) >>
+                      (64 - SHIP_SIGNATURE_BITS));
+}
+
+/**
+ * @brief Marks a line invalidated by cache.c as the first victim of its set.
+ *
+ * @param[in,out] state  The state of SHiP
+ * @param[in]     line   Index of the line in the tag and metadata arrays
+ */
+void ship_invalidate(ship_t *state, size_t line) {
+    state->lines[line].rrpv = SHIP_RRPV_INVALID;
+    state->lines[line].flags = 0;
+}
+
+/**
+ * @brief Finds the SRRIP victim of a full set and ages the set. An
+ * invalidated line is taken first, without ageing the others.
+ */
+static unsigned int rrip_victim(ship_line_t *lines, unsigned int ways) {
+    unsigned int victim = 0;
+    unsigned char max = 0;
+    for (unsigned int w = 0; w < ways; w++) {
+        bool older = lines[w].rrpv > max;
+        max = older ? lines[w].rrpv : max;
+        victim = older ? w : victim;
+    }
+    if (max == SHIP_RRPV_INVALID)
+        return victim;
+    unsigned char age = (unsigned char)(SHIP_RRPV_MAX - max);
+    for (unsigned int w = 0; w < ways; w++)
+        lines[w].rrpv = (unsigned char)(lines[w].rrpv + age);
+    return victim;
+}
+
+/**
+ * @brief Simulates one load or store under SHiP.
+ *
+ * The statistics, evicted_addr/evicted_dirty and, if owners are tracked,
+ * victim and occupancy are updated as by cache_access(). A bypassed block
+ * is a miss that neither fills nor evicts a line.
+ *
+ * @return What the access did to the cache
+ */
+cache_result_t ship_access(cache_t *cache, unsigned long addr, bool store) {
+    ship_t *state = cache->ship;
+    unsigned long tag = addr >> (cache->s + cache->b);
+    unsigned long set = (addr >> cache->b) & cache->set_mask;
+    size_t base = (size_t)set * (size_t)cache->E;
+    unsigned long *tags = cache->tags + base;
+    cache_meta_t *meta = cache->meta + base;
+    ship_line_t *lines = state->lines + base;
+    unsigned int fill = cache->fill[set];
+    unsigned long now = ++cache->clock;
+
+    for (unsigned int w = 0; w < fill; w++) {
+        if (tags[w] == tag && meta[w].valid) {
+            cache->stats.hits++;
+            if (store && !meta[w].dirty) {
+                meta[w].dirty = true;
+                cache->stats.dirty_bytes += cache->block_bytes;
+            }
+            meta[w].stamp = now;
+            meta[w].hits++;
+            unsigned char *counter = &state->counters[lines[w].signature];
+            if (*counter < SHIP_COUNTER_MAX)
+                (*counter)++;
+            lines[w].rrpv = 0;
+            lines[w].flags |= SHIP_REUSED;
+            return CACHE_HIT;
+        }
+    }
+
+    cache->stats.misses++;
+    cache_result_t result = fill == 0 ? CACHE_COLD_MISS : CACHE_MISS;
+    uint16_t sig = signature(state, addr);
+    bool dead = state->counters[sig] == 0;
+    state->stats.dead += dead;
+    if (dead && state->bypass &&
+        ++state->sampled % SHIP_BYPASS_SAMPLE != 0) {
+        state->stats.bypasses++;
+        return result;
+    }
+
+    unsigned int way;
+    if (fill < (unsigned int)cache->E) {
+        way = fill;
+        cache->fill[set] = fill + 1;
+    } else {
+        way = rrip_victim(lines, fill);
+    }
+
+    if (meta[way].valid) {
+        if (cache->lifetimes != NULL)
+            cache_record_eviction(cache, base + way, now);
+        cache->stats.evictions++;
+        cache->evicted_addr = (tags[way] << cache->s | set) << cache->b;
+        cache->evicted_dirty = meta[way].dirty;
+        if (meta[way].dirty) {
+            cache->stats.dirty_evictions += cache->block_bytes;
+            cache->stats.dirty_bytes -= cache->block_bytes;
+        }
+        bool reused = lines[way].flags & SHIP_REUSED;
+        bool predicted_dead = lines[way].flags & SHIP_PREDICTED_DEAD;
+        unsigned char *counter = &state->counters[lines[way].signature];
+        if (!reused && *counter > 0)
+            (*counter)--;
+        state->stats.predictions++;
+        state->stats.correct += predicted_dead != reused;
+        result = CACHE_MISS_EVICT;
+    }
+
+    if (cache->owner != NULL) {
+        unsigned short *owner = cache->owner + base + way;
+        cache->victim = *owner;
+        if (result == CACHE_MISS_EVICT)
+            cache->occupancy[*owner]--;
+        cache->occupancy[cache->current]++;
+        *owner = cache->current;
+    }
+    tags[way] = tag;
+    meta[way].stamp = now;
+    meta[way].hits = 0;
+    meta[way].valid = true;
+    if (cache->filled != NULL)
+        cache->filled[base + way] = now;
+    meta[way].dirty = store;
+    if (store)
+        cache->stats.dirty_bytes += cache->block_bytes;
+    lines[way].signature = sig;
+    lines[way].rrpv = dead ? SHIP_RRPV_MAX : SHIP_RRPV_MAX - 1;
+    lines[way].flags = dead ? SHIP_PREDICTED_DEAD : 0;
+    return result;
+}
@@ -0,0 +1,57 @@
+/**
+ * @file ship.h
+ * @brief Signature-based hit prediction (SHiP) without program counters
+ *
+ * SHiP replaces LRU with re-reference interval prediction (RRIP) and picks
+ * the insertion priority of each block from a table of saturating
+ * counters, indexed by a signature of the block, that learns whether the
+ * blocks of each signature tend to be reused before they are evicted.
+ * Traces carry no program counter, so the signature here is a hash of the
+ * address region (the granule) holding the block, which usually tells the
+ * data structures of the program apart. Blocks predicted dead can also
+ * bypass the cache altogether.
+ *
+ * A cache_t switches to SHiP with cache_set_ship(); cache_access() then
+ * runs it instead of LRU, and ship_stats() tells how often the prediction
+ * made at insertion was right.
+ */
+
+#ifndef SHIP_H
+#define SHIP_H
+
+#include <stdbool.h>
+
+#include "cache.h"
+
+/** @brief Default log2 of the bytes of a granule: 4 KB pages */
+#define SHIP_GRANULE_BITS 12
+
+/**
+ * @brief Statistics of the predictor
+ */
+typedef struct {
+    unsigned long predictions; /* evicted blocks whose prediction is known */
+    unsigned long correct;     /* of which the prediction was right */
+    unsigned long dead;        /* insertions predicted dead (not reused) */
+    unsigned long bypasses;    /* misses that did not fill a line */
+} ship_stats_t;
+
+/** @brief Creates the state of SHiP for a cache */
+ship_t *ship_new(const cache_t *cache, int granule_bits, bool bypass);
+
+/** @brief Releases the state of SHiP */
+void ship_delete(ship_t *state);
+
+/** @brief Forgets the lines and what the predictor learned */
+void ship_reset(ship_t *state);
+
+/** @brief Simulates one load or store under SHiP */
+cache_result_t ship_access(cache_t *cache, unsigned long addr, bool store);
+
+/** @brief Marks a line invalidated by cache.c as the first victim */
+void ship_invalidate(ship_t *state, size_t line);
+
+/** @brief Gets the statistics of the predictor */
+void ship_stats(const ship_t *state, ship_stats_t *stats);
+
+#endif /* SHIP_H */
@@ -0,0 +1,154 @@
+/**
+ * @file spill.c
+ * @brief Out-of-core simulation of caches bigger than memory
+ *
+ * The sets are cut into a power-of-two number of ranges by the top bits of
+ * the set index, enough of them for the state of one range to fit in the
+ * memory budget. Sets never interact and each spill file keeps the trace
+ * order of its requests, so simulating the ranges one after the other
+ * gives exactly the statistics of simulating the whole trace in order.
+ *
+ * Spill files are unlinked as soon as they are created, so they never
+ * outlive the simulation. After a range is done, its sets are released
+ * with cache_release(), which lets a mapped cache be much bigger than
+ * physical memory.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "spill.h"
+
+/** @brief Longest path of a spill file */
+#define SPILL_PATH 4096
+
+/**
+ * @brief Writes out the buffered requests of a range.
+ */
+static void flush_part(spill_t *spill, unsigned long part) {
+    size_t n = spill->buffered[part];
+    cache_request_t *buffer = spill->buffers + part * SPILL_BUFFER;
+    if (n > 0 && fwrite(buffer, sizeof(*buffer), n, spill->files[part]) != n)
+        spill->failed = true;
+    spill->buffered[part] = 0;
+}
+
+/**
+ * @brief Creates the spill files of an out-of-core simulation.
+ *
+ * @param[out] spill   The simulation to initialize
+ * @param[in]  cache   The cache to simulate, usually from cache_init_mapped()
+ * @param[in]  dir     Directory for the spill files
+ * @param[in]  budget  Bytes of cache state to simulate at once
+ *
+ * @return True on success; false with an error message printed otherwise
+ */
+bool spill_open(spill_t *spill, cache_t *cache, const char *dir,
+                size_t budget) {
+    memset(spill, 0, sizeof(*spill));
+    spill->cache = cache;
+
+    size_t per_set = sizeof(*cache->fill);
+    if (cache->order != NULL)
+        per_set += sizeof(*cache->order);
+    size_t state = (size_t)cache->num_sets * (size_t)cache->E *
+                       (sizeof(*cache->tags) + sizeof(*cache->meta)) +
+                   (size_t)cache->num_sets * per_set;
+    int bits = 0;
+    while (bits < cache->s && (1UL << bits) < SPILL_MAX_PARTS &&
+           state >> bits > budget)
+        bits++;
+    spill->parts = 1UL << bits;
+    spill->shift = cache->s - bits;
+
+    spill->files = calloc(spill->parts, sizeof(*spill->files));
+    spill->buffers =
+        malloc(spill->parts * SPILL_BUFFER * sizeof(*spill->buffers));
+    spill->buffered = calloc(spill->parts, sizeof(*spill->buffered));
+    if (spill->files == NULL || spill->buffers == NULL ||
+        spill->buffered == NULL) {
+        fprintf(stderr, "Out of memory for %lu spill files\n", spill->parts);
+        spill_close(spill);
+        return false;
+    }
+
+    char path[SPILL_PATH];
+    for (unsigned long p = 0; p < spill->parts; p++) {
+        snprintf(path, sizeof(path), "%s/csim-spill.%ld.%lu", dir,
+                 (long)getpid(), p);
+        spill->files[p] = fopen(path, "w+b");
+        if (spill->files[p] == NULL) {
+            perror(path);
+            spill_close(spill);
+            return false;
+        }
+        unlink(path);
+        setvbuf(spill->files[p], NULL, _IONBF, 0);
+    }
+    return true;
+}
+
+/**
+ * @brief Appends a batch of requests to the spill files of their sets.
+ */
+void spill_put(spill_t *spill, const cache_request_t *requests,
+               size_t count) {
+    const cache_t *cache = spill->cache;
+    for (size_t i = 0; i < count; i++) {
+        unsigned long set = (requests[i].addr >> cache->b) & cache->set_mask;
+        unsigned long part = set >> spill->shift;
+        spill->buffers[part * SPILL_BUFFER + spill->buffered[part]++] =
+            requests[i];
+        if (spill->buffered[part] == SPILL_BUFFER)
+            flush_part(spill, part);
+    }
+}
+
+/**
+ * @brief Simulates every range of sets from its spill file, in turn.
+ *
+ * @return True on success; false with an error message printed if a spill
+ * file could not be written or read back
+ */
+bool spill_run(spill_t *spill) {
+    cache_t *cache = spill->cache;
+    unsigned long sets = 1UL << spill->shift;
+    cache_request_t *buffer = spill->buffers;
+
+    for (unsigned long p = 0; p < spill->parts; p++)
+        flush_part(spill, p);
+
+    for (unsigned long p = 0; p < spill->parts && !spill->failed; p++) {
+        FILE *fp = spill->files[p];
+        size_t n;
+        rewind(fp);
+        while ((n = fread(buffer, sizeof(*buffer), SPILL_BUFFER, fp)) > 0)
+            cache_access_batch(cache, buffer, n);
+        if (ferror(fp))
+            spill->failed = true;
+        cache_release(cache, p * sets, sets);
+    }
+
+    if (spill->failed)
+        fprintf(stderr, "Failed to write or read a spill file\n");
+    return !spill->failed;
+}
+
+/**
+ * @brief Closes the spill files and releases the buffers.
+ */
+void spill_close(spill_t *spill) {
+    for (unsigned long p = 0; spill->files != NULL && p < spill->parts; p++) {
+        if (spill->files[p] != NULL)
+            fclose(spill->files[p]);
+    }
+    free(spill->files);
+    free(spill->buffers);
+    free(spill->buffered);
+    spill->files = NULL;
+    spill->buffers = NULL;
+    spill->buffered = NULL;
+}
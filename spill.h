@@ -0,0 +1,55 @@
+/**
+ * @file spill.h
+ * @brief Out-of-core simulation of caches bigger than memory
+ *
+ * The loads and stores of a trace are first written to spill files, one
+ * per range of sets, in trace order. The cache is then simulated one range
+ * at a time from its spill file, so that only the state of that range has
+ * to be in memory at once. With a cache from cache_init_mapped(), both the
+ * spill files and the cache state are read and written mostly
+ * sequentially.
+ */
+
+#ifndef SPILL_H
+#define SPILL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#include "cache.h"
+
+/** @brief Largest number of spill files */
+#define SPILL_MAX_PARTS 1024
+
+/** @brief Requests buffered per spill file before they are written */
+#define SPILL_BUFFER 4096
+
+/**
+ * @brief State of an out-of-core simulation
+ */
+typedef struct {
+    cache_t *cache;             /* cache simulated */
+    unsigned long parts;        /* number of set ranges and spill files */
+    int shift;                  /* set >> shift is the range of a set */
+    FILE **files;               /* spill file of each range */
+    cache_request_t *buffers;   /* SPILL_BUFFER requests per range */
+    size_t *buffered;           /* requests in the buffer of each range */
+    bool failed;                /* a spill file could not be written */
+} spill_t;
+
+/** @brief Creates the spill files in dir for a cache, within a budget */
+bool spill_open(spill_t *spill, cache_t *cache, const char *dir,
+                size_t budget);
+
+/** @brief Appends a batch of requests to the spill files */
+void spill_put(spill_t *spill, const cache_request_t *requests,
+               size_t count);
+
+/** @brief Simulates every range of sets from its spill file */
+bool spill_run(spill_t *spill);
+
+/** @brief Closes the spill files */
+void spill_close(spill_t *spill);
+
+#endif /* SPILL_H */
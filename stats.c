@@ -0,0 +1,257 @@
+/**
+ * @file stats.c
+ * @brief Registry of named counters and histograms, saved as .csim_stats
+ *
+ * A .csim_stats file starts with the line "csim-stats <version>", followed
+ * by one line per metric:
+ *
+ *     counter <name> <value>
+ *     histogram <name> <buckets> <bucket>:<value> ...
+ *
+ * where a histogram lists only its nonzero buckets. The version changes
+ * only if the meaning of these lines does; adding metrics does not change
+ * it. A reader skips lines of kinds and names it did not register, and
+ * buckets past the ones it registered.
+ */
+
+#define _GNU_SOURCE
+
+#include <ctype.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "stats.h"
+
+/**
+ * @brief Initializes an empty registry.
+ */
+void stats_init(stats_registry_t *reg) {
+    reg->num_metrics = 0;
+    reg->num_slots = 0;
+    reg->values = NULL;
+}
+
+/**
+ * @brief Releases the values of a registry.
+ */
+void stats_free(stats_registry_t *reg) {
+    free(reg->values);
+    reg->values = NULL;
+}
+
+static bool valid_name(const char *name) {
+    size_t len = strlen(name);
+    if (len == 0 || len >= STATS_NAME_MAX)
+        return false;
+    for (size_t i = 0; i < len; i++) {
+        unsigned char c = (unsigned char)name[i];
+        if (!isalnum(c) && c != '_' && c != '.')
+            return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Registers a metric of some slots.
+ *
+ * @return false if values were already stored, the registry is full, the
+ * name is invalid or taken, or buckets is 0
+ */
+static bool add_metric(stats_registry_t *reg, const char *name,
+                       stats_kind_t kind, size_t buckets, size_t *slot) {
+    if (reg->values != NULL || reg->num_metrics == STATS_MAX_METRICS ||
+        buckets == 0 || !valid_name(name) || stats_find(reg, name) != NULL)
+        return false;
+    stats_metric_t *m = &reg->metrics[reg->num_metrics++];
+    strcpy(m->name, name);
+    m->kind = kind;
+    m->slot = reg->num_slots;
+    m->buckets = buckets;
+    reg->num_slots += buckets;
+    *slot = m->slot;
+    return true;
+}
+
+/**
+ * @brief Registers a counter.
+ *
+ * Metrics must be registered before any value is stored, which fixes the
+ * number of slots.
+ *
+ * @param[in,out] reg   The registry
+ * @param[in]     name  Name of the counter: letters, digits, '_' and '.'
+ * @param[out]    slot  Slot of the counter
+ *
+ * @return false if the counter could not be registered
+ */
+bool stats_counter(stats_registry_t *reg, const char *name, size_t *slot) {
+    return add_metric(reg, name, STATS_COUNTER, 1, slot);
+}
+
+/**
+ * @brief Registers a histogram. Bucket k is at slot + k.
+ *
+ * @param[in,out] reg      The registry
+ * @param[in]     name     Name of the histogram, as for stats_counter()
+ * @param[in]     buckets  Number of buckets, at least 1
+ * @param[out]    slot     Slot of the first bucket
+ *
+ * @return false if the histogram could not be registered
+ */
+bool stats_histogram(stats_registry_t *reg, const char *name, size_t buckets,
+                     size_t *slot) {
+    return add_metric(reg, name, STATS_HISTOGRAM, buckets, slot);
+}
+
+/**
+ * @brief Finds a metric by name.
+ *
+ * @return The metric, or NULL if none has that name
+ */
+const stats_metric_t *stats_find(const stats_registry_t *reg,
+                                 const char *name) {
+    for (size_t i = 0; i < reg->num_metrics; i++) {
+        if (strcmp(reg->metrics[i].name, name) == 0)
+            return &reg->metrics[i];
+    }
+    return NULL;
+}
+
+/** @brief Allocates the values if needed */
+static bool ensure_values(stats_registry_t *reg) {
+    if (reg->values == NULL)
+        reg->values = calloc(reg->num_slots > 0 ? reg->num_slots : 1,
+                             sizeof(*reg->values));
+    return reg->values != NULL;
+}
+
+/**
+ * @brief Adds to a counter, or to one bucket of a histogram. The first
+ * call ends registration.
+ *
+ * @return false if memory ran out
+ */
+bool stats_add(stats_registry_t *reg, size_t slot, unsigned long n) {
+    if (!ensure_values(reg))
+        return false;
+    reg->values[slot] += n;
+    return true;
+}
+
+/**
+ * @brief Gets the value of a slot, 0 before any value is stored.
+ */
+unsigned long stats_value(const stats_registry_t *reg, size_t slot) {
+    return reg->values != NULL ? reg->values[slot] : 0;
+}
+
+/**
+ * @brief Writes the values of every metric to a file.
+ *
+ * @return false if the file could not be written
+ */
+bool stats_write(const stats_registry_t *reg, const char *path) {
+    FILE *fp = fopen(path, "w");
+    if (fp == NULL) {
+        fprintf(stderr, "Error: failed to open %s: %s\n", path,
+                strerror(errno));
+        return false;
+    }
+    fprintf(fp, "csim-stats %d\n", STATS_VERSION);
+    for (size_t i = 0; i < reg->num_metrics; i++) {
+        const stats_metric_t *m = &reg->metrics[i];
+        if (m->kind == STATS_COUNTER) {
+            fprintf(fp, "counter %s %lu\n", m->name,
+                    stats_value(reg, m->slot));
+            continue;
+        }
+        fprintf(fp, "histogram %s %zu", m->name, m->buckets);
+        for (size_t k = 0; k < m->buckets; k++) {
+            unsigned long value = stats_value(reg, m->slot + k);
+            if (value > 0)
+                fprintf(fp, " %zu:%lu", k, value);
+        }
+        fprintf(fp, "\n");
+    }
+    return fclose(fp) == 0;
+}
+
+/**
+ * @brief Adds the buckets of a histogram line to the values.
+ *
+ * @param[in] pairs  The rest of the line after the number of buckets
+ *
+ * @return false if the line is malformed
+ */
+static bool read_buckets(stats_registry_t *reg, const stats_metric_t *m,
+                         char *pairs) {
+    char *p = pairs;
+    while (*p != '\0' && *p != '\n') {
+        char *end;
+        errno = 0;
+        unsigned long k = strtoul(p, &end, 10);
+        if (end == p || *end != ':')
+            return false;
+        p = end + 1;
+        unsigned long value = strtoul(p, &end, 10);
+        if (end == p || errno != 0)
+            return false;
+        p = end;
+        while (*p == ' ')
+            p++;
+        if (m != NULL && k < m->buckets)
+            reg->values[m->slot + k] += value;
+    }
+    return true;
+}
+
+/**
+ * @brief Adds the values stored in a .csim_stats file to the metrics
+ * registered under the same names.
+ *
+ * Metrics of the file that are not registered are skipped, and registered
+ * metrics missing from the file are left alone.
+ *
+ * @return false if the file could not be read, is of another version or is
+ * malformed
+ */
+bool stats_read(stats_registry_t *reg, const char *path) {
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL) {
+        fprintf(stderr, "Failed to open %s: %s\n", path, strerror(errno));
+        return false;
+    }
+    int version;
+    bool ok = fscanf(fp, "csim-stats %d\n", &version) == 1 &&
+              version == STATS_VERSION && ensure_values(reg);
+
+    char *line = NULL;
+    size_t cap = 0;
+    while (ok && getline(&line, &cap, fp) != -1) {
+        char kind[16];
+        char name[STATS_NAME_MAX];
+        unsigned long value;
+        int used;
+        if (sscanf(line, "%15s %47s %lu%n", kind, name, &value, &used) < 3) {
+            ok = false;
+            break;
+        }
+        const stats_metric_t *m = stats_find(reg, name);
+        if (strcmp(kind, "counter") == 0) {
+            if (m != NULL && m->kind == STATS_COUNTER)
+                reg->values[m->slot] += value;
+        } else if (strcmp(kind, "histogram") == 0) {
+            if (m != NULL && m->kind != STATS_HISTOGRAM)
+                m = NULL;
+            ok = read_buckets(reg, m, line + used);
+        }
+    }
+    free(line);
+    fclose(fp);
+    if (!ok)
+        fprintf(stderr, "Error: %s is not a version %d statistics file\n",
+                path, STATS_VERSION);
+    return ok;
+}
@@ -0,0 +1,93 @@
+/**
+ * @file stats.h
+ * @brief Registry of named counters and histograms, saved as .csim_stats
+ *
+ * csim_stats_t has five fixed fields, and the .csim_results file holding
+ * them is read by the autograder and by every tool of the lab, so it cannot
+ * grow. Any other metric is registered here under a name instead: a counter
+ * takes one slot, a histogram one slot per bucket, and registration hands
+ * back the index of the first slot.
+ *
+ * The registry only names, writes and reads values. The simulator keeps
+ * counting in the structs of its engines and fills the registry once, after
+ * the simulation, so a metric costs nothing per access.
+ *
+ * The values are written to a versioned text file, one metric per line,
+ * which a reader loads by name: metrics it does not know are skipped, so
+ * new ones can be added without breaking older readers. .csim_results
+ * stays as it was and remains the view of the five legacy fields.
+ */
+
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/** @brief Version of the .csim_stats format written by stats_write() */
+#define STATS_VERSION 1
+
+/** @brief Maximum number of metrics in a registry */
+#define STATS_MAX_METRICS 128
+
+/** @brief Maximum length of a metric name, including the terminator */
+#define STATS_NAME_MAX 48
+
+/**
+ * @brief Kinds of metrics
+ */
+typedef enum {
+    STATS_COUNTER,   /* one value */
+    STATS_HISTOGRAM, /* one value per bucket */
+} stats_kind_t;
+
+/**
+ * @brief A registered metric
+ */
+typedef struct {
+    char name[STATS_NAME_MAX]; /* letters, digits, '_' and '.' */
+    stats_kind_t kind;
+    size_t slot;    /* first slot in the values */
+    size_t buckets; /* slots taken, 1 for a counter */
+} stats_metric_t;
+
+/**
+ * @brief A set of metrics and their values
+ */
+typedef struct {
+    stats_metric_t metrics[STATS_MAX_METRICS];
+    size_t num_metrics;
+    size_t num_slots;      /* slots of all the metrics */
+    unsigned long *values; /* one per slot, NULL until first needed */
+} stats_registry_t;
+
+/** @brief Initializes an empty registry */
+void stats_init(stats_registry_t *reg);
+
+/** @brief Releases the values of a registry */
+void stats_free(stats_registry_t *reg);
+
+/** @brief Registers a counter and gets its slot */
+bool stats_counter(stats_registry_t *reg, const char *name, size_t *slot);
+
+/** @brief Registers a histogram of some buckets and gets its first slot */
+bool stats_histogram(stats_registry_t *reg, const char *name, size_t buckets,
+                     size_t *slot);
+
+/** @brief Finds a metric by name */
+const stats_metric_t *stats_find(const stats_registry_t *reg,
+                                 const char *name);
+
+/** @brief Adds to a counter, or to one bucket of a histogram */
+bool stats_add(stats_registry_t *reg, size_t slot, unsigned long n);
+
+/** @brief Gets the value of a slot */
+unsigned long stats_value(const stats_registry_t *reg, size_t slot);
+
+/** @brief Writes the values to a .csim_stats file */
+bool stats_write(const stats_registry_t *reg, const char *path);
+
+/** @brief Adds the values of the registered metrics stored in a file */
+bool stats_read(stats_registry_t *reg, const char *path);
+
+#endif /* STATS_H */
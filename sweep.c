@@ -0,0 +1,255 @@
+/**
+ * @file sweep.c
+ * @brief One-pass LRU simulation of a whole grid of cache geometries
+ *
+ * This is all-associativity simulation in the style of Hill and Smith.
+ * For each number of set bits s, every set keeps an LRU stack of the block
+ * numbers that map to it, truncated to E_max entries. An access at stack
+ * distance d (0 for the most recently used block) hits in every cache of
+ * that s with more than d ways, so one histogram of distances per s gives
+ * the hits for every E. An access evicts in every cache of that s that it
+ * misses in and whose set is full, which the distance, or for blocks
+ * beyond the stack the number of distinct blocks the set has seen, tells.
+ *
+ * With bit-selection indexing, the sets of s + 1 bits refine the sets of s
+ * bits: a set at level s + 1 holds a subset of the blocks of one set at
+ * level s, so a block's stack distance can only grow as s shrinks. The
+ * levels are therefore visited from s_max down to 0; the search at each
+ * level starts at the distance found at the level before, and once a block
+ * is beyond E_max at some level, it is a miss at all the coarser ones and
+ * no more searching is needed.
+ *
+ * Dirty bytes depend on the write history of each individual cache and are
+ * not tracked.
+ *
+ * Direct-mapped caches need no replacement state, so the direct-mapped
+ * sweep simply runs one small cache per lane. Each access is handled in
+ * two branch-free loops over the lanes, which the compiler can vectorize:
+ * the first computes every lane's line index and tag, the second gathers
+ * the lines, updates the counters and scatters the new lines back. The
+ * lanes own disjoint parts of the line array, so the scatter never
+ * conflicts.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "sweep.h"
+
+/**
+ * @brief Returns the index of the first set of a level in the per-set
+ * arrays: the levels below it hold 2**0 + ... + 2**(s-1) sets.
+ */
+static size_t level_base(int s) {
+    return ((size_t)1 << s) - 1;
+}
+
+/**
+ * @brief Allocates a sweep.
+ *
+ * @param[out] sweep  The sweep to initialize
+ * @param[in]  s_max  Largest number of set index bits
+ * @param[in]  E_max  Largest number of ways
+ * @param[in]  b      Number of block offset bits
+ *
+ * @return True if the sweep was allocated, false otherwise
+ */
+bool sweep_init(sweep_t *sweep, int s_max, int E_max, int b) {
+    memset(sweep, 0, sizeof(*sweep));
+    if (s_max < 0 || s_max > 24 || E_max <= 0 || b < 0 || s_max + b >= 64)
+        return false;
+
+    sweep->s_max = s_max;
+    sweep->E_max = E_max;
+    sweep->b = b;
+
+    size_t sets = level_base(s_max + 1);
+    size_t levels = (size_t)s_max + 1;
+    sweep->stacks = calloc(sets * (size_t)E_max, sizeof(*sweep->stacks));
+    sweep->depth = calloc(sets, sizeof(*sweep->depth));
+    sweep->hits = calloc(levels * (size_t)E_max, sizeof(*sweep->hits));
+    sweep->evictions =
+        calloc(levels * ((size_t)E_max + 1), sizeof(*sweep->evictions));
+    if (sweep->stacks == NULL || sweep->depth == NULL ||
+        sweep->hits == NULL || sweep->evictions == NULL) {
+        sweep_free(sweep);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Releases the memory held by a sweep.
+ */
+void sweep_free(sweep_t *sweep) {
+    free(sweep->stacks);
+    free(sweep->depth);
+    free(sweep->hits);
+    free(sweep->evictions);
+    sweep->stacks = NULL;
+    sweep->depth = NULL;
+    sweep->hits = NULL;
+    sweep->evictions = NULL;
+}
+
+/**
+ * @brief Simulates one access in every cache of the grid.
+ */
+void sweep_access(sweep_t *sweep, unsigned long addr) {
+    unsigned long block = addr >> sweep->b;
+    unsigned int E_max = (unsigned int)sweep->E_max;
+    unsigned int start = 0;
+    bool beyond = false;
+
+    sweep->accesses++;
+    for (int s = sweep->s_max; s >= 0; s--) {
+        size_t set = level_base(s) + (block & ((1UL << s) - 1));
+        unsigned long *stack = sweep->stacks + set * E_max;
+        unsigned int depth = sweep->depth[set];
+
+        /* Distances only grow towards coarser levels */
+        unsigned int d = depth;
+        if (!beyond) {
+            for (d = start; d < depth; d++) {
+                if (stack[d] == block)
+                    break;
+            }
+        }
+
+        if (d < depth) {
+            sweep->hits[(size_t)s * E_max + d]++;
+            start = d;
+        } else {
+            beyond = true;
+            sweep->evictions[(size_t)s * (E_max + 1) + depth]++;
+            if (depth < E_max)
+                sweep->depth[set] = ++depth;
+            d = depth - 1;
+        }
+        memmove(stack + 1, stack, d * sizeof(*stack));
+        stack[0] = block;
+    }
+}
+
+/**
+ * @brief Gets the statistics of the cache with 2**s sets of E ways.
+ *
+ * Only hits, misses and evictions are filled in; the dirty byte counts are
+ * set to 0.
+ */
+void sweep_stats(const sweep_t *sweep, int s, int E, csim_stats_t *stats) {
+    memset(stats, 0, sizeof(*stats));
+    if (s < 0 || s > sweep->s_max || E <= 0 || E > sweep->E_max)
+        return;
+
+    const unsigned long *hits = sweep->hits + (size_t)s * (size_t)sweep->E_max;
+    for (int d = 0; d < E; d++)
+        stats->hits += hits[d];
+    stats->misses = sweep->accesses - stats->hits;
+
+    /*
+     * A miss evicts when the set already holds E blocks: either the block
+     * was beyond the stacks and the set had seen at least E blocks, or it
+     * was found at a distance of E or more.
+     */
+    const unsigned long *evictions =
+        sweep->evictions + (size_t)s * ((size_t)sweep->E_max + 1);
+    for (int f = E; f <= sweep->E_max; f++)
+        stats->evictions += evictions[f];
+    for (int d = E; d < sweep->E_max; d++)
+        stats->evictions += hits[d];
+}
+
+/**
+ * @brief Allocates a direct-mapped sweep.
+ *
+ * @param[out] dm     The sweep to initialize
+ * @param[in]  lanes  Number of caches, at most DM_SWEEP_LANES
+ * @param[in]  s      Set index bits of each cache
+ * @param[in]  b      Block offset bits of each cache
+ *
+ * @return True if the sweep was allocated, false otherwise
+ */
+bool dm_sweep_init(dm_sweep_t *dm, int lanes, const int *s, const int *b) {
+    memset(dm, 0, sizeof(*dm));
+    if (lanes <= 0 || lanes > DM_SWEEP_LANES)
+        return false;
+
+    /* s + b >= 1 keeps tag + 1 from wrapping to the empty marker */
+    size_t total = 0;
+    for (int l = 0; l < lanes; l++) {
+        if (s[l] < 0 || s[l] > 24 || b[l] < 0 || s[l] + b[l] < 1 ||
+            s[l] + b[l] >= 64)
+            return false;
+        dm->s[l] = s[l];
+        dm->b[l] = b[l];
+        dm->set_mask[l] = (1UL << s[l]) - 1;
+        dm->block_bytes[l] = 1UL << b[l];
+        dm->base[l] = total;
+        total += (size_t)1 << s[l];
+    }
+    dm->lanes = lanes;
+
+    dm->lines = calloc(total, sizeof(*dm->lines));
+    dm->dirty = calloc(total, sizeof(*dm->dirty));
+    if (dm->lines == NULL || dm->dirty == NULL) {
+        dm_sweep_free(dm);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Releases the memory held by a direct-mapped sweep.
+ */
+void dm_sweep_free(dm_sweep_t *dm) {
+    free(dm->lines);
+    free(dm->dirty);
+    dm->lines = NULL;
+    dm->dirty = NULL;
+}
+
+/**
+ * @brief Simulates one load or store in every lane.
+ */
+void dm_sweep_access(dm_sweep_t *dm, unsigned long addr, bool store) {
+    size_t slot[DM_SWEEP_LANES];
+    unsigned long want[DM_SWEEP_LANES];
+    int lanes = dm->lanes;
+
+    for (int l = 0; l < lanes; l++) {
+        slot[l] = dm->base[l] + ((addr >> dm->b[l]) & dm->set_mask[l]);
+        want[l] = (addr >> (dm->s[l] + dm->b[l])) + 1;
+    }
+
+    for (int l = 0; l < lanes; l++) {
+        unsigned long line = dm->lines[slot[l]];
+        unsigned long dirty = dm->dirty[slot[l]];
+        unsigned long bytes = dm->block_bytes[l];
+        unsigned long hit = line == want[l];
+        unsigned long evict = (line != 0) & (hit ^ 1);
+        unsigned long now = (dirty & hit) | store;
+
+        dm->hits[l] += hit;
+        dm->misses[l] += hit ^ 1;
+        dm->evictions[l] += evict;
+        dm->dirty_evictions[l] += bytes & (0UL - (evict & dirty));
+        dm->dirty_bytes[l] += (bytes & (0UL - now)) - (bytes & (0UL - dirty));
+        dm->lines[slot[l]] = want[l];
+        dm->dirty[slot[l]] = (unsigned char)now;
+    }
+}
+
+/**
+ * @brief Gets the statistics of one lane of a direct-mapped sweep.
+ */
+void dm_sweep_stats(const dm_sweep_t *dm, int lane, csim_stats_t *stats) {
+    memset(stats, 0, sizeof(*stats));
+    if (lane < 0 || lane >= dm->lanes)
+        return;
+    stats->hits = dm->hits[lane];
+    stats->misses = dm->misses[lane];
+    stats->evictions = dm->evictions[lane];
+    stats->dirty_bytes = dm->dirty_bytes[lane];
+    stats->dirty_evictions = dm->dirty_evictions[lane];
+}
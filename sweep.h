@@ -0,0 +1,85 @@
+/**
+ * @file sweep.h
+ * @brief One-pass LRU simulation of a whole grid of cache geometries
+ *
+ * For a fixed block size, a sweep simulates every cache with 2**s sets for
+ * s in [0, s_max] and E ways for E in [1, E_max] in a single pass over the
+ * trace, and reports the hits, misses and evictions of each of them as a
+ * plain simulation would.
+ *
+ * A direct-mapped sweep simulates up to DM_SWEEP_LANES direct-mapped caches
+ * of arbitrary set and block bits side by side, with the full statistics of
+ * each, one lane per cache.
+ */
+
+#ifndef SWEEP_H
+#define SWEEP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "cachelab.h"
+
+/**
+ * @brief State of a sweep
+ */
+typedef struct {
+    int s_max;                /* largest number of set index bits */
+    int E_max;                /* largest number of ways */
+    int b;                    /* number of block offset bits */
+    unsigned long *stacks;    /* per level and set: E_max block numbers,
+                                 most recently used first */
+    unsigned int *depth;      /* per level and set: valid stack entries */
+    unsigned long *hits;      /* per level: hits at each stack distance */
+    unsigned long *evictions; /* per level: misses with each set fill */
+    unsigned long accesses;   /* number of accesses so far */
+} sweep_t;
+
+/** @brief Allocates a sweep over s in [0, s_max] and E in [1, E_max] */
+bool sweep_init(sweep_t *sweep, int s_max, int E_max, int b);
+
+/** @brief Releases the memory held by a sweep */
+void sweep_free(sweep_t *sweep);
+
+/** @brief Simulates one access in every cache of the grid */
+void sweep_access(sweep_t *sweep, unsigned long addr);
+
+/** @brief Gets the hits, misses and evictions of one cache of the grid */
+void sweep_stats(const sweep_t *sweep, int s, int E, csim_stats_t *stats);
+
+/** @brief Largest number of caches in a direct-mapped sweep */
+#define DM_SWEEP_LANES 16
+
+/**
+ * @brief State of a direct-mapped sweep, one array entry per lane
+ */
+typedef struct {
+    int lanes;                                   /* number of caches */
+    int s[DM_SWEEP_LANES];                       /* set index bits */
+    int b[DM_SWEEP_LANES];                       /* block offset bits */
+    unsigned long set_mask[DM_SWEEP_LANES];      /* 2**s - 1 */
+    unsigned long block_bytes[DM_SWEEP_LANES];   /* 2**b */
+    size_t base[DM_SWEEP_LANES];                 /* first line of the lane */
+    unsigned long *lines;                        /* tag + 1 of each line,
+                                                    0 if empty */
+    unsigned char *dirty;                        /* dirty flag of each line */
+    unsigned long hits[DM_SWEEP_LANES];
+    unsigned long misses[DM_SWEEP_LANES];
+    unsigned long evictions[DM_SWEEP_LANES];
+    unsigned long dirty_bytes[DM_SWEEP_LANES];
+    unsigned long dirty_evictions[DM_SWEEP_LANES];
+} dm_sweep_t;
+
+/** @brief Allocates a direct-mapped sweep over the given geometries */
+bool dm_sweep_init(dm_sweep_t *dm, int lanes, const int *s, const int *b);
+
+/** @brief Releases the memory held by a direct-mapped sweep */
+void dm_sweep_free(dm_sweep_t *dm);
+
+/** @brief Simulates one load or store in every lane */
+void dm_sweep_access(dm_sweep_t *dm, unsigned long addr, bool store);
+
+/** @brief Gets the statistics of one lane */
+void dm_sweep_stats(const dm_sweep_t *dm, int lane, csim_stats_t *stats);
+
+#endif /* SWEEP_H */
@@ -5,9 +5,18 @@
  * This program checks the correctness of a student's test cache simulator
  * (csim) by comparing its output to a reference simulator provided by the
  * instructors (csim-ref).
+ *
+ * Every simulator run happens in its own private temporary directory, so
+ * the reference and test simulators, and any number of test cases, can run
+ * concurrently without sharing a .csim_results file. Besides the graded
+ * traces, -f adds a matrix of random s/E/b configurations that is checked
+ * the same way but does not count towards the score.
  */
 
+#define _GNU_SOURCE
+
 #include <errno.h>
+#include <fcntl.h>
 #include <getopt.h>
 #include <limits.h>
 #include <signal.h>
@@ -56,15 +65,51 @@ static const trace_info_t TRACE_INFO[N] = {
     {.s = 5, .E = 1, .b = 5, .weight = 2, .filename = TRACES_DIR "long.trace"},
 };
 
-static int num_runs = 0; // used to randomize input to students' csim
+/** @brief Traces the fuzz matrix draws from (long.trace is too slow) */
+static const char *const FUZZ_TRACES[] = {
+    TRACES_DIR "wide.trace", TRACES_DIR "load.trace", TRACES_DIR "yi.trace",
+    TRACES_DIR "yi2.trace",  TRACES_DIR "dave.trace", TRACES_DIR "trans.trace",
+};
+
+#define NFUZZ_TRACES (sizeof(FUZZ_TRACES) / sizeof(FUZZ_TRACES[0]))
+
+/** @brief Maximum number of simulator arguments */
+#define MAX_ARGS 16
+
+/** @brief One simulator invocation, run in its own private directory */
+typedef struct {
+    char *argv[MAX_ARGS];
+    char args[MAX_ARGS][MAX_STR];
+    char dir[MAX_STR];
+    pid_t pid;
+    bool success;
+    csim_stats_t stats;
+} csim_job_t;
+
+/** @brief One simulation compared between csim-ref and csim */
+typedef struct {
+    trace_info_t info;
+    char path[PATH_MAX];
+    csim_job_t ref;
+    csim_job_t test;
+} csim_case_t;
+
+static char ref_path[PATH_MAX];  // absolute path of csim-ref
+static char test_path[PATH_MAX]; // absolute path of csim
+static int num_jobs = 1;         // simulators run concurrently
+static int num_fuzz = 0;         // randomized configs checked after grading
+static unsigned int fuzz_seed = 213;
 
 /*
  * usage - Prints usage info
  */
 static void usage(char *argv[]) {
-    printf("Usage: %s [-h]\n", argv[0]);
+    printf("Usage: %s [-h] [-j jobs] [-f count] [-S seed]\n", argv[0]);
     printf("Options:\n");
-    printf("  -h    Print this help message.\n");
+    printf("  -h        Print this help message.\n");
+    printf("  -j jobs   Number of simulators to run concurrently.\n");
+    printf("  -f count  Also check count random s/E/b configurations.\n");
+    printf("  -S seed   Seed for the random configurations.\n");
 }
 
 /**
@@ -79,103 +124,180 @@ static void sigalrm_handler(int signum) {
 }
 
 /**
- * @brief Runs a cache simulation and collects the resulting statistics.
+ * @brief Fills in the command line of a simulator job.
  *
- * @param[in]  cmd    The command used to invoke csim
- * @param[out] stats  The statistics collected from this simulation run
+ * The arguments are given as "-s", "-E", "-b" and "-t" pairs in the order
+ * selected by variant, so that the test simulator is checked with
+ * differently ordered command lines.
+ */
+static void build_job(csim_job_t *job, const char *prog,
+                      const trace_info_t *info, const char *path,
+                      int variant) {
+    /* addition 9/28/2017 F17: randomize input to csim to test
+     * that students don't hardcode argument parsing */
+    static const char ORDERS[4][5] = {"bstE", "tEsb", "Ebts", "sEbt"};
+    int argc = 0;
+
+    strcpy(job->args[argc++], prog);
+    for (const char *o = ORDERS[variant % 4]; *o != '\0'; o++) {
+        sprintf(job->args[argc++], "-%c", *o);
+        switch (*o) {
+        case 's':
+            sprintf(job->args[argc++], "%d", info->s);
+            break;
+        case 'E':
+            sprintf(job->args[argc++], "%d", info->E);
+            break;
+        case 'b':
+            sprintf(job->args[argc++], "%d", info->b);
+            break;
+        case 't':
+            strcpy(job->args[argc++], path);
+            break;
+        }
+    }
+    for (int i = 0; i < argc; i++)
+        job->argv[i] = job->args[i];
+    job->argv[argc] = NULL;
+    job->pid = 0;
+    job->success = false;
+    job->stats.hits = job->stats.misses = job->stats.evictions =
+        job->stats.dirty_bytes = job->stats.dirty_evictions = ULONG_MAX;
+}
+
+/**
+ * @brief Starts a simulator job in a fresh private directory.
+ *
+ * Each job gets its own working directory, so its .csim_results file
+ * cannot be clobbered by any job running concurrently.
  *
  * @return false if any problems, true if OK.
  */
-static bool run_csim(const char *cmd, csim_stats_t *stats) {
-    int status;
-
-    status = unlink(".csim_results");
-    if (status < 0 && errno != ENOENT) {
-        fprintf(stderr, "Error removing old simulation results: %s\n",
+static bool start_job(csim_job_t *job) {
+    strcpy(job->dir, "/tmp/test-csim.XXXXXX");
+    if (mkdtemp(job->dir) == NULL) {
+        fprintf(stderr, "Error creating simulation directory: %s\n",
                 strerror(errno));
         return false;
     }
 
-    /* Run the simulator command */
-    status = system(cmd);
-    if (status < 0) {
+    job->pid = fork();
+    if (job->pid < 0) {
         fprintf(stderr, "Error invoking csim: %s\n", strerror(errno));
+        rmdir(job->dir);
         return false;
     }
+    if (job->pid == 0) {
+        int devnull = open("/dev/null", O_WRONLY);
+        if (devnull < 0 || dup2(devnull, STDOUT_FILENO) < 0 ||
+            chdir(job->dir) < 0)
+            _exit(126);
+        execv(job->argv[0], job->argv);
+        _exit(127);
+    }
+    return true;
+}
+
+/**
+ * @brief Collects the results of a finished simulator job.
+ */
+static void finish_job(csim_job_t *job, int status) {
+    char path[MAX_STR + 16];
+
     if (WIFEXITED(status) && WEXITSTATUS(status) != 0) {
         fprintf(stderr, "Error running csim: Status %d\n", WEXITSTATUS(status));
-        return false;
+    } else if (!WIFEXITED(status)) {
+        fprintf(stderr, "Error running csim: killed by signal %d\n",
+                WTERMSIG(status));
+    } else {
+        /* Get the results from the simulator */
+        job->success = loadSummaryAt(job->dir, &job->stats);
+        if (!job->success) {
+            fprintf(stderr, "Error: Results for csim not found. Use the "
+                            "printSummary() function\n");
+        }
     }
 
-    /* Get the results from the simulator */
-    bool success = loadSummary(stats);
-    if (!success) {
-        fprintf(stderr, "Error: Results for csim not found. Use the "
-                        "printSummary() function\n");
+    if (!job->success) {
+        fprintf(stderr, "Running simulator failed: '");
+        for (int i = 0; job->argv[i] != NULL; i++)
+            fprintf(stderr, "%s%s", i > 0 ? " " : "", job->argv[i]);
+        fprintf(stderr, "'\n\n");
     }
 
-    status = unlink(".csim_results");
-    (void)status;
+    sprintf(path, "%s/.csim_results", job->dir);
+    unlink(path);
+    sprintf(path, "%s/.csim_stats", job->dir);
+    unlink(path);
+    rmdir(job->dir);
+}
 
-    return success;
+/**
+ * @brief Runs all jobs, keeping up to num_jobs simulators in flight.
+ */
+static void run_jobs(csim_job_t **jobs, size_t count) {
+    size_t next = 0;
+    size_t running = 0;
+
+    while (next < count || running > 0) {
+        while (next < count && running < (size_t)num_jobs) {
+            if (start_job(jobs[next]))
+                running++;
+            next++;
+        }
+        if (running == 0)
+            break;
+
+        int status;
+        pid_t pid = wait(&status);
+        if (pid < 0) {
+            fprintf(stderr, "Error waiting for csim: %s\n", strerror(errno));
+            return;
+        }
+        for (size_t i = 0; i < next; i++) {
+            if (jobs[i]->pid == pid) {
+                finish_job(jobs[i], status);
+                jobs[i]->pid = 0;
+                running--;
+                break;
+            }
+        }
+    }
 }
 
-/*
- * @brief Collects run results for a particular trace
- *
- * Runs the reference and trace simulators on a particular trace and set of
- * cache parameters, and collects the results for the caller.
- *
- * @param[in]  info        Information about the trace to run
- * @param[out] ref_stats   Statistics for the reference simulator
- * @param[out] test_stats  Statistics for the simulator being tested
+/**
+ * @brief Prepares the reference and test runs for one case.
  *
  * @return false if any problems, true if OK.
  */
-static bool runtrace(const trace_info_t *info, csim_stats_t *ref_stats,
-                     csim_stats_t *test_stats) {
-    char cmd[MAX_STR];
-
-    /* Run the reference simulator */
-    sprintf(cmd, "./csim-ref -s %d -E %d -b %d -t %s > /dev/null", info->s,
-            info->E, info->b, info->filename);
-    if (!run_csim(cmd, ref_stats)) {
-        fprintf(stderr, "Running reference simulator failed: '%s'\n", cmd);
-        fprintf(stderr, "\n");
+static bool setup_case(csim_case_t *c, const trace_info_t *info,
+                       int variant) {
+    c->info = *info;
+    if (realpath(info->filename, c->path) == NULL) {
+        fprintf(stderr, "Error: cannot find trace %s: %s\n", info->filename,
+                strerror(errno));
         return false;
     }
+    build_job(&c->ref, ref_path, info, c->path, 3);
+    build_job(&c->test, test_path, info, c->path, variant);
+    return true;
+}
 
-    /* Run the test simulator */
-    /* addition 9/28/2017 F17: randomize input to csim to test
-     * that students don't hardcode argument parsing */
-    switch (num_runs % 4) {
-    case 0:
-        sprintf(cmd, "./csim -b %d -s %d -t %s -E %d > /dev/null", info->b,
-                info->s, info->filename, info->E);
-        break;
-    case 1:
-        sprintf(cmd, "./csim -t %s -E %d -s %d -b %d > /dev/null",
-                info->filename, info->E, info->s, info->b);
-        break;
-    case 2:
-        sprintf(cmd, "./csim -E %d -b %d -t %s -s %d > /dev/null", info->E,
-                info->b, info->filename, info->s);
-        break;
-    case 3:
-        sprintf(cmd, "./csim -s %d -E %d -b %d -t %s > /dev/null", info->s,
-                info->E, info->b, info->filename);
-        break;
+/**
+ * @brief Runs every case, reference and test simulators concurrently.
+ */
+static void run_cases(csim_case_t *cases, size_t count) {
+    csim_job_t **jobs = malloc(2 * count * sizeof(*jobs));
+    if (jobs == NULL) {
+        fprintf(stderr, "Error: out of memory\n");
+        return;
     }
-
-    num_runs = num_runs + 1;
-
-    if (!run_csim(cmd, test_stats)) {
-        fprintf(stderr, "Running test simulator failed: '%s'\n", cmd);
-        fprintf(stderr, "\n");
-        return false;
+    for (size_t i = 0; i < count; i++) {
+        jobs[2 * i] = &cases[i].ref;
+        jobs[2 * i + 1] = &cases[i].test;
     }
-
-    return true;
+    run_jobs(jobs, 2 * count);
+    free(jobs);
 }
 
 /**
@@ -209,32 +331,63 @@ static void print_trace_results(int points, const trace_info_t *info,
     printf("  %s\n", info->filename);
 }
 
+/**
+ * @brief Draws a random cache configuration for the fuzz matrix.
+ *
+ * Mostly small associativities, which exercise eviction the hardest, with
+ * an occasional wide set.
+ */
+static trace_info_t random_config(unsigned int *seed) {
+    trace_info_t info;
+    info.s = rand_r(seed) % 13;
+    info.b = rand_r(seed) % 7;
+    if (rand_r(seed) % 4 != 0)
+        info.E = 1 + rand_r(seed) % 16;
+    else
+        info.E = 17 + rand_r(seed) % 496;
+    info.weight = 0;
+    info.filename = FUZZ_TRACES[(size_t)rand_r(seed) % NFUZZ_TRACES];
+    return info;
+}
+
 /**
  * @brief Checks the student's test simulator for correctness by
  *        comparing its results to the reference simulator.
+ *
+ * The graded traces and the optional fuzz matrix are all run up front,
+ * with the reference and test simulators running concurrently.
  */
 static void test_csim(void) {
-    /* Output results */
-    csim_stats_t ref_stats[N];
-    csim_stats_t test_stats[N];
+    size_t count = N + (size_t)num_fuzz;
+    csim_case_t *cases = calloc(count, sizeof(*cases));
     int points[N];
     int total_points = 0;
 
-    /* Initialize arrays */
-    for (int i = 0; i < N; i++) {
-        points[i] = 0;
-        ref_stats[i].hits = ref_stats[i].misses = ref_stats[i].evictions =
-            ref_stats[i].dirty_bytes = ref_stats[i].dirty_evictions = ULONG_MAX;
-        test_stats[i].hits = test_stats[i].misses = test_stats[i].evictions =
-            test_stats[i].dirty_bytes = test_stats[i].dirty_evictions =
-                ULONG_MAX;
+    if (cases == NULL) {
+        fprintf(stderr, "Error: out of memory\n");
+        printf("\nTEST_CSIM_RESULTS=0\n");
+        return;
+    }
+
+    /* Set up the graded tests, then the random configurations */
+    unsigned int seed = fuzz_seed;
+    for (size_t i = 0; i < count; i++) {
+        trace_info_t info = i < N ? TRACE_INFO[i] : random_config(&seed);
+        if (!setup_case(&cases[i], &info, (int)i)) {
+            printf("\nTEST_CSIM_RESULTS=0\n");
+            free(cases);
+            return;
+        }
     }
 
     /* Run the individual tests */
+    run_cases(cases, count);
+
     for (int i = 0; i < N; i++) {
-        bool success = runtrace(&TRACE_INFO[i], &ref_stats[i], &test_stats[i]);
-        if (success) {
-            points[i] = count_matches(&ref_stats[i], &test_stats[i]) *
+        points[i] = 0;
+        if (cases[i].ref.success && cases[i].test.success) {
+            points[i] = count_matches(&cases[i].ref.stats,
+                                      &cases[i].test.stats) *
                         TRACE_INFO[i].weight;
         }
         total_points += points[i];
@@ -247,14 +400,34 @@ static void test_csim(void) {
            "Evicts", "D_Cache", "D_Evict");
 
     for (int i = 0; i < N; i++) {
-        print_trace_results(points[i], &TRACE_INFO[i], &test_stats[i],
-                            &ref_stats[i]);
+        print_trace_results(points[i], &TRACE_INFO[i], &cases[i].test.stats,
+                            &cases[i].ref.stats);
     }
 
     printf("%6d\n", total_points);
 
+    /* Report the fuzz matrix separately; it does not affect the score */
+    if (num_fuzz > 0) {
+        int passed = 0;
+        int shown = 0;
+        for (size_t i = N; i < count; i++) {
+            const csim_case_t *c = &cases[i];
+            if (c->ref.success && c->test.success &&
+                count_matches(&c->ref.stats, &c->test.stats) == 5) {
+                passed++;
+            } else if (shown++ < 10) {
+                print_trace_results(0, &c->info, &c->test.stats,
+                                    &c->ref.stats);
+            }
+        }
+        printf("\nFuzz: %d of %d random configurations match (seed %u)\n",
+               passed, num_fuzz, fuzz_seed);
+        printf("TEST_CSIM_FUZZ=%d/%d\n", passed, num_fuzz);
+    }
+
     /* Print a compact summary string for the driver */
     printf("\nTEST_CSIM_RESULTS=%d\n", total_points);
+    free(cases);
 }
 
 /**
@@ -263,9 +436,21 @@ static void test_csim(void) {
 int main(int argc, char *argv[]) {
     int c;
 
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    num_jobs = cpus > 0 ? (int)cpus : 1;
+
     /* Parse command line args */
-    while ((c = getopt(argc, argv, "h")) != -1) {
+    while ((c = getopt(argc, argv, "hj:f:S:")) != -1) {
         switch (c) {
+        case 'j':
+            num_jobs = atoi(optarg);
+            break;
+        case 'f':
+            num_fuzz = atoi(optarg);
+            break;
+        case 'S':
+            fuzz_seed = (unsigned int)strtoul(optarg, NULL, 0);
+            break;
         case 'h':
             usage(argv);
             exit(0);
@@ -274,6 +459,19 @@ int main(int argc, char *argv[]) {
             exit(1);
         }
     }
+    if (num_jobs <= 0 || num_fuzz < 0) {
+        usage(argv);
+        exit(1);
+    }
+
+    /* Jobs run in private directories, so they need absolute paths */
+    if (realpath("./csim-ref", ref_path) == NULL ||
+        realpath("./csim", test_path) == NULL) {
+        fprintf(stderr, "Error: ./csim-ref and ./csim must exist: %s\n",
+                strerror(errno));
+        printf("\nTEST_CSIM_RESULTS=0\n");
+        exit(1);
+    }
 
     /* Install timeout handler */
     if (signal(SIGALRM, sigalrm_handler) == SIG_ERR) {
@@ -281,8 +479,8 @@ int main(int argc, char *argv[]) {
         exit(1);
     }
 
-    /* Time out and give up after a while */
-    alarm(20);
+    /* Time out and give up after a while, allowing for the fuzz matrix */
+    alarm(20 + (unsigned int)num_fuzz / 50);
 
     /* Evaluate the student's cache simulator for correctness */
     test_csim();
@@ -0,0 +1,1421 @@
+/**
+ * @file test-features.c
+ * @brief Checks the csim options that test-csim does not grade
+ *
+ * test-csim compares the five summary values of csim with those of
+ * csim-ref, which knows none of the other options of csim. This program
+ * runs csim on the lab's traces and on small traces it writes itself, and
+ * checks what those options report, against values worked out by hand or
+ * against another way of getting the same numbers. Nothing here counts
+ * towards the score.
+ *
+ * Every run happens in its own private temporary directory, with its
+ * standard output and error captured. A run that saves named statistics
+ * must store the same five summary values in .csim_stats as in
+ * .csim_results.
+ */
+
+#define _GNU_SOURCE
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <limits.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "cachelab.h"
+#include "stats.h"
+#include "translate.h"
+
+/** @brief Directory where all traces are located */
+#define TRACES_DIR "traces/csim/"
+
+/** @brief Maximum number of arguments of a run */
+#define MAX_ARGS 24
+
+/** @brief Bytes of output kept from a run */
+#define MAX_OUTPUT 65536
+
+/** @brief The outcome of one program run */
+typedef struct {
+    bool ok;          /* exited with status 0 and consistent statistics */
+    int status;       /* exit status, or -1 if it did not exit */
+    bool has_summary; /* .csim_results was written */
+    bool has_named;   /* .csim_stats was written */
+    csim_stats_t stats;
+    char output[MAX_OUTPUT]; /* standard output and error */
+} run_t;
+
+/** @brief A cache configuration run on one of the lab's traces */
+typedef struct {
+    int s;
+    int E;
+    int b;
+    const char *filename;
+} trace_info_t;
+
+/** @brief Configurations whose .csim_stats are checked */
+static const trace_info_t STATS_INFO[] = {
+    {.s = 0, .E = 1, .b = 0, .filename = TRACES_DIR "wide.trace"},
+    {.s = 3, .E = 2, .b = 2, .filename = TRACES_DIR "load.trace"},
+    {.s = 4, .E = 2, .b = 4, .filename = TRACES_DIR "yi.trace"},
+    {.s = 2, .E = 1, .b = 4, .filename = TRACES_DIR "dave.trace"},
+    {.s = 2, .E = 2, .b = 3, .filename = TRACES_DIR "trans.trace"},
+    {.s = 5, .E = 1, .b = 5, .filename = TRACES_DIR "long.trace"},
+};
+
+#define NSTATS_INFO (sizeof(STATS_INFO) / sizeof(STATS_INFO[0]))
+
+/** @brief Caches of several MiB of state, simulated with --out-of-core */
+static const trace_info_t OOC_INFO[] = {
+    {.s = 16, .E = 4, .b = 4, .filename = "ooc.trace"},
+    {.s = 13, .E = 20, .b = 4, .filename = "ooc.trace"},
+};
+
+#define NOOC (sizeof(OOC_INFO) / sizeof(OOC_INFO[0]))
+
+/** @brief Accesses of the trace written for the out-of-core checks */
+#define OOC_ACCESSES 200000
+
+/** @brief Accesses per chunk of the packed long.trace, which gives 15 */
+#define PACK_CHUNK 20000
+
+/** @brief Decoding threads the packed trace is simulated with */
+static const char *const PACK_THREADS[] = {"1", "2", "4"};
+
+#define NPACK_THREADS (sizeof(PACK_THREADS) / sizeof(PACK_THREADS[0]))
+
+/** @brief Ranges of chunks simulated with --chunks (count 0: the rest) */
+static const struct {
+    unsigned long first;
+    unsigned long count;
+} PACK_RANGES[] = {{0, 1}, {3, 4}, {13, 5}, {14, 0}, {20, 2}};
+
+#define NPACK_RANGES (sizeof(PACK_RANGES) / sizeof(PACK_RANGES[0]))
+
+/** @brief Bytes of text parsed by one job, TEXT_RANGE_BYTES in trace.c */
+#define TEXT_RANGE (1UL << 20)
+
+/** @brief Ranges of the text trace written for the threaded parsing checks */
+#define TEXT_RANGES 6
+
+/** @brief Parsing threads that trace is simulated with */
+static const char *const TEXT_THREADS[] = {"1", "2", "4", "8"};
+
+#define NTEXT_THREADS (sizeof(TEXT_THREADS) / sizeof(TEXT_THREADS[0]))
+
+/** @brief Cache the packed trace is simulated on */
+#define PACK_GEOMETRY "-s", "5", "-E", "2", "-b", "5"
+
+static char csim_path[PATH_MAX];                      // absolute path of csim
+static char pack_path[PATH_MAX];                      // and of trace-pack
+static char work_dir[] = "/tmp/test-features.XXXXXX"; // traces written here
+static int num_checks = 0;
+static int num_passed = 0;
+static bool verbose = false;
+
+/*
+ * usage - Prints usage info
+ */
+static void usage(char *argv[]) {
+    printf("Usage: %s [-h] [-v]\n", argv[0]);
+    printf("Options:\n");
+    printf("  -h  Print this help message.\n");
+    printf("  -v  Print the output of the runs of failed checks.\n");
+}
+
+/**
+ * @brief SIGALRM handler
+ */
+static void sigalrm_handler(int signum) {
+    const char *msg = "Error: Program timed out.\n";
+    ssize_t res = write(STDOUT_FILENO, msg, strlen(msg));
+    (void)res;
+    _exit(1);
+}
+
+/**
+ * @brief Records the outcome of one check.
+ */
+static void check(bool ok, const run_t *run, const char *fmt, ...) {
+    va_list ap;
+
+    num_checks++;
+    num_passed += ok;
+    printf("%s: ", ok ? "PASS" : "FAIL");
+    va_start(ap, fmt);
+    vprintf(fmt, ap);
+    va_end(ap);
+    printf("\n");
+    if (!ok && verbose && run != NULL)
+        printf("%s", run->output);
+}
+
+/**
+ * @brief Removes a directory and the files in it.
+ */
+static void remove_dir(const char *dir) {
+    DIR *d = opendir(dir);
+    if (d != NULL) {
+        struct dirent *e;
+        char path[PATH_MAX + 256];
+        while ((e = readdir(d)) != NULL) {
+            if (strcmp(e->d_name, ".") == 0 || strcmp(e->d_name, "..") == 0)
+                continue;
+            snprintf(path, sizeof(path), "%s/%s", dir, e->d_name);
+            unlink(path);
+        }
+        closedir(d);
+    }
+    rmdir(dir);
+}
+
+/**
+ * @brief Checks the .csim_stats file of a run against the summary it
+ * stored in .csim_results.
+ *
+ * @return false if the file is malformed or disagrees with the summary
+ */
+static bool check_named_stats(const char *path, const csim_stats_t *stats) {
+    static const char *const NAMES[5] = {"hits", "misses", "evictions",
+                                         "dirty_bytes", "dirty_evictions"};
+    const unsigned long summary[5] = {stats->hits, stats->misses,
+                                      stats->evictions, stats->dirty_bytes,
+                                      stats->dirty_evictions};
+    size_t slots[5];
+    stats_registry_t reg;
+    bool ok = true;
+
+    stats_init(&reg);
+    for (int i = 0; i < 5; i++)
+        stats_counter(&reg, NAMES[i], &slots[i]);
+    if (!stats_read(&reg, path)) {
+        ok = false;
+    } else {
+        for (int i = 0; i < 5 && ok; i++) {
+            if (stats_value(&reg, slots[i]) != summary[i]) {
+                fprintf(stderr,
+                        "Error: %s is %lu in .csim_stats but %lu in "
+                        ".csim_results\n",
+                        NAMES[i], stats_value(&reg, slots[i]), summary[i]);
+                ok = false;
+            }
+        }
+    }
+    stats_free(&reg);
+    return ok;
+}
+
+/**
+ * @brief Creates a trace in the work directory.
+ *
+ * @param[in]  name  File name of the trace
+ * @param[out] path  Absolute path of the trace, PATH_MAX bytes
+ *
+ * @return The trace open for writing, or NULL if any problems
+ */
+static FILE *create_trace(const char *name, char *path) {
+    snprintf(path, PATH_MAX, "%s/%s", work_dir, name);
+    FILE *fp = fopen(path, "w");
+    if (fp == NULL)
+        fprintf(stderr, "Error creating %s: %s\n", path, strerror(errno));
+    return fp;
+}
+
+/**
+ * @brief Closes a trace written by create_trace().
+ *
+ * @return false if it could not be written
+ */
+static bool close_trace(FILE *fp, const char *path) {
+    if (fclose(fp) != 0) {
+        fprintf(stderr, "Error writing %s: %s\n", path, strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Writes a trace of the given text in the work directory.
+ *
+ * @param[in]  name  File name of the trace
+ * @param[in]  text  Contents of the trace
+ * @param[out] path  Absolute path of the trace, PATH_MAX bytes
+ *
+ * @return false if any problems, true if OK.
+ */
+static bool write_trace(const char *name, const char *text, char *path) {
+    FILE *fp = create_trace(name, path);
+    if (fp == NULL)
+        return false;
+    fputs(text, fp);
+    return close_trace(fp, path);
+}
+
+/**
+ * @brief Checks whether a run printed a line.
+ */
+static bool has_line(const run_t *run, const char *line) {
+    size_t len = strlen(line);
+    for (const char *p = run->output; (p = strstr(p, line)) != NULL; p++) {
+        if ((p == run->output || p[-1] == '\n') &&
+            (p[len] == '\n' || p[len] == '\0'))
+            return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Checks whether two runs gave the same five summary values.
+ */
+static bool same_stats(const run_t *a, const run_t *b) {
+    return a->has_summary && b->has_summary &&
+           a->stats.hits == b->stats.hits &&
+           a->stats.misses == b->stats.misses &&
+           a->stats.evictions == b->stats.evictions &&
+           a->stats.dirty_bytes == b->stats.dirty_bytes &&
+           a->stats.dirty_evictions == b->stats.dirty_evictions;
+}
+
+/**
+ * @brief Runs a program in a fresh private directory and collects its
+ * output and results.
+ *
+ * @param[out] run   The outcome of the run
+ * @param[in]  argv  The command line, argv[0] being an absolute path
+ *
+ * @return false if the program could not be run at all
+ */
+static bool run_argv(run_t *run, const char *const argv[]) {
+    char dir[] = "/tmp/test-features-run.XXXXXX";
+    char path[sizeof(dir) + 32];
+
+    memset(run, 0, sizeof(*run));
+    run->status = -1;
+    if (mkdtemp(dir) == NULL) {
+        fprintf(stderr, "Error creating run directory: %s\n",
+                strerror(errno));
+        return false;
+    }
+
+    sprintf(path, "%s/output", dir);
+    pid_t pid = fork();
+    if (pid < 0) {
+        fprintf(stderr, "Error invoking %s: %s\n", argv[0], strerror(errno));
+        rmdir(dir);
+        return false;
+    }
+    if (pid == 0) {
+        int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+        if (fd < 0 || dup2(fd, STDOUT_FILENO) < 0 ||
+            dup2(fd, STDERR_FILENO) < 0 || chdir(dir) < 0)
+            _exit(126);
+        execv(argv[0], (char *const *)argv);
+        _exit(127);
+    }
+
+    int status;
+    if (waitpid(pid, &status, 0) == pid && WIFEXITED(status))
+        run->status = WEXITSTATUS(status);
+
+    FILE *fp = fopen(path, "r");
+    if (fp != NULL) {
+        size_t n = fread(run->output, 1, MAX_OUTPUT - 1, fp);
+        run->output[n] = '\0';
+        fclose(fp);
+    }
+
+    sprintf(path, "%s/.csim_results", dir);
+    run->has_summary =
+        access(path, F_OK) == 0 && loadSummaryAt(dir, &run->stats);
+    run->ok = run->status == 0;
+    sprintf(path, "%s/.csim_stats", dir);
+    run->has_named = access(path, F_OK) == 0;
+    if (run->has_named &&
+        (!run->has_summary || !check_named_stats(path, &run->stats)))
+        run->ok = false;
+
+    remove_dir(dir);
+    return true;
+}
+
+/**
+ * @brief Runs a program with the arguments left in ap, up to a NULL.
+ */
+static bool run_va(run_t *run, const char *prog, va_list ap) {
+    const char *argv[MAX_ARGS + 1];
+    int argc = 0;
+    const char *arg;
+
+    argv[argc++] = prog;
+    while ((arg = va_arg(ap, const char *)) != NULL && argc < MAX_ARGS)
+        argv[argc++] = arg;
+    argv[argc] = NULL;
+    return run_argv(run, argv) && run->ok;
+}
+
+/**
+ * @brief Runs csim with the arguments given, up to a NULL.
+ *
+ * @return true if it exited with status 0 and consistent statistics
+ */
+static bool run_csim(run_t *run, ...) {
+    va_list ap;
+
+    va_start(ap, run);
+    bool ok = run_va(run, csim_path, ap);
+    va_end(ap);
+    return ok;
+}
+
+/**
+ * @brief Runs trace-pack with the arguments given, up to a NULL.
+ *
+ * @return true if it exited with status 0
+ */
+static bool run_pack(run_t *run, ...) {
+    va_list ap;
+
+    va_start(ap, run);
+    bool ok = run_va(run, pack_path, ap);
+    va_end(ap);
+    return ok;
+}
+
+/**
+ * @brief Checks that every run of csim on the lab's traces stores the same
+ * five summary values in .csim_stats as in .csim_results.
+ */
+static void test_named_stats(void) {
+    static run_t run;
+    char trace[PATH_MAX];
+    char s[16], E[16], b[16];
+
+    for (size_t i = 0; i < NSTATS_INFO; i++) {
+        const trace_info_t *info = &STATS_INFO[i];
+        if (realpath(info->filename, trace) == NULL) {
+            check(false, NULL, "stats: cannot find %s", info->filename);
+            continue;
+        }
+        sprintf(s, "%d", info->s);
+        sprintf(E, "%d", info->E);
+        sprintf(b, "%d", info->b);
+        bool ok = run_csim(&run, "-s", s, "-E", E, "-b", b, "-t", trace,
+                           NULL);
+        check(ok && run.has_named, &run,
+              "stats: .csim_stats matches .csim_results (%s,%s,%s) %s", s, E,
+              b, info->filename);
+    }
+}
+
+/**
+ * @brief Writes the accesses of some chunks of a packed trace as a text
+ * trace, taking its lines from the unpacked text.
+ *
+ * @param[in]  text   The packed trace unpacked by trace-pack -d
+ * @param[in]  first  First chunk
+ * @param[in]  count  Number of chunks, 0 for all the rest
+ * @param[out] path   Absolute path of the text trace, PATH_MAX bytes
+ *
+ * @return false if any problems, true if OK.
+ */
+static bool write_chunk_slice(const char *text, unsigned long first,
+                              unsigned long count, char *path) {
+    unsigned long begin = first * PACK_CHUNK;
+    unsigned long end = count > 0 ? begin + count * PACK_CHUNK : ULONG_MAX;
+    FILE *in = fopen(text, "r");
+    if (in == NULL)
+        return false;
+    FILE *out = create_trace("slice.trace", path);
+    if (out == NULL) {
+        fclose(in);
+        return false;
+    }
+    char *line = NULL;
+    size_t cap = 0;
+    for (unsigned long i = 0; i < end && getline(&line, &cap, in) != -1;
+         i++) {
+        if (i >= begin)
+            fputs(line, out);
+    }
+    free(line);
+    fclose(in);
+    return close_trace(out, path);
+}
+
+/**
+ * @brief Writes a copy of a packed trace with one of its bytes changed.
+ *
+ * @param[in]  bin     The packed trace
+ * @param[in]  keep    Bytes of it to write, fewer than its size to
+ *                     truncate it
+ * @param[in]  offset  Offset of the byte to change, or keep to change none
+ * @param[in]  value   New value of the byte
+ * @param[out] path    Absolute path of the copy, PATH_MAX bytes
+ *
+ * @return false if any problems, true if OK.
+ */
+static bool write_corrupt(const unsigned char *bin, size_t keep,
+                          size_t offset, unsigned char value, char *path) {
+    FILE *fp = create_trace("corrupt.bin", path);
+    if (fp == NULL)
+        return false;
+    for (size_t i = 0; i < keep; i++)
+        fputc(i == offset ? value : bin[i], fp);
+    return close_trace(fp, path);
+}
+
+/**
+ * @brief Reads a whole file into memory.
+ *
+ * @return The contents, to free, or NULL if any problems
+ */
+static unsigned char *read_file(const char *path, size_t *size) {
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL)
+        return NULL;
+    unsigned char *buf = NULL;
+    if (fseek(fp, 0, SEEK_END) == 0) {
+        long len = ftell(fp);
+        rewind(fp);
+        buf = len > 0 ? malloc((size_t)len) : NULL;
+        if (buf != NULL && fread(buf, 1, (size_t)len, fp) != (size_t)len) {
+            free(buf);
+            buf = NULL;
+        }
+        *size = len > 0 ? (size_t)len : 0;
+    }
+    fclose(fp);
+    return buf;
+}
+
+/**
+ * @brief Checks the binary trace format end to end.
+ *
+ * long.trace is packed by trace-pack into chunks of PACK_CHUNK accesses
+ * and unpacked again, and csim must give the same results on the text,
+ * the unpacked text and the packed trace, decoded by any number of
+ * threads. Ranges of chunks simulated with --chunks must match the same
+ * lines of the unpacked text. Copies of the packed trace with a broken
+ * footer or index must be rejected, and a garbled chunk must not crash.
+ */
+static void test_binary_trace(void) {
+    static run_t text, run;
+    char trace[PATH_MAX], bin[PATH_MAX], unpacked[PATH_MAX], slice[PATH_MAX];
+    char chunks[64];
+    char per_chunk[16];
+
+    sprintf(per_chunk, "%d", PACK_CHUNK);
+    snprintf(bin, sizeof(bin), "%s/long.bin", work_dir);
+    snprintf(unpacked, sizeof(unpacked), "%s/long.unpacked", work_dir);
+    bool ok = realpath(TRACES_DIR "long.trace", trace) != NULL &&
+              run_csim(&text, PACK_GEOMETRY, "-t", trace, NULL);
+    check(ok, &text, "binary: csim runs on long.trace");
+    if (!ok)
+        return;
+
+    ok = run_pack(&run, "-c", per_chunk, trace, bin, NULL) &&
+         run_pack(&run, "-d", bin, unpacked, NULL);
+    check(ok, &run, "binary: trace-pack packs and unpacks long.trace");
+    if (!ok)
+        return;
+    ok = run_csim(&run, PACK_GEOMETRY, "-t", unpacked, NULL);
+    check(ok && same_stats(&text, &run), &run,
+          "binary: the unpacked trace matches long.trace");
+    for (size_t i = 0; i < NPACK_THREADS; i++) {
+        ok = run_csim(&run, PACK_GEOMETRY, "-j", PACK_THREADS[i], "-t", bin,
+                      NULL);
+        check(ok && same_stats(&text, &run), &run,
+              "binary: the packed trace matches long.trace with -j %s",
+              PACK_THREADS[i]);
+    }
+
+    for (size_t i = 0; i < NPACK_RANGES; i++) {
+        unsigned long first = PACK_RANGES[i].first;
+        unsigned long count = PACK_RANGES[i].count;
+        if (count > 0)
+            sprintf(chunks, "%lu:%lu", first, count);
+        else
+            sprintf(chunks, "%lu", first);
+        if (!write_chunk_slice(unpacked, first, count, slice) ||
+            !run_csim(&text, PACK_GEOMETRY, "-t", slice, NULL)) {
+            check(false, &text, "binary: cannot simulate chunks %s as text",
+                  chunks);
+            continue;
+        }
+        ok = run_csim(&run, PACK_GEOMETRY, "-j", "3", "--chunks", chunks, "-t",
+                      bin, NULL);
+        check(ok && same_stats(&text, &run), &run,
+              "binary: --chunks %s matches the same lines of text", chunks);
+    }
+
+    /* Break the footer and the index, then garble a chunk */
+    size_t size = 0;
+    unsigned char *data = read_file(bin, &size);
+    if (data == NULL || size < 64) {
+        check(false, NULL, "binary: cannot read %s", bin);
+        free(data);
+        return;
+    }
+    size_t footer = size - 24;
+    size_t index = 0;
+    for (int k = 7; k >= 0; k--)
+        index = index << 8 | data[footer + (size_t)k];
+    const struct {
+        const char *what;
+        size_t keep;
+        size_t offset;
+        unsigned char value;
+    } CORRUPT[] = {
+        {"a truncated footer", size - 1, size, 0},
+        {"a wrong footer magic", size, size - 1, 'X'},
+        {"a wrong chunk count", size, footer + 8,
+         (unsigned char)(data[footer + 8] + 1)},
+        {"a wrong index offset", size, footer,
+         (unsigned char)(data[footer] + 16)},
+        {"a chunk offset past the index", size, index + 1, 0xff},
+        {"a chunk length past the index", size, index + 11, 0xff},
+    };
+    for (size_t i = 0; i < sizeof(CORRUPT) / sizeof(CORRUPT[0]); i++) {
+        ok = write_corrupt(data, CORRUPT[i].keep, CORRUPT[i].offset,
+                           CORRUPT[i].value, slice);
+        ok = ok && !run_csim(&run, PACK_GEOMETRY, "-t", slice, NULL);
+        check(ok && run.status > 0 && !run.has_summary, &run,
+              "binary: a trace with %s is rejected",
+              CORRUPT[i].what);
+    }
+    ok = true;
+    for (size_t i = 32; i < 96 && ok; i++) {
+        ok = write_corrupt(data, size, i, (unsigned char)(data[i] ^ 0xa5),
+                           slice);
+        run_csim(&run, PACK_GEOMETRY, "-j", "2", "-t", slice, NULL);
+        ok = ok && run.status >= 0;
+    }
+    check(ok, &run, "binary: garbled chunk bytes do not crash csim");
+    free(data);
+}
+
+/**
+ * @brief Writes a line to a trace and counts its bytes.
+ */
+static void put_line(FILE *fp, size_t *pos, const char *line) {
+    fputs(line, fp);
+    *pos += strlen(line);
+}
+
+/**
+ * @brief Writes a comment line that ends just before a position.
+ *
+ * @param[in] target  Position the next line should start at, at least 2
+ *                    bytes further
+ */
+static void put_filler(FILE *fp, size_t *pos, size_t target) {
+    char line[256];
+    size_t len = target - *pos;
+    line[0] = '#';
+    memset(line + 1, 'x', len - 2);
+    line[len - 1] = '\n';
+    line[len] = '\0';
+    put_line(fp, pos, line);
+}
+
+/**
+ * @brief Writes the traces of the threaded parsing checks.
+ *
+ * Both hold the same random loads and stores. The tricky one spans
+ * TEXT_RANGES parsing ranges and has blank lines, whitespace and comments
+ * between its accesses; at each range boundary it has, in turn, an access
+ * starting on the boundary, an access across it, the newline of an access
+ * on it, a blank line on it and a comment across it. Its last access has
+ * no newline. The clean one has only the accesses.
+ *
+ * @param[out] tricky    Absolute path of the tricky trace
+ * @param[out] clean     Absolute path of the clean trace
+ * @param[out] accesses  Number of accesses in each
+ *
+ * @return false if any problems, true if OK.
+ */
+static bool write_text_traces(char *tricky, char *clean,
+                              unsigned long *accesses) {
+    FILE *fp = create_trace("tricky.trace", tricky);
+    FILE *out = fp != NULL ? create_trace("clean.trace", clean) : NULL;
+    if (out == NULL) {
+        if (fp != NULL)
+            fclose(fp);
+        return false;
+    }
+
+    unsigned int seed = 15513;
+    size_t pos = 0;
+    size_t clean_pos = 0;
+    char line[64];
+    *accesses = 0;
+    for (size_t k = 1; k <= TEXT_RANGES; k++) {
+        size_t boundary = k * TEXT_RANGE;
+        if (k == TEXT_RANGES)
+            boundary -= TEXT_RANGE / 2;
+        while (pos + 128 < boundary) {
+            int r = rand_r(&seed) % 64;
+            if (r == 0) {
+                put_line(fp, &pos, "\n");
+            } else if (r == 1) {
+                put_line(fp, &pos, " \t\r\n");
+            } else if (r == 2) {
+                put_line(fp, &pos, "# a comment, L 10,4\n");
+            } else {
+                sprintf(line, "%c %x,%d\n", r % 4 == 0 ? 'S' : 'L',
+                        (unsigned)rand_r(&seed) % (1U << 22),
+                        1 + rand_r(&seed) % 8);
+                put_line(fp, &pos, line);
+                put_line(out, &clean_pos, line);
+                (*accesses)++;
+            }
+        }
+        if (k == TEXT_RANGES)
+            break;
+
+        /* Place an access on the boundary, in the way of this range */
+        strcpy(line, "S 3fff00,8\n");
+        size_t len = strlen(line);
+        switch (k % 5) {
+        case 1: /* an access starts on it */
+            put_filler(fp, &pos, boundary);
+            break;
+        case 2: /* an access runs across it */
+            put_filler(fp, &pos, boundary - 5);
+            break;
+        case 3: /* the newline of an access is on it */
+            put_filler(fp, &pos, boundary - len + 1);
+            break;
+        case 4: /* a blank line is on it */
+            put_filler(fp, &pos, boundary);
+            put_line(fp, &pos, "\n");
+            break;
+        default: /* a comment runs across it */
+            put_filler(fp, &pos, boundary - 4);
+            put_line(fp, &pos, "# a comment across the boundary\n");
+            break;
+        }
+        put_line(fp, &pos, line);
+        put_line(out, &clean_pos, line);
+        (*accesses)++;
+    }
+
+    /* The last access of the tricky trace has no newline */
+    fputs("L 3fff00,8", fp);
+    put_line(out, &clean_pos, "L 3fff00,8\n");
+    (*accesses)++;
+    bool ok = close_trace(fp, tricky);
+    return close_trace(out, clean) && ok;
+}
+
+/**
+ * @brief Checks that a text trace parsed by several threads, by byte
+ * range, gives the same results as the same accesses parsed by one.
+ *
+ * The reference is the clean trace of write_text_traces() on one thread,
+ * whose ranges end in other places, and which must have one hit or miss
+ * per access.
+ */
+static void test_threaded_text(void) {
+    static run_t clean, run;
+    char tricky_path[PATH_MAX], clean_path[PATH_MAX];
+    unsigned long accesses;
+
+    if (!write_text_traces(tricky_path, clean_path, &accesses)) {
+        check(false, NULL, "text: cannot write the traces");
+        return;
+    }
+    bool ok = run_csim(&clean, "-s", "6", "-E", "4", "-b", "4", "-j", "1",
+                       "-t", clean_path, NULL);
+    check(ok && clean.stats.hits + clean.stats.misses == accesses, &clean,
+          "text: one hit or miss for each of the %lu accesses", accesses);
+    for (size_t i = 0; i < NTEXT_THREADS; i++) {
+        ok = run_csim(&run, "-s", "6", "-E", "4", "-b", "4", "-j",
+                      TEXT_THREADS[i], "-t", tricky_path, NULL);
+        check(ok && same_stats(&clean, &run), &run,
+              "text: %d ranges with lines on their boundaries, parsed by "
+              "%s threads, match",
+              TEXT_RANGES, TEXT_THREADS[i]);
+    }
+}
+
+/** @brief Trace filtered by the --filter checks */
+static const char FILTER_TRACE[] = "L 1000,8\n"
+                                   "L 1010,8\n"
+                                   "L 2000,8\n"
+                                   "S 2008,8\n"
+                                   "L 3000,8\n"
+                                   "L 1000,8\n"
+                                   "S 2000,8\n"
+                                   "L 3010,8\n";
+
+/** @brief Filter rules, and the trace they should leave of FILTER_TRACE */
+static const struct {
+    const char *what;
+    const char *rules;
+    const char *expected;
+} FILTER_CASES[] = {
+    {"include keeps only its range",
+     "include 0x1000 0x3000\n",
+     "L 1000,8\nL 1010,8\nL 2000,8\nS 2008,8\nL 1000,8\nS 2000,8\n"},
+    {"exclude drops its range from the included ones",
+     "# keep the first two ranges\n"
+     "include 0x1000 0x3000\n"
+     "exclude 8192 8200\n",
+     "L 1000,8\nL 1010,8\nS 2008,8\nL 1000,8\n"},
+    {"remap moves its range",
+     "remap 0x2000 0x3000 0x1000\n",
+     "L 1000,8\nL 1010,8\nL 1000,8\nS 1008,8\nL 3000,8\nL 1000,8\n"
+     "S 1000,8\nL 3010,8\n"},
+    {"the first remap of the original address applies",
+     "include 0x1000 0x4000\n"
+     "exclude 0x3000 0x3001\n"
+     "remap 0x1000 0x2000 0x3000\n"
+     "remap 0x1000 0x3000 0x2000\n",
+     "L 3000,8\nL 3010,8\nL 3000,8\nS 3008,8\nL 3000,8\nS 3000,8\n"
+     "L 3010,8\n"},
+};
+
+#define NFILTER_CASES (sizeof(FILTER_CASES) / sizeof(FILTER_CASES[0]))
+
+/**
+ * @brief Checks the include, exclude and remap rules of --filter against
+ * traces filtered by hand.
+ */
+static void test_filter(void) {
+    static run_t filtered, expected;
+    char trace[PATH_MAX], rules[PATH_MAX], by_hand[PATH_MAX];
+
+    if (!write_trace("filter.trace", FILTER_TRACE, trace)) {
+        check(false, NULL, "filter: cannot write the trace");
+        return;
+    }
+    for (size_t i = 0; i < NFILTER_CASES; i++) {
+        bool ok =
+            write_trace("filter.rules", FILTER_CASES[i].rules, rules) &&
+            write_trace("filtered.trace", FILTER_CASES[i].expected,
+                        by_hand) &&
+            run_csim(&expected, "-s", "1", "-E", "1", "-b", "4", "-t",
+                     by_hand, NULL) &&
+            run_csim(&filtered, "-s", "1", "-E", "1", "-b", "4", "--filter",
+                     rules, "-t", trace, NULL);
+        check(ok && same_stats(&expected, &filtered), &filtered,
+              "filter: %s", FILTER_CASES[i].what);
+    }
+
+    bool ok = write_trace("filter.rules", "include 0x1000\n", rules);
+    ok = ok && !run_csim(&filtered, "-s", "1", "-E", "1", "-b", "4",
+                         "--filter", rules, "-t", trace, NULL);
+    char line[PATH_MAX + 64];
+    snprintf(line, sizeof(line), "%s:1: invalid filter rule", rules);
+    check(ok && filtered.status > 0 && has_line(&filtered, line), &filtered,
+          "filter: a malformed rule is reported by line");
+}
+
+/** @brief Mixing policies, and what csim should print for each */
+static const struct {
+    const char *mix;
+    const char *lines[3];
+} MIX_CASES[] = {
+    {"rr",
+     {"trace 0 hits:1 misses:3 evictions:2 dirty_bytes_evicted:0 evicted "
+      "0:1 1:1",
+      "trace 1 hits:0 misses:3 evictions:2 dirty_bytes_evicted:16 evicted "
+      "0:1 1:1",
+      "hits:1 misses:6 evictions:4 dirty_bytes_in_cache:16 "
+      "dirty_bytes_evicted:16"}},
+    {"rr:2",
+     {"trace 0 hits:1 misses:3 evictions:1 dirty_bytes_evicted:16 evicted "
+      "0:0 1:1",
+      "trace 1 hits:0 misses:3 evictions:3 dirty_bytes_evicted:0 evicted "
+      "0:2 1:1",
+      "hits:1 misses:6 evictions:4 dirty_bytes_in_cache:16 "
+      "dirty_bytes_evicted:16"}},
+    {"ratio:3:1",
+     {"trace 0 hits:1 misses:3 evictions:1 dirty_bytes_evicted:0 evicted "
+      "0:1 1:0",
+      "trace 1 hits:0 misses:3 evictions:3 dirty_bytes_evicted:32 evicted "
+      "0:2 1:1",
+      "hits:1 misses:6 evictions:4 dirty_bytes_in_cache:0 "
+      "dirty_bytes_evicted:32"}},
+    {"time",
+     {"trace 0 hits:0 misses:4 evictions:3 dirty_bytes_evicted:0 evicted "
+      "0:2 1:1",
+      "trace 1 hits:1 misses:2 evictions:1 dirty_bytes_evicted:16 evicted "
+      "0:0 1:1",
+      "hits:1 misses:6 evictions:4 dirty_bytes_in_cache:16 "
+      "dirty_bytes_evicted:16"}},
+};
+
+#define NMIX_CASES (sizeof(MIX_CASES) / sizeof(MIX_CASES[0]))
+
+/**
+ * @brief Checks the interleaving and the per-trace statistics of --mix.
+ *
+ * Trace 0 loads blocks 0, 1 and 0 and stores block 2; trace 1 stores block
+ * 0x10 and loads blocks 0 and 0x11. They share a set of two 16-byte lines,
+ * so every policy hits, misses and evicts differently. For time, trace 0
+ * also fetches instructions: one before its first access and two before
+ * its second. Trace 1, which has no fetches, then gets its first access
+ * in before any of trace 0, and all of them before the second.
+ */
+static void test_mix(void) {
+    static run_t run;
+    char trace0[PATH_MAX], trace1[PATH_MAX], timed0[PATH_MAX];
+
+    if (!write_trace("mix0.trace", "L 0,8\nL 10,8\nL 0,8\nS 20,8\n",
+                     trace0) ||
+        !write_trace("mix1.trace", "S 100,8\nL 0,8\nL 110,8\n", trace1) ||
+        !write_trace("mix0-time.trace",
+                     "I 400000,4\nL 0,8\nI 400004,4\nI 400008,4\n"
+                     "L 10,8\nL 0,8\nS 20,8\n",
+                     timed0)) {
+        check(false, NULL, "mix: cannot write the traces");
+        return;
+    }
+    for (size_t i = 0; i < NMIX_CASES; i++) {
+        const char *first =
+            strcmp(MIX_CASES[i].mix, "time") == 0 ? timed0 : trace0;
+        bool ok = run_csim(&run, "-s", "0", "-E", "2", "-b", "4", "--mix",
+                           MIX_CASES[i].mix, "-t", first, "-t", trace1,
+                           NULL);
+        for (int k = 0; k < 3; k++)
+            ok = ok && has_line(&run, MIX_CASES[i].lines[k]);
+        check(ok, &run, "mix: --mix %s interleaves and accounts by trace",
+              MIX_CASES[i].mix);
+    }
+}
+
+/** @brief Trace of the --translate checks: pages 5, 1, 5, 9 and 3 */
+static const char TRANSLATE_TRACE[] = "L 5000,8\n"
+                                      "L 1008,8\n"
+                                      "L 5010,8\n"
+                                      "L 9000,8\n"
+                                      "L 3000,8\n";
+
+#define NTRANSLATE 5
+
+/**
+ * @brief Collects the addresses a verbose run of csim simulated.
+ *
+ * @return The number of addresses found, at most max
+ */
+static size_t verbose_addrs(const run_t *run, unsigned long *addrs,
+                            size_t max) {
+    size_t n = 0;
+    for (const char *p = run->output; *p != '\0' && n < max; p++) {
+        char op;
+        if ((p == run->output || p[-1] == '\n') &&
+            sscanf(p, "%c %lx,", &op, &addrs[n]) == 2 &&
+            strchr("LS", op) != NULL)
+            n++;
+    }
+    return n;
+}
+
+/**
+ * @brief Checks the frames given by the seq, random and color allocators
+ * of --translate, as seen in the verbose output of csim.
+ */
+static void test_translate(void) {
+    static const unsigned long SEQ[NTRANSLATE] = {0x0, 0x1008, 0x10, 0x2000,
+                                                  0x3000};
+    static const unsigned long SEQ8[NTRANSLATE] = {0x0, 0x108, 0x10, 0x200,
+                                                   0x300};
+    static const unsigned long COLOR[NTRANSLATE] = {0x1000, 0x5008, 0x1010,
+                                                    0x9000, 0x3000};
+    static run_t run;
+    char trace[PATH_MAX], trace1[PATH_MAX];
+    unsigned long addrs[NTRANSLATE + 1];
+
+    if (!write_trace("translate.trace", TRANSLATE_TRACE, trace) ||
+        !write_trace("translate1.trace", "L 5000,8\n", trace1)) {
+        check(false, NULL, "translate: cannot write the traces");
+        return;
+    }
+
+    /* seq hands out frames 0, 1, 2... in the order pages are touched */
+    bool ok = run_csim(&run, "-v", "-s", "2", "-E", "1", "-b", "12",
+                       "--translate", "seq", "-t", trace, NULL);
+    ok = ok && verbose_addrs(&run, addrs, NTRANSLATE + 1) == NTRANSLATE;
+    ok = ok && memcmp(addrs, SEQ, sizeof(SEQ)) == 0;
+    check(ok, &run, "translate: seq gives frames in order of first touch");
+    ok = run_csim(&run, "-v", "-s", "1", "-E", "1", "-b", "4",
+                  "--translate", "seq:8", "-t", trace, NULL);
+    ok = ok && verbose_addrs(&run, addrs, NTRANSLATE + 1) == NTRANSLATE;
+    ok = ok && memcmp(addrs, SEQ8, sizeof(SEQ8)) == 0;
+    check(ok, &run, "translate: seq:8 uses pages of 256 bytes");
+
+    /* 4 KiB pages in a cache of 16 KiB have 4 colors */
+    ok = run_csim(&run, "-v", "-s", "2", "-E", "1", "-b", "12",
+                  "--translate", "color", "-t", trace, NULL);
+    ok = ok && verbose_addrs(&run, addrs, NTRANSLATE + 1) == NTRANSLATE;
+    ok = ok && memcmp(addrs, COLOR, sizeof(COLOR)) == 0;
+    check(ok, &run, "translate: color keeps the color of every page");
+
+    /* random keeps offsets, maps a page to one frame and pages apart */
+    ok = run_csim(&run, "-v", "-s", "2", "-E", "1", "-b", "12",
+                  "--translate", "random", "-t", trace, NULL);
+    ok = ok && verbose_addrs(&run, addrs, NTRANSLATE + 1) == NTRANSLATE;
+    ok = ok && (addrs[1] & 0xfff) == 8 && (addrs[2] & 0xfff) == 0x10 &&
+         addrs[2] - addrs[0] == 0x10;
+    for (int i = 0; i < NTRANSLATE && ok; i++) {
+        ok = addrs[i] < 1UL << TRANSLATE_MEMORY_BITS;
+        for (int j = 0; j < i && ok; j++)
+            ok = (i == 2 && j == 0) || addrs[i] >> 12 != addrs[j] >> 12;
+    }
+    ok = ok && memcmp(addrs, SEQ, sizeof(SEQ)) != 0;
+    check(ok, &run, "translate: random gives every page its own frame");
+
+    /* The traces of a mix have address spaces of their own */
+    ok = run_csim(&run, "-v", "-s", "2", "-E", "1", "-b", "12",
+                  "--translate", "seq", "--mix", "rr", "-t", trace, "-t",
+                  trace1, NULL);
+    check(ok && has_line(&run, "0: L 0,8 A Cold Miss") &&
+              has_line(&run, "1: L 1000,8 A Cold Miss") &&
+              has_line(&run, "0: L 2008,8 A Cold Miss"),
+          &run, "translate: mixed traces get frames of their own");
+}
+
+/**
+ * @brief Finds the first line of a run's output starting with a prefix.
+ *
+ * @return The line, or NULL if there is none
+ */
+static const char *find_line(const run_t *run, const char *prefix) {
+    size_t len = strlen(prefix);
+    for (const char *p = run->output; p != NULL && *p != '\0';) {
+        if (strncmp(p, prefix, len) == 0)
+            return p;
+        p = strchr(p, '\n');
+        p = p != NULL ? p + 1 : NULL;
+    }
+    return NULL;
+}
+
+/**
+ * @brief Checks the row buffer hits, misses and conflicts of --dram.
+ *
+ * With one channel and rank, two banks and 256-byte rows mapped as
+ * "rkbhc", 16-byte blocks hold column bits 4 to 7, the bank is bit 8 and
+ * the row starts at bit 9. A cache of one line sends every block of the
+ * trace to DRAM: bank 0 row 0 (miss), the same row (hit), bank 1 row 0
+ * (miss), bank 0 row 1 (conflict), bank 0 row 0 (conflict), then bank 1
+ * row 0 twice (hits), the last time for a store, and finally the write
+ * back of that block and a read of bank 0 row 0 (both hits).
+ */
+static void test_dram(void) {
+    static run_t run;
+    char trace[PATH_MAX], long_trace[PATH_MAX];
+    unsigned long reads, writes, hits, misses, conflicts, cycles;
+
+    bool ok = write_trace("dram.trace",
+                          "L 0,4\nL 10,4\nL 100,4\nL 200,4\nL 20,4\n"
+                          "L 120,4\nS 130,4\nL 0,4\n",
+                          trace);
+    ok = ok && run_csim(&run, "-s", "0", "-E", "1", "-b", "4", "--dram",
+                        "1:1:2:256:rkbhc", "-t", trace, NULL);
+    const char *line = ok ? find_line(&run, "dram ") : NULL;
+    ok = line != NULL &&
+         sscanf(line,
+                "dram reads:%lu writes:%lu row_hits:%lu row_misses:%lu "
+                "row_conflicts:%lu cycles:%lu",
+                &reads, &writes, &hits, &misses, &conflicts, &cycles) == 6;
+    check(ok && reads == 8 && writes == 1 && hits == 5 && misses == 2 &&
+              conflicts == 2 && cycles > 0,
+          &run, "dram: row hits, misses and conflicts of 2 banks");
+
+    /* Every miss reads a block and every dirty eviction writes one */
+    ok = realpath(TRACES_DIR "long.trace", long_trace) != NULL &&
+         run_csim(&run, "-s", "5", "-E", "1", "-b", "5", "--dram",
+                  "default", "-t", long_trace, NULL);
+    line = ok ? find_line(&run, "dram ") : NULL;
+    ok = line != NULL &&
+         sscanf(line,
+                "dram reads:%lu writes:%lu row_hits:%lu row_misses:%lu "
+                "row_conflicts:%lu cycles:%lu",
+                &reads, &writes, &hits, &misses, &conflicts, &cycles) == 6;
+    check(ok && reads == run.stats.misses &&
+              writes == run.stats.dirty_evictions / 32 &&
+              hits + misses + conflicts == reads + writes,
+          &run, "dram: the traffic of long.trace is the cache's misses and "
+                "write backs");
+}
+
+/**
+ * @brief Adds up the lines counted by a histogram printed by --lifetimes.
+ */
+static unsigned long histogram_total(const run_t *run, const char *name) {
+    char prefix[64];
+    unsigned long total = 0;
+    unsigned long bound, count;
+    int used;
+
+    snprintf(prefix, sizeof(prefix), "lifetime %s", name);
+    const char *p = find_line(run, prefix);
+    if (p == NULL)
+        return 0;
+    p += strlen(prefix);
+    while (sscanf(p, " %lu:%lu%n", &bound, &count, &used) == 2) {
+        total += count;
+        p += used;
+    }
+    return total;
+}
+
+/**
+ * @brief Checks the lifetime histograms of --lifetimes.
+ *
+ * In a set of two lines, block 0 is filled at access 1 and evicted at 6,
+ * unused since; block 1 is filled at 2, hit 3 times up to access 5 and
+ * evicted at 7; block 3 is filled at 7 and evicted at 9 without a hit.
+ * Resident times are 5, 5 and 2 accesses, idle times 5, 2 and 2, of which
+ * 9 of 12 dead, and hits 0, 3 and 0. A bucket n holds [n, 2n).
+ */
+static void test_lifetimes(void) {
+    static run_t run;
+    char trace[PATH_MAX], long_trace[PATH_MAX];
+
+    bool ok = write_trace("lifetimes.trace",
+                          "L 0,1\nL 10,1\nL 10,1\nL 10,1\nL 10,1\n"
+                          "L 20,1\nL 30,1\nL 20,1\nL 0,1\n",
+                          trace);
+    ok = ok && run_csim(&run, "-s", "0", "-E", "2", "-b", "4",
+                        "--lifetimes", "-t", trace, NULL);
+    check(ok &&
+              has_line(&run, "lifetimes evictions:3 "
+                             "dead_on_arrival:66.67% dead_time:75.00%") &&
+              has_line(&run, "lifetime resident 2:1 4:2") &&
+              has_line(&run, "lifetime idle 2:2 4:1") &&
+              has_line(&run, "lifetime hits 0:2 2:1"),
+          &run, "lifetimes: histograms of three evicted lines");
+
+    /* Each histogram counts every evicted line once */
+    ok = realpath(TRACES_DIR "long.trace", long_trace) != NULL &&
+         run_csim(&run, "-s", "4", "-E", "2", "-b", "4", "--lifetimes",
+                  "-t", long_trace, NULL);
+    unsigned long evictions = run.stats.evictions;
+    check(ok && evictions > 0 &&
+              histogram_total(&run, "resident") == evictions &&
+              histogram_total(&run, "idle") == evictions &&
+              histogram_total(&run, "hits") == evictions,
+          &run, "lifetimes: the histograms of long.trace count each of its "
+                "%lu evictions",
+          evictions);
+}
+
+/**
+ * @brief Checks whether a run printed the line "<trace>:<n>: <what>".
+ */
+static bool has_error_line(const run_t *run, const char *trace,
+                           unsigned long n, const char *what) {
+    char line[PATH_MAX + 64];
+    snprintf(line, sizeof(line), "%s:%lu: %s", trace, n, what);
+    return has_line(run, line);
+}
+
+/**
+ * @brief Checks that malformed trace lines are reported by line number,
+ * and either stop the simulation or are skipped with --on-error skip.
+ */
+static void test_on_error(void) {
+    static run_t run;
+    char trace[PATH_MAX];
+
+    /* Lines 4 and 6 are malformed; blank lines and comments are not */
+    bool ok = write_trace("errors.trace",
+                          "L 0,8\n"
+                          "\n"
+                          "# a comment\n"
+                          "X 10,8\n"
+                          "L 10,8\n"
+                          "L 20\n"
+                          "S 0,8\n",
+                          trace);
+    ok = ok && !run_csim(&run, "-s", "0", "-E", "1", "-b", "4", "-t", trace,
+                         NULL);
+    check(ok && run.status > 0 && !run.has_summary &&
+              has_error_line(&run, trace, 4, "malformed line") &&
+              !has_error_line(&run, trace, 6, "malformed line"),
+          &run, "errors: csim stops at the first malformed line, line 4");
+    ok = run_csim(&run, "-s", "0", "-E", "1", "-b", "4", "--on-error",
+                  "skip", "-t", trace, NULL);
+    check(ok && has_error_line(&run, trace, 4, "malformed line, skipped") &&
+              has_error_line(&run, trace, 6, "malformed line, skipped") &&
+              has_line(&run, "Skipped 2 malformed lines") &&
+              has_line(&run, "hits:0 misses:3 evictions:2 "
+                             "dirty_bytes_in_cache:16 "
+                             "dirty_bytes_evicted:0"),
+          &run, "errors: --on-error skip reports lines 4 and 6 and skips "
+                "them");
+
+    /* Only the first TRACE_REPORTED_ERRORS of 12 are reported */
+    FILE *fp = create_trace("many-errors.trace", trace);
+    if (fp == NULL) {
+        check(false, NULL, "errors: cannot write the trace");
+        return;
+    }
+    for (int i = 0; i < 12; i++)
+        fprintf(fp, "L %x,8\nbad\n", i * 16);
+    ok = close_trace(fp, trace) &&
+         run_csim(&run, "-s", "0", "-E", "1", "-b", "4", "--on-error",
+                  "skip", "-t", trace, NULL);
+    check(ok && has_error_line(&run, trace, 20, "malformed line, skipped") &&
+              !has_error_line(&run, trace, 22, "malformed line, skipped") &&
+              has_line(&run, "Skipped 12 malformed lines") &&
+              run.stats.misses == 12,
+          &run, "errors: 10 of 12 malformed lines are reported");
+
+    /* Line numbers go on across the parsing ranges of several threads */
+    fp = create_trace("late-error.trace", trace);
+    if (fp == NULL) {
+        check(false, NULL, "errors: cannot write the trace");
+        return;
+    }
+    for (int i = 0; i < 300000; i++)
+        fprintf(fp, "%c %x,4\n", i % 3 == 0 ? 'S' : 'L', (i % 4096) * 4);
+    fprintf(fp, "L 0x,4\nL 0,4\n");
+    ok = close_trace(fp, trace) &&
+         run_csim(&run, "-s", "4", "-E", "2", "-b", "4", "-j", "4",
+                  "--on-error", "skip", "-t", trace, NULL);
+    check(ok &&
+              has_error_line(&run, trace, 300001, "malformed line, skipped") &&
+              has_line(&run, "Skipped 1 malformed lines") &&
+              run.stats.hits + run.stats.misses == 300001,
+          &run, "errors: line 300001 is reported with -j 4");
+    ok = !run_csim(&run, "-s", "4", "-E", "2", "-b", "4", "-j", "4", "-t",
+                   trace, NULL);
+    check(ok && run.status > 0 &&
+              has_error_line(&run, trace, 300001, "malformed line"),
+          &run, "errors: line 300001 stops csim with -j 4");
+}
+
+/**
+ * @brief Writes one DynamoRIO trace_entry_t record.
+ */
+static void put_drmemtrace(FILE *fp, unsigned int type, unsigned int size,
+                           unsigned long addr) {
+    unsigned char e[12];
+    e[0] = (unsigned char)type;
+    e[1] = (unsigned char)(type >> 8);
+    e[2] = (unsigned char)size;
+    e[3] = (unsigned char)(size >> 8);
+    for (int i = 0; i < 8; i++)
+        e[4 + i] = (unsigned char)(addr >> (8 * i));
+    fwrite(e, 1, sizeof(e), fp);
+}
+
+/**
+ * @brief Checks that Valgrind Lackey output and DynamoRIO traces are read
+ * as the same accesses as a text trace.
+ *
+ * Both traces load and store block 0x100, modify block 0x200 and then load
+ * block 0x101, around two instruction fetches of one block. In a set of
+ * two 16-byte lines that is 2 hits and 3 misses, evicting block 0x100 and
+ * its 16 dirty bytes; the fetches go only to the --icache, 1 hit and 1
+ * miss.
+ */
+static void test_trace_formats(void) {
+    static const char *const SUMMARY =
+        "hits:2 misses:3 evictions:1 dirty_bytes_in_cache:16 "
+        "dirty_bytes_evicted:16";
+    static run_t run;
+    char trace[PATH_MAX];
+
+    bool ok = write_trace("formats.lackey",
+                          "==15213== Lackey, an example Valgrind tool\n"
+                          "I  04000000,3\n"
+                          " L 00001000,8\n"
+                          " S 00001008,8\n"
+                          "I  04000003,4\n"
+                          " M 00002000,4\n"
+                          " L 00001010,8\n"
+                          "==15213== \n",
+                          trace);
+    ok = ok && run_csim(&run, "-s", "0", "-E", "2", "-b", "4", "-t", trace,
+                        NULL);
+    check(ok && has_line(&run, SUMMARY), &run,
+          "formats: Lackey output is detected and read");
+    ok = run_csim(&run, "-s", "0", "-E", "2", "-b", "4", "--format",
+                  "lackey", "--icache", "0:1:4", "-t", trace, NULL);
+    check(ok && has_line(&run, SUMMARY) &&
+              has_line(&run, "icache hits:1 misses:1 evictions:0"),
+          &run, "formats: Lackey fetches go to the --icache");
+
+    /* The same accesses as DynamoRIO records, with a header and a marker */
+    FILE *fp = create_trace("formats.drmemtrace", trace);
+    if (fp == NULL) {
+        check(false, NULL, "formats: cannot write the DynamoRIO trace");
+        return;
+    }
+    put_drmemtrace(fp, 25, 0, 1);
+    put_drmemtrace(fp, 10, 3, 0x4000000);
+    put_drmemtrace(fp, 0, 8, 0x1000);
+    put_drmemtrace(fp, 1, 8, 0x1008);
+    put_drmemtrace(fp, 28, 0, 0);
+    put_drmemtrace(fp, 10, 4, 0x4000003);
+    put_drmemtrace(fp, 0, 4, 0x2000);
+    put_drmemtrace(fp, 1, 4, 0x2000);
+    put_drmemtrace(fp, 0, 8, 0x1010);
+    ok = close_trace(fp, trace) &&
+         run_csim(&run, "-s", "0", "-E", "2", "-b", "4", "-t", trace, NULL);
+    check(ok && has_line(&run, SUMMARY), &run,
+          "formats: DynamoRIO records are detected and read");
+    ok = run_csim(&run, "-s", "0", "-E", "2", "-b", "4", "--format",
+                  "drmemtrace", "--icache", "0:1:4", "-t", trace, NULL);
+    check(ok && has_line(&run, SUMMARY) &&
+              has_line(&run, "icache hits:1 misses:1 evictions:0"),
+          &run, "formats: DynamoRIO fetches go to the --icache");
+}
+
+/**
+ * @brief Checks the statistics of a marked region, and that a region ID
+ * past MAXREGIONS in csim.c is rejected.
+ */
+static void test_regions(void) {
+    static run_t run;
+    char trace[PATH_MAX];
+
+    /* Region 1 misses and then hits block 0; the miss after it is not its */
+    if (!write_trace("regions.trace",
+                     "L 3ffff00000001,0\n"
+                     "L 0,8\n"
+                     "S 0,8\n"
+                     "S 3ffff00000001,0\n"
+                     "L 40,8\n",
+                     trace)) {
+        check(false, NULL, "regions: cannot write the trace");
+        return;
+    }
+    bool ok = run_csim(&run, "-s", "0", "-E", "1", "-b", "4", "--regions",
+                       "-t", trace, NULL);
+    check(ok && has_line(&run, "region 1: hits:1 misses:1 evictions:0 "
+                               "dirty_bytes_in_cache:16 "
+                               "dirty_bytes_evicted:0 calls:1"),
+          &run, "regions: statistics of a marked region");
+
+    if (!write_trace("region-id.trace",
+                     "L 3ffff00001000,0\n"
+                     "L 0,8\n"
+                     "S 3ffff00001000,0\n",
+                     trace)) {
+        check(false, NULL, "regions: cannot write the trace");
+        return;
+    }
+    ok = run_csim(&run, "-s", "0", "-E", "1", "-b", "4", "--regions", "-t",
+                  trace, NULL);
+    check(!ok && run.status > 0 && has_line(&run, "Region ID too large!"),
+          &run, "regions: region ID 4096 is rejected");
+}
+
+/**
+ * @brief Checks that caches of several MiB simulated with a budget of
+ * 1 MiB give the same results as in memory.
+ *
+ * The trace holds loads and stores of 8 bytes, half of them in a hot MiB
+ * and the rest spread over 8 MiB, so that the caches evict.
+ */
+static void test_out_of_core(void) {
+    static run_t mem, ooc;
+    char trace[PATH_MAX];
+    char s[16], E[16], b[16];
+
+    FILE *fp = create_trace(OOC_INFO[0].filename, trace);
+    if (fp == NULL) {
+        check(false, NULL, "out-of-core: cannot write the trace");
+        return;
+    }
+    unsigned int seed = 15213;
+    for (int i = 0; i < OOC_ACCESSES; i++) {
+        unsigned long span = rand_r(&seed) % 2 == 0 ? 1UL << 20 : 1UL << 23;
+        unsigned long addr = (unsigned long)rand_r(&seed) % span & ~7UL;
+        fprintf(fp, "%c %lx,8\n", rand_r(&seed) % 4 == 0 ? 'S' : 'L',
+                0x10000000UL + addr);
+    }
+    if (!close_trace(fp, trace)) {
+        check(false, NULL, "out-of-core: cannot write the trace");
+        return;
+    }
+
+    for (size_t i = 0; i < NOOC; i++) {
+        const trace_info_t *info = &OOC_INFO[i];
+        sprintf(s, "%d", info->s);
+        sprintf(E, "%d", info->E);
+        sprintf(b, "%d", info->b);
+        bool ok = run_csim(&mem, "-s", s, "-E", E, "-b", b, "-t", trace,
+                           NULL) &&
+                  run_csim(&ooc, "-s", s, "-E", E, "-b", b, "-t", trace,
+                           "--out-of-core", ".:1", NULL);
+        check(ok && same_stats(&mem, &ooc), &ooc,
+              "out-of-core: (%s,%s,%s) with 1 MiB matches csim in memory", s,
+              E, b);
+    }
+}
+
+/**
+ * @brief Main routine
+ */
+int main(int argc, char *argv[]) {
+    int c;
+
+    while ((c = getopt(argc, argv, "hv")) != -1) {
+        switch (c) {
+        case 'v':
+            verbose = true;
+            break;
+        case 'h':
+            usage(argv);
+            exit(0);
+        default:
+            usage(argv);
+            exit(1);
+        }
+    }
+
+    /* Runs happen in private directories, so they need absolute paths */
+    if (realpath("./csim", csim_path) == NULL ||
+        realpath("./trace-pack", pack_path) == NULL) {
+        fprintf(stderr, "Error: ./csim and ./trace-pack must exist: %s\n",
+                strerror(errno));
+        exit(1);
+    }
+    if (mkdtemp(work_dir) == NULL) {
+        fprintf(stderr, "Error creating %s: %s\n", work_dir,
+                strerror(errno));
+        exit(1);
+    }
+
+    if (signal(SIGALRM, sigalrm_handler) == SIG_ERR) {
+        fprintf(stderr, "Unable to install SIGALRM handler\n");
+        exit(1);
+    }
+    alarm(120);
+
+    test_named_stats();
+    test_out_of_core();
+    test_regions();
+    test_binary_trace();
+    test_threaded_text();
+    test_trace_formats();
+    test_on_error();
+    test_filter();
+    test_mix();
+    test_translate();
+    test_dram();
+    test_lifetimes();
+
+    remove_dir(work_dir);
+    printf("\n%d of %d checks passed\n", num_passed, num_checks);
+    printf("TEST_FEATURES=%d/%d\n", num_passed, num_checks);
+    exit(num_passed == num_checks ? 0 : 1);
+}
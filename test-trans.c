@@ -28,6 +28,7 @@
 /* Globals set on the command line */
 static size_t M = 0;
 static size_t N = 0;
+static const char *tracegen = "./tracegen-ct";
 
 /** @brief Results of testing the submitted transpose function */
 static struct {
@@ -54,28 +55,27 @@ static unsigned long get_clock_cycles(unsigned long hits,
  */
 static bool generate_trace(const char *file_name, int i) {
     char cmd[CMD_BUFSIZE];
-    snprintf(cmd, sizeof(cmd),
-             "CONTECH_TRACE=%s ./tracegen-ct -M %ld -N %ld -F %d", file_name, M,
-             N, i);
+    snprintf(cmd, sizeof(cmd), "CONTECH_TRACE=%s %s -M %ld -N %ld -F %d",
+             file_name, tracegen, M, N, i);
 
     int status = system(cmd);
     if (status < 0) {
-        printf("Failed to run tracegen-ct: %s\n", strerror(errno));
+        printf("Failed to run %s: %s\n", tracegen, strerror(errno));
         return false;
     }
 
     if (!WIFEXITED(status)) {
-        printf("Internal error: ./tracegen-ct aborted for unknown "
+        printf("Internal error: %s aborted for unknown "
                "reason (status %x).\n",
-               status);
+               tracegen, status);
         printf("Command run: %s\n", cmd);
         return false;
     }
 
     if (WEXITSTATUS(status) != 0) {
-        printf("Validation error at function %d! Run ./tracegen-ct -v -M "
+        printf("Validation error at function %d! Run %s -v -M "
                "%zd -N %zd -F %d for details.\n",
-               i, M, N, i);
+               i, tracegen, M, N, i);
         printf("Exit status %d\n", WEXITSTATUS(status));
         return false;
     }
@@ -185,11 +185,13 @@ static void eval_perf(unsigned int s, unsigned int E, unsigned int b,
  * @brief Print usage info
  */
 static void usage(char *argv[]) {
-    printf("Usage: %s [-h] [-s] -M <rows> -N <cols>\n", argv[0]);
+    printf("Usage: %s [-h] [-s] [-g <tracegen>] -M <rows> -N <cols>\n",
+           argv[0]);
     printf("Options:\n");
     printf("  -h          Print this help message.\n");
     printf("  -s          Check official submission only.\n");
     printf("  -l          Simulate large (Haswell L1) cache\n");
+    printf("  -g <prog>   Trace generator to run (default ./tracegen-ct)\n");
     printf("  -M <rows>   Number of destination matrix rows (max %d)\n", MAXN);
     printf("  -N <cols>   Number of destination matrix columns (max %d)\n",
            MAXN);
@@ -228,7 +230,7 @@ int main(int argc, char *argv[]) {
     bool submission_only = false;
     bool use_large_cache = false;
 
-    while ((c = getopt(argc, argv, "hcslM:N:")) != -1) {
+    while ((c = getopt(argc, argv, "hcslg:M:N:")) != -1) {
         switch (c) {
         case 'M':
             M = (size_t)atoi(optarg);
@@ -242,6 +244,9 @@ int main(int argc, char *argv[]) {
         case 'l':
             use_large_cache = true;
             break;
+        case 'g':
+            tracegen = optarg;
+            break;
         case 'h':
             usage(argv);
             exit(0);
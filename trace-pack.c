@@ -0,0 +1,155 @@
+/**
+ * @file trace-pack.c
+ * @brief Converts memory traces between the text and binary formats
+ *
+ * By default a trace (text or binary) is packed into a compressed binary
+ * trace. With -d the input is unpacked into a text trace instead, and with
+ * -i only a summary of its chunk index is printed.
+ */
+
+#define _GNU_SOURCE
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+
+#include "trace.h"
+
+static void usage(char *argv[]) {
+    printf("Usage: %s [-h] [-d] [-c accesses] [-j threads] <in> <out>\n",
+           argv[0]);
+    printf("       %s -i <in>\n", argv[0]);
+    printf("Options:\n");
+    printf("  -h           Print this help message.\n");
+    printf("  -d           Write a text trace instead of a binary one.\n");
+    printf("  -c accesses  Accesses per chunk (default %lu).\n",
+           TRACE_CHUNK_ACCESSES);
+    printf("  -j threads   Threads decoding a binary input.\n");
+    printf("  -i           Print the chunk index of a trace and exit.\n");
+}
+
+static off_t file_size(const char *path) {
+    struct stat st;
+    return stat(path, &st) == 0 ? st.st_size : 0;
+}
+
+/**
+ * @brief Prints the number of chunks and accesses of a trace.
+ */
+static int print_info(const char *path) {
+    trace_reader_t *reader = trace_open(path, NULL);
+    if (reader == NULL)
+        return 1;
+
+    unsigned long accesses = 0;
+    const trace_access_t *acc;
+    size_t count;
+    while ((acc = trace_next(reader, &count)) != NULL)
+        accesses += count;
+    size_t chunks = trace_num_chunks(reader);
+    if (!trace_close(reader)) {
+        fprintf(stderr, "Invalid trace %s\n", path);
+        return 1;
+    }
+
+    off_t bytes = file_size(path);
+    printf("%s: %s, %zu chunks, %lu accesses, %lld bytes (%.2f per access)\n",
+           path, chunks > 0 ? "binary" : "text", chunks, accesses,
+           (long long)bytes,
+           accesses > 0 ? (double)bytes / (double)accesses : 0.0);
+    return 0;
+}
+
+/**
+ * @brief Main routine
+ */
+int main(int argc, char *argv[]) {
+    bool decode = false;
+    bool info = false;
+    size_t chunk_accesses = 0;
+    trace_options_t options = {0};
+    int c;
+
+    while ((c = getopt(argc, argv, "hdic:j:")) != -1) {
+        switch (c) {
+        case 'd':
+            decode = true;
+            break;
+        case 'i':
+            info = true;
+            break;
+        case 'c':
+            chunk_accesses = strtoul(optarg, NULL, 0);
+            break;
+        case 'j':
+            options.threads = atoi(optarg);
+            break;
+        case 'h':
+            usage(argv);
+            exit(0);
+        default:
+            usage(argv);
+            exit(1);
+        }
+    }
+
+    if (info) {
+        if (optind + 1 != argc) {
+            usage(argv);
+            exit(1);
+        }
+        return print_info(argv[optind]);
+    }
+    if (optind + 2 != argc) {
+        usage(argv);
+        exit(1);
+    }
+    const char *in = argv[optind];
+    const char *out = argv[optind + 1];
+
+    trace_reader_t *reader = trace_open(in, &options);
+    if (reader == NULL)
+        return 1;
+
+    bool ok = true;
+    const trace_access_t *acc;
+    size_t count;
+    if (decode) {
+        FILE *fp = fopen(out, "w");
+        if (fp == NULL) {
+            perror(out);
+            trace_close(reader);
+            return 1;
+        }
+        char line[64];
+        while ((acc = trace_next(reader, &count)) != NULL) {
+            for (size_t i = 0; i < count; i++) {
+                trace_format_access(line, sizeof(line), &acc[i]);
+                fprintf(fp, "%s\n", line);
+            }
+        }
+        ok = fclose(fp) == 0;
+    } else {
+        trace_writer_t *writer = trace_writer_open(out, chunk_accesses);
+        if (writer == NULL) {
+            trace_close(reader);
+            return 1;
+        }
+        while ((acc = trace_next(reader, &count)) != NULL) {
+            for (size_t i = 0; i < count; i++)
+                trace_writer_put(writer, &acc[i]);
+        }
+        ok = trace_writer_close(writer);
+    }
+
+    if (!trace_close(reader)) {
+        fprintf(stderr, "Invalid trace %s\n", in);
+        return 1;
+    }
+    if (!ok) {
+        fprintf(stderr, "Failed to write %s\n", out);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,1076 @@
+/**
+ * @file trace.c
+ * @brief Reading and writing memory traces for the cache simulator
+ *
+ * Binary trace layout (all integers little-endian):
+ *
+ *   header   "CSIMTRC1", u32 version, u32 flags
+ *   chunks   the compressed chunks, back to back
+ *   index    per chunk: u64 file offset, u32 compressed bytes, u32 accesses
+ *   footer   u64 index offset, u64 number of chunks, "CSIMIDX1"
+ *
+ * Every chunk is compressed on its own with a delta codec, so any chunk can
+ * be decoded given only its index entry. Each record starts with a token
+ * byte holding the op in its low four bits and flags in the high ones:
+ *
+ *   TOK_SIZE        a varint access size follows (else same as previous)
+ *   TOK_SAME_DELTA  the address moved by the same amount as last time
+ *                   (else a zigzag varint address delta follows)
+ *   TOK_RUN         a varint count follows; the record stands for that many
+ *                   accesses with the same op, size and address delta
+ *
+ * Strided loops, which dominate lab traces, collapse into a few bytes per
+ * run, and random accesses cost one byte plus the varint delta.
+ *
+ * The trace file is mapped into memory and cut into jobs: the chunks of a
+ * binary trace, or fixed byte ranges of a text or DynamoRIO trace. A text
+ * range owns the
+ * lines that start inside it, so a worker resynchronizes by skipping to the
+ * first newline before its range (unless the range starts a line) and may
+ * read past its end to finish its last line. Jobs are decoded by a pool of
+ * worker threads into a ring of buffers; each worker claims the next job,
+ * and the consumer takes the buffers back in job order, so the accesses
+ * come out in trace order.
+ */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "trace.h"
+
+#define TRACE_MAGIC "CSIMTRC1"
+#define INDEX_MAGIC "CSIMIDX1"
+#define TRACE_VERSION 1
+#define HEADER_BYTES 16
+#define INDEX_ENTRY_BYTES 16
+#define FOOTER_BYTES 24
+
+#define TOK_OP_MASK 0x0f
+#define TOK_SIZE 0x10
+#define TOK_SAME_DELTA 0x20
+#define TOK_RUN 0x40
+
+/** @brief Largest encoding of one record: token and three varints */
+#define MAX_RECORD_BYTES (1 + 3 * 10)
+
+/** @brief Bytes of a text trace parsed per job */
+#define TEXT_RANGE_BYTES (1UL << 20)
+
+/*
+ * DynamoRIO drcachesim trace_entry_t: packed u16 type, u16 size, u64 addr
+ */
+#define DRMEMTRACE_ENTRY_BYTES 12
+#define DRMEMTRACE_RANGE_ENTRIES (1UL << 16)
+#define DRMEMTRACE_READ 0
+#define DRMEMTRACE_WRITE 1
+#define DRMEMTRACE_PREFETCH 2
+#define DRMEMTRACE_PREFETCH_WRITE 8
+#define DRMEMTRACE_INSTR 10
+#define DRMEMTRACE_INSTR_RETURN 16
+#define DRMEMTRACE_DATA_FLUSH 20
+#define DRMEMTRACE_HEADER 25
+
+/**
+ * @brief Index entry of one chunk of a binary trace
+ */
+typedef struct {
+    uint64_t offset;
+    uint32_t bytes;
+    uint32_t accesses;
+} trace_chunk_t;
+
+typedef enum { SLOT_FREE, SLOT_BUSY, SLOT_READY } slot_state_t;
+
+/**
+ * @brief A buffer of decoded accesses in the reader's ring
+ */
+typedef struct {
+    trace_access_t *acc;
+    size_t count;
+    size_t cap;
+    size_t job;
+    slot_state_t state;
+    bool ok;
+
+    /* Text traces: lines in the range and the malformed ones among them */
+    size_t lines;
+    size_t errors;
+    size_t error_lines[TRACE_REPORTED_ERRORS];
+    bool stopped;
+} trace_slot_t;
+
+struct trace_reader {
+    char *path;
+    int fd;
+    const unsigned char *map;
+    size_t size;
+    trace_format_t format;
+    trace_on_error_t on_error;
+    bool ok;
+
+    /* Lines handed out so far, and the malformed ones among them */
+    size_t lines;
+    size_t errors;
+
+    /* Binary traces: the chunk index */
+    trace_chunk_t *chunks;
+    size_t total_chunks;
+
+    /* Jobs (chunks or text ranges) still to be handed out, and the ring they go through */
+    size_t job_begin;
+    size_t job_end;
+    size_t next_claim;
+    size_t next_consume;
+    trace_slot_t *ring;
+    size_t ring_size;
+    trace_slot_t *held;
+
+    /* Decoder threads */
+    int nthreads;
+    pthread_t *threads;
+    bool stop;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+};
+
+struct trace_writer {
+    FILE *fp;
+    size_t chunk_accesses;
+    trace_access_t *pending;
+    size_t num_pending;
+    unsigned char *encoded;
+    trace_chunk_t *chunks;
+    size_t num_chunks;
+    size_t cap_chunks;
+    uint64_t offset;
+    bool ok;
+};
+
+static const char OP_CHARS[TRACE_NUM_OPS] = {'L', 'S', 'I', 'B', 'E',
+                                             'M', 'P', 'F', 'N'};
+
+/**
+ * @brief Returns the letter used for an op in text traces.
+ */
+char trace_op_char(unsigned char op) {
+    return op < TRACE_NUM_OPS ? OP_CHARS[op] : '?';
+}
+
+/**
+ * @brief Formats an access as a text trace line, without the newline.
+ *
+ * Region markers are written in their load/store form, so the line reads
+ * back as the same access.
+ *
+ * @return The length of the line, as snprintf()
+ */
+int trace_format_access(char *buf, size_t len, const trace_access_t *access) {
+    if (access->op == TRACE_REGION_BEGIN || access->op == TRACE_REGION_END)
+        return snprintf(buf, len, "%c %lx,%u",
+                        access->op == TRACE_REGION_BEGIN ? 'L' : 'S',
+                        TRACE_MARKER_BASE | access->addr, access->size);
+    return snprintf(buf, len, "%c %lx,%u", trace_op_char(access->op),
+                    access->addr, access->size);
+}
+
+/*
+ * Little-endian integers and varints
+ */
+
+static void put_u32(unsigned char *p, uint32_t v) {
+    for (int i = 0; i < 4; i++)
+        p[i] = (unsigned char)(v >> (8 * i));
+}
+
+static void put_u64(unsigned char *p, uint64_t v) {
+    for (int i = 0; i < 8; i++)
+        p[i] = (unsigned char)(v >> (8 * i));
+}
+
+static uint32_t get_u32(const unsigned char *p) {
+    uint32_t v = 0;
+    for (int i = 0; i < 4; i++)
+        v |= (uint32_t)p[i] << (8 * i);
+    return v;
+}
+
+static uint64_t get_u64(const unsigned char *p) {
+    uint64_t v = 0;
+    for (int i = 0; i < 8; i++)
+        v |= (uint64_t)p[i] << (8 * i);
+    return v;
+}
+
+static unsigned char *put_varint(unsigned char *p, uint64_t v) {
+    while (v >= 0x80) {
+        *p++ = (unsigned char)(v | 0x80);
+        v >>= 7;
+    }
+    *p++ = (unsigned char)v;
+    return p;
+}
+
+static bool get_varint(const unsigned char **pp, const unsigned char *end,
+                       uint64_t *v) {
+    const unsigned char *p = *pp;
+    uint64_t result = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (p >= end)
+            return false;
+        unsigned char byte = *p++;
+        result |= (uint64_t)(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) {
+            *pp = p;
+            *v = result;
+            return true;
+        }
+    }
+    return false;
+}
+
+static uint64_t zigzag(uint64_t delta) {
+    return (delta << 1) ^ (uint64_t)(-(int64_t)(delta >> 63));
+}
+
+static uint64_t unzigzag(uint64_t z) {
+    return (z >> 1) ^ (uint64_t)(-(int64_t)(z & 1));
+}
+
+/*
+ * Chunk codec
+ */
+
+/**
+ * @brief Compresses a chunk of accesses.
+ *
+ * @param[in]  acc    The accesses of the chunk
+ * @param[in]  count  Number of accesses
+ * @param[out] out    Buffer of at least count * MAX_RECORD_BYTES bytes
+ *
+ * @return The number of bytes written to out
+ */
+static size_t encode_chunk(const trace_access_t *acc, size_t count,
+                           unsigned char *out) {
+    unsigned char *p = out;
+    uint64_t addr = 0;
+    uint64_t delta = 0;
+    unsigned int size = 0;
+
+    size_t i = 0;
+    while (i < count) {
+        const trace_access_t *a = &acc[i];
+        uint64_t d = a->addr - addr;
+        unsigned char tok = a->op & TOK_OP_MASK;
+        size_t run = 1;
+
+        if (a->size != size)
+            tok |= TOK_SIZE;
+        if (d == delta) {
+            tok |= TOK_SAME_DELTA;
+            while (i + run < count && acc[i + run].op == a->op &&
+                   acc[i + run].size == a->size &&
+                   acc[i + run].addr - acc[i + run - 1].addr == d)
+                run++;
+            if (run > 1)
+                tok |= TOK_RUN;
+        }
+
+        *p++ = tok;
+        if (tok & TOK_RUN)
+            p = put_varint(p, run);
+        if (tok & TOK_SIZE)
+            p = put_varint(p, a->size);
+        if (!(tok & TOK_SAME_DELTA))
+            p = put_varint(p, zigzag(d));
+
+        addr = acc[i + run - 1].addr;
+        delta = d;
+        size = a->size;
+        i += run;
+    }
+    return (size_t)(p - out);
+}
+
+/**
+ * @brief Decompresses a chunk, checking every read against its bounds.
+ *
+ * @return True if the chunk decoded to exactly count accesses
+ */
+static bool decode_chunk(const unsigned char *p, size_t len, size_t count,
+                         trace_access_t *out) {
+    const unsigned char *end = p + len;
+    uint64_t addr = 0;
+    uint64_t delta = 0;
+    uint64_t size = 0;
+
+    size_t i = 0;
+    while (i < count) {
+        if (p >= end)
+            return false;
+        unsigned char tok = *p++;
+        uint64_t run = 1;
+        if ((tok & TOK_RUN) && !get_varint(&p, end, &run))
+            return false;
+        if ((tok & TOK_SIZE) && !get_varint(&p, end, &size))
+            return false;
+        if (!(tok & TOK_SAME_DELTA)) {
+            uint64_t z;
+            if (!get_varint(&p, end, &z))
+                return false;
+            delta = unzigzag(z);
+        }
+        unsigned char op = tok & TOK_OP_MASK;
+        if (op >= TRACE_NUM_OPS || run == 0 || run > count - i ||
+            size > UINT32_MAX)
+            return false;
+        for (uint64_t r = 0; r < run; r++) {
+            addr += delta;
+            out[i].addr = addr;
+            out[i].size = (unsigned int)size;
+            out[i].op = op;
+            i++;
+        }
+    }
+    return p == end;
+}
+
+/*
+ * Reader
+ */
+
+static bool slot_reserve(trace_slot_t *slot, size_t count) {
+    if (slot->cap >= count)
+        return true;
+    trace_access_t *acc = realloc(slot->acc, count * sizeof(*acc));
+    if (acc == NULL)
+        return false;
+    slot->acc = acc;
+    slot->cap = count;
+    return true;
+}
+
+/**
+ * @brief Decodes one chunk of a binary trace into a ring slot.
+ */
+static bool decode_chunk_job(trace_reader_t *r, size_t job,
+                             trace_slot_t *slot) {
+    const trace_chunk_t *chunk = &r->chunks[job];
+    slot->count = 0;
+    if (!slot_reserve(slot, chunk->accesses))
+        return false;
+    if (!decode_chunk(r->map + chunk->offset, chunk->bytes, chunk->accesses,
+                      slot->acc))
+        return false;
+    slot->count = chunk->accesses;
+    return true;
+}
+
+/** @brief Value of each hex digit, or 0xff for any other character */
+static unsigned char HEX_VALUE[256];
+static pthread_once_t hex_once = PTHREAD_ONCE_INIT;
+
+static void init_hex_table(void) {
+    memset(HEX_VALUE, 0xff, sizeof(HEX_VALUE));
+    for (int d = 0; d < 10; d++)
+        HEX_VALUE['0' + d] = (unsigned char)d;
+    for (int d = 0; d < 6; d++) {
+        HEX_VALUE['a' + d] = (unsigned char)(10 + d);
+        HEX_VALUE['A' + d] = (unsigned char)(10 + d);
+    }
+}
+
+static bool parse_hex(const unsigned char **pp, const unsigned char *end,
+                      unsigned long *value) {
+    const unsigned char *p = *pp;
+    unsigned long v = 0;
+    if (end - p >= 2 && p[0] == '0' && (p[1] == 'x' || p[1] == 'X'))
+        p += 2;
+    const unsigned char *digits = p;
+    for (; p < end && HEX_VALUE[*p] != 0xff; p++)
+        v = v << 4 | HEX_VALUE[*p];
+    *pp = p;
+    *value = v;
+    return p > digits;
+}
+
+/**
+ * @brief Parses the "addr,size" part of a text trace line.
+ */
+static bool parse_addr_size(const unsigned char *p, const unsigned char *end,
+                            trace_access_t *out) {
+    while (p < end && (*p == ' ' || *p == '\t'))
+        p++;
+    if (!parse_hex(&p, end, &out->addr) || p >= end || *p != ',')
+        return false;
+    p++;
+    const unsigned char *digits = p;
+    unsigned long size = 0;
+    while (p < end && *p >= '0' && *p <= '9' && size <= UINT32_MAX)
+        size = size * 10 + (unsigned long)(*p++ - '0');
+    if (p == digits || size > UINT32_MAX)
+        return false;
+    out->size = (unsigned int)size;
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r'))
+        p++;
+    return p == end;
+}
+
+/**
+ * @brief Checks for a line without an access: blank, or a '#' comment.
+ */
+static bool is_blank_or_comment(const unsigned char *p,
+                                const unsigned char *end) {
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r'))
+        p++;
+    return p == end || *p == '#';
+}
+
+/** @brief Op of each letter of a text trace, or TRACE_NUM_OPS */
+static unsigned char TEXT_OP[256];
+static pthread_once_t text_op_once = PTHREAD_ONCE_INIT;
+
+static void init_text_op_table(void) {
+    static const unsigned char ops[] = {TRACE_LOAD,     TRACE_STORE,
+                                        TRACE_IFETCH,   TRACE_MODIFY,
+                                        TRACE_PREFETCH, TRACE_FLUSH,
+                                        TRACE_NT_STORE};
+    memset(TEXT_OP, TRACE_NUM_OPS, sizeof(TEXT_OP));
+    for (size_t i = 0; i < sizeof(ops); i++)
+        TEXT_OP[(unsigned char)OP_CHARS[ops[i]]] = ops[i];
+}
+
+/**
+ * @brief Parses one "op addr,size" line of a lab trace.
+ *
+ * Loads and stores of a marker address become region markers.
+ *
+ * @return The number of accesses stored in out (1), or -1 if invalid
+ */
+static int parse_text_line(const unsigned char *p, const unsigned char *end,
+                           trace_access_t *out) {
+    if (p >= end || TEXT_OP[*p] == TRACE_NUM_OPS)
+        return -1;
+    out->op = TEXT_OP[*p];
+    if (!parse_addr_size(p + 1, end, out))
+        return -1;
+    if ((out->addr & ~TRACE_MARKER_ID_MASK) == TRACE_MARKER_BASE &&
+        (out->op == TRACE_LOAD || out->op == TRACE_STORE)) {
+        out->op = out->op == TRACE_LOAD ? TRACE_REGION_BEGIN : TRACE_REGION_END;
+        out->addr &= TRACE_MARKER_ID_MASK;
+    }
+    return 1;
+}
+
+/**
+ * @brief Parses one line of Valgrind Lackey output.
+ *
+ * Lackey prints "I  addr,size" for instruction fetches and " L", " S" or
+ * " M" for data accesses; a modify is stored as a load and then a store.
+ * Valgrind's own "==pid==" messages are skipped.
+ *
+ * @return The number of accesses stored in out (0 to 2), or -1 if invalid
+ */
+static int parse_lackey_line(const unsigned char *p, const unsigned char *end,
+                             trace_access_t *out) {
+    if (end - p >= 2 && p[0] == '=' && p[1] == '=')
+        return 0;
+    while (p < end && *p == ' ')
+        p++;
+    if (p >= end)
+        return -1;
+    unsigned char op = *p++;
+    switch (op) {
+    case 'I':
+        out->op = TRACE_IFETCH;
+        break;
+    case 'L':
+    case 'M':
+        out->op = TRACE_LOAD;
+        break;
+    case 'S':
+        out->op = TRACE_STORE;
+        break;
+    default:
+        return -1;
+    }
+    if (!parse_addr_size(p, end, out))
+        return -1;
+    if (op != 'M')
+        return 1;
+    out[1] = out[0];
+    out[1].op = TRACE_STORE;
+    return 2;
+}
+
+/**
+ * @brief Parses the lines that start in one byte range of a text trace.
+ *
+ * Blank lines and comments are skipped. Malformed lines are counted, and
+ * the first few of them remembered by their line number within the range;
+ * unless they are to be skipped, parsing stops at the first one.
+ */
+static bool parse_text_job(trace_reader_t *r, size_t job,
+                           trace_slot_t *slot) {
+    size_t start = job * TEXT_RANGE_BYTES;
+    size_t stop = start + TEXT_RANGE_BYTES < r->size
+                      ? start + TEXT_RANGE_BYTES
+                      : r->size;
+    const unsigned char *p = r->map + start;
+    const unsigned char *range_end = r->map + stop;
+    const unsigned char *end = r->map + r->size;
+    int (*parse_line)(const unsigned char *, const unsigned char *,
+                      trace_access_t *) =
+        r->format == TRACE_FORMAT_LACKEY ? parse_lackey_line
+                                         : parse_text_line;
+
+    /* The line running into this range belongs to the previous one */
+    if (start > 0 && p[-1] != '\n') {
+        p = memchr(p, '\n', (size_t)(end - p));
+        p = p != NULL ? p + 1 : end;
+    }
+
+    while (p < range_end) {
+        const unsigned char *eol = memchr(p, '\n', (size_t)(end - p));
+        if (eol == NULL)
+            eol = end;
+        if (slot->count + 2 > slot->cap &&
+            !slot_reserve(slot, slot->cap ? 2 * slot->cap : 16384))
+            return false;
+        int n = parse_line(p, eol, &slot->acc[slot->count]);
+        if (n > 0) {
+            slot->count += (size_t)n;
+        } else if (n < 0 && !is_blank_or_comment(p, eol)) {
+            if (slot->errors < TRACE_REPORTED_ERRORS)
+                slot->error_lines[slot->errors] = slot->lines;
+            slot->errors++;
+            if (r->on_error != TRACE_ON_ERROR_SKIP) {
+                slot->stopped = true;
+                break;
+            }
+        }
+        slot->lines++;
+        p = eol < end ? eol + 1 : end;
+    }
+    return true;
+}
+
+/**
+ * @brief Converts one range of DynamoRIO trace_entry_t records.
+ *
+ * Data reads and writes become loads and stores, the instruction entries
+ * become fetches, data prefetches become prefetches and data flushes
+ * become flushes of their first block. Instruction prefetches, markers,
+ * headers and the other bookkeeping entries are skipped, as are
+ * instruction bundles, which only appear in traces from old DynamoRIO
+ * releases.
+ */
+static bool parse_drmemtrace_job(trace_reader_t *r, size_t job,
+                                 trace_slot_t *slot) {
+    size_t first = job * DRMEMTRACE_RANGE_ENTRIES;
+    size_t last = r->size / DRMEMTRACE_ENTRY_BYTES;
+    if (last - first > DRMEMTRACE_RANGE_ENTRIES)
+        last = first + DRMEMTRACE_RANGE_ENTRIES;
+
+    slot->count = 0;
+    if (!slot_reserve(slot, last - first))
+        return false;
+    for (size_t i = first; i < last; i++) {
+        const unsigned char *e = r->map + i * DRMEMTRACE_ENTRY_BYTES;
+        unsigned int type = (unsigned int)e[0] | (unsigned int)e[1] << 8;
+        unsigned int size = (unsigned int)e[2] | (unsigned int)e[3] << 8;
+        trace_access_t *out = &slot->acc[slot->count];
+        if (type == DRMEMTRACE_READ)
+            out->op = TRACE_LOAD;
+        else if (type == DRMEMTRACE_WRITE)
+            out->op = TRACE_STORE;
+        else if (type >= DRMEMTRACE_INSTR && type <= DRMEMTRACE_INSTR_RETURN)
+            out->op = TRACE_IFETCH;
+        else if (type >= DRMEMTRACE_PREFETCH &&
+                 type <= DRMEMTRACE_PREFETCH_WRITE)
+            out->op = TRACE_PREFETCH;
+        else if (type == DRMEMTRACE_DATA_FLUSH)
+            out->op = TRACE_FLUSH;
+        else
+            continue;
+        out->addr = get_u64(e + 4);
+        out->size = size;
+        slot->count++;
+    }
+    return true;
+}
+
+static bool decode_job(trace_reader_t *r, size_t job, trace_slot_t *slot) {
+    slot->count = 0;
+    slot->lines = 0;
+    slot->errors = 0;
+    slot->stopped = false;
+    switch (r->format) {
+    case TRACE_FORMAT_BINARY:
+        return decode_chunk_job(r, job, slot);
+    case TRACE_FORMAT_DRMEMTRACE:
+        return parse_drmemtrace_job(r, job, slot);
+    default:
+        return parse_text_job(r, job, slot);
+    }
+}
+
+static void *decoder_thread(void *arg) {
+    trace_reader_t *r = arg;
+
+    pthread_mutex_lock(&r->lock);
+    for (;;) {
+        while (!r->stop && r->next_claim < r->job_end &&
+               r->ring[(r->next_claim - r->job_begin) % r->ring_size].state !=
+                   SLOT_FREE)
+            pthread_cond_wait(&r->cond, &r->lock);
+        if (r->stop || r->next_claim >= r->job_end)
+            break;
+
+        size_t job = r->next_claim++;
+        trace_slot_t *slot = &r->ring[(job - r->job_begin) % r->ring_size];
+        slot->state = SLOT_BUSY;
+        slot->job = job;
+        pthread_mutex_unlock(&r->lock);
+
+        bool ok = decode_job(r, job, slot);
+
+        pthread_mutex_lock(&r->lock);
+        slot->ok = ok;
+        slot->state = SLOT_READY;
+        pthread_cond_broadcast(&r->cond);
+    }
+    pthread_mutex_unlock(&r->lock);
+    return NULL;
+}
+
+/**
+ * @brief Reads and checks the header, footer and index of a binary trace.
+ */
+static bool load_index(trace_reader_t *r) {
+    if (r->size < HEADER_BYTES + FOOTER_BYTES ||
+        get_u32(r->map + 8) != TRACE_VERSION)
+        return false;
+
+    const unsigned char *footer = r->map + r->size - FOOTER_BYTES;
+    uint64_t index_offset = get_u64(footer);
+    uint64_t num_chunks = get_u64(footer + 8);
+    if (memcmp(footer + 16, INDEX_MAGIC, 8) != 0 ||
+        index_offset < HEADER_BYTES ||
+        num_chunks > (r->size - FOOTER_BYTES) / INDEX_ENTRY_BYTES ||
+        index_offset + num_chunks * INDEX_ENTRY_BYTES !=
+            r->size - FOOTER_BYTES)
+        return false;
+
+    r->total_chunks = (size_t)num_chunks;
+    r->chunks = calloc(r->total_chunks + 1, sizeof(*r->chunks));
+    if (r->chunks == NULL)
+        return false;
+    for (size_t i = 0; i < r->total_chunks; i++) {
+        const unsigned char *e =
+            r->map + index_offset + i * INDEX_ENTRY_BYTES;
+        trace_chunk_t *c = &r->chunks[i];
+        c->offset = get_u64(e);
+        c->bytes = get_u32(e + 8);
+        c->accesses = get_u32(e + 12);
+        if (c->offset < HEADER_BYTES || c->offset > index_offset ||
+            c->bytes > index_offset - c->offset)
+            return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Guesses the format of a trace from its first bytes.
+ */
+static trace_format_t detect_format(const trace_reader_t *r) {
+    const unsigned char *p = r->map;
+    if (r->size >= 8 && memcmp(p, TRACE_MAGIC, 8) == 0)
+        return TRACE_FORMAT_BINARY;
+    if (r->size >= DRMEMTRACE_ENTRY_BYTES && p[0] == DRMEMTRACE_HEADER &&
+        p[1] == 0)
+        return TRACE_FORMAT_DRMEMTRACE;
+    if (r->size >= 3 && (p[0] == ' ' || (p[0] == '=' && p[1] == '=') ||
+                         (p[0] == 'I' && p[1] == ' ' && p[2] == ' ')))
+        return TRACE_FORMAT_LACKEY;
+    return TRACE_FORMAT_TEXT;
+}
+
+/**
+ * @brief Returns the name of a trace format, as accepted by
+ * trace_format_parse().
+ */
+const char *trace_format_name(trace_format_t format) {
+    switch (format) {
+    case TRACE_FORMAT_TEXT:
+        return "text";
+    case TRACE_FORMAT_LACKEY:
+        return "lackey";
+    case TRACE_FORMAT_DRMEMTRACE:
+        return "drmemtrace";
+    case TRACE_FORMAT_BINARY:
+        return "binary";
+    default:
+        return "auto";
+    }
+}
+
+/**
+ * @brief Looks up a trace format by name.
+ *
+ * @return True if the name is known
+ */
+bool trace_format_parse(const char *name, trace_format_t *format) {
+    for (int f = TRACE_FORMAT_AUTO; f <= TRACE_FORMAT_BINARY; f++) {
+        if (strcmp(name, trace_format_name((trace_format_t)f)) == 0) {
+            *format = (trace_format_t)f;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Opens a trace for reading.
+ *
+ * Unless options ask for a specific format, it is recognized from the
+ * first bytes of the file. Options also select the number of parser
+ * threads and, for binary traces, the range of chunks to read; options may
+ * be NULL for the whole trace, parsed in the calling thread.
+ *
+ * @return The reader, or NULL with an error message printed.
+ */
+trace_reader_t *trace_open(const char *path, const trace_options_t *options) {
+    trace_reader_t *r = calloc(1, sizeof(*r));
+    if (r == NULL)
+        return NULL;
+    r->fd = -1;
+    r->ok = true;
+    pthread_once(&hex_once, init_hex_table);
+    pthread_once(&text_op_once, init_text_op_table);
+    r->path = strdup(path);
+
+    r->fd = open(path, O_RDONLY);
+    struct stat st;
+    if (r->fd < 0 || fstat(r->fd, &st) < 0) {
+        fprintf(stderr, "Failed to open trace %s: %s\n", path,
+                strerror(errno));
+        trace_close(r);
+        return NULL;
+    }
+    r->size = (size_t)st.st_size;
+    if (r->size > 0) {
+        void *map = mmap(NULL, r->size, PROT_READ, MAP_PRIVATE, r->fd, 0);
+        if (map == MAP_FAILED) {
+            fprintf(stderr, "Failed to map trace %s: %s\n", path,
+                    strerror(errno));
+            trace_close(r);
+            return NULL;
+        }
+        r->map = map;
+        madvise(map, r->size, MADV_SEQUENTIAL);
+    }
+
+    trace_options_t defaults = {0};
+    if (options == NULL)
+        options = &defaults;
+
+    r->on_error = options->on_error;
+    r->format = options->format != TRACE_FORMAT_AUTO ? options->format
+                                                     : detect_format(r);
+    if ((r->format == TRACE_FORMAT_BINARY && !load_index(r)) ||
+        (r->format == TRACE_FORMAT_DRMEMTRACE &&
+         r->size % DRMEMTRACE_ENTRY_BYTES != 0)) {
+        fprintf(stderr, "Corrupt %s trace %s\n",
+                trace_format_name(r->format), path);
+        trace_close(r);
+        return NULL;
+    }
+
+    if (r->format == TRACE_FORMAT_DRMEMTRACE) {
+        size_t entries = r->size / DRMEMTRACE_ENTRY_BYTES;
+        r->job_end = (entries + DRMEMTRACE_RANGE_ENTRIES - 1) /
+                     DRMEMTRACE_RANGE_ENTRIES;
+    } else if (r->format != TRACE_FORMAT_BINARY) {
+        r->job_end = (r->size + TEXT_RANGE_BYTES - 1) / TEXT_RANGE_BYTES;
+    } else {
+        r->job_begin = options->first_chunk < r->total_chunks
+                           ? options->first_chunk
+                           : r->total_chunks;
+        r->job_end = r->total_chunks;
+        if (options->num_chunks > 0 &&
+            options->num_chunks < r->job_end - r->job_begin)
+            r->job_end = r->job_begin + options->num_chunks;
+    }
+    r->nthreads = options->threads > 0 ? options->threads : 0;
+    if ((size_t)r->nthreads > r->job_end - r->job_begin)
+        r->nthreads = (int)(r->job_end - r->job_begin);
+    r->next_claim = r->next_consume = r->job_begin;
+    r->ring_size = r->nthreads > 0 ? 2 * (size_t)r->nthreads : 1;
+    r->ring = calloc(r->ring_size, sizeof(*r->ring));
+    if (r->ring == NULL) {
+        trace_close(r);
+        return NULL;
+    }
+
+    if (r->nthreads > 0) {
+        pthread_mutex_init(&r->lock, NULL);
+        pthread_cond_init(&r->cond, NULL);
+        r->threads = calloc((size_t)r->nthreads, sizeof(*r->threads));
+        if (r->threads == NULL) {
+            r->nthreads = 0;
+            trace_close(r);
+            return NULL;
+        }
+        for (int i = 0; i < r->nthreads; i++) {
+            if (pthread_create(&r->threads[i], NULL, decoder_thread, r) != 0) {
+                /* Fall back to the threads that did start */
+                r->nthreads = i;
+                break;
+            }
+        }
+    }
+    return r;
+}
+
+/**
+ * @brief Prints the malformed lines of a batch, with their line numbers.
+ */
+static void report_errors(trace_reader_t *r, const trace_slot_t *slot) {
+    for (size_t i = 0; i < slot->errors; i++) {
+        if (r->errors + i >= TRACE_REPORTED_ERRORS)
+            break;
+        fprintf(stderr, "%s:%zu: malformed line%s\n", r->path,
+                r->lines + slot->error_lines[i] + 1,
+                r->on_error == TRACE_ON_ERROR_SKIP ? ", skipped" : "");
+    }
+    if (r->errors < TRACE_REPORTED_ERRORS &&
+        r->errors + slot->errors >= TRACE_REPORTED_ERRORS &&
+        r->on_error == TRACE_ON_ERROR_SKIP)
+        fprintf(stderr, "%s: not reporting further malformed lines\n",
+                r->path);
+    r->lines += slot->lines;
+    r->errors += slot->errors;
+}
+
+/**
+ * @brief Returns the next batch of accesses in trace order.
+ *
+ * The batch stays valid until the next call. At the end of the trace, or
+ * after the first malformed line or corrupt chunk, NULL is returned;
+ * trace_close() tells the two apart. Malformed lines are reported on
+ * stderr; if they are to be skipped, the batch holds the valid lines
+ * around them and reading goes on.
+ *
+ * @param[in]  reader  The trace reader
+ * @param[out] count   Number of accesses in the batch
+ */
+const trace_access_t *trace_next(trace_reader_t *r, size_t *count) {
+    if (r->held != NULL) {
+        if (r->threads != NULL) {
+            pthread_mutex_lock(&r->lock);
+            r->held->state = SLOT_FREE;
+            pthread_cond_broadcast(&r->cond);
+            pthread_mutex_unlock(&r->lock);
+        } else {
+            r->held->state = SLOT_FREE;
+        }
+        r->held = NULL;
+    }
+    if (!r->ok)
+        return NULL;
+
+    if (r->next_consume >= r->job_end)
+        return NULL;
+    trace_slot_t *slot =
+        &r->ring[(r->next_consume - r->job_begin) % r->ring_size];
+    if (r->threads == NULL) {
+        slot->ok = decode_job(r, r->next_consume, slot);
+    } else {
+        pthread_mutex_lock(&r->lock);
+        while (slot->state != SLOT_READY || slot->job != r->next_consume)
+            pthread_cond_wait(&r->cond, &r->lock);
+        pthread_mutex_unlock(&r->lock);
+    }
+    r->next_consume++;
+
+    r->held = slot;
+    if (!slot->ok) {
+        r->ok = false;
+        return NULL;
+    }
+    report_errors(r, slot);
+    if (slot->stopped)
+        r->ok = false;
+    *count = slot->count;
+    return slot->acc;
+}
+
+/**
+ * @brief Returns the number of malformed lines found so far.
+ */
+size_t trace_errors(const trace_reader_t *r) {
+    return r->errors;
+}
+
+/**
+ * @brief Returns the number of chunks of a binary trace, 0 for text.
+ */
+size_t trace_num_chunks(const trace_reader_t *r) {
+    return r->total_chunks;
+}
+
+/**
+ * @brief Closes a reader and releases everything it holds.
+ *
+ * @return False if reading stopped at a malformed line or corrupt chunk
+ */
+bool trace_close(trace_reader_t *r) {
+    if (r->threads != NULL) {
+        pthread_mutex_lock(&r->lock);
+        r->stop = true;
+        pthread_cond_broadcast(&r->cond);
+        pthread_mutex_unlock(&r->lock);
+        for (int i = 0; i < r->nthreads; i++)
+            pthread_join(r->threads[i], NULL);
+        pthread_mutex_destroy(&r->lock);
+        pthread_cond_destroy(&r->cond);
+        free(r->threads);
+    }
+    for (size_t i = 0; r->ring != NULL && i < r->ring_size; i++)
+        free(r->ring[i].acc);
+    free(r->ring);
+    free(r->chunks);
+    if (r->map != NULL)
+        munmap((void *)r->map, r->size);
+    if (r->fd >= 0)
+        close(r->fd);
+    bool ok = r->ok;
+    free(r->path);
+    free(r);
+    return ok;
+}
+
+/*
+ * Writer
+ */
+
+static bool write_bytes(trace_writer_t *w, const void *buf, size_t len) {
+    if (w->ok && fwrite(buf, 1, len, w->fp) != len)
+        w->ok = false;
+    w->offset += len;
+    return w->ok;
+}
+
+static bool flush_chunk(trace_writer_t *w) {
+    if (w->num_pending == 0)
+        return w->ok;
+    if (w->num_chunks == w->cap_chunks) {
+        size_t cap = w->cap_chunks ? 2 * w->cap_chunks : 64;
+        trace_chunk_t *chunks = realloc(w->chunks, cap * sizeof(*chunks));
+        if (chunks == NULL)
+            return w->ok = false;
+        w->chunks = chunks;
+        w->cap_chunks = cap;
+    }
+
+    size_t bytes = encode_chunk(w->pending, w->num_pending, w->encoded);
+    trace_chunk_t *c = &w->chunks[w->num_chunks++];
+    c->offset = w->offset;
+    c->bytes = (uint32_t)bytes;
+    c->accesses = (uint32_t)w->num_pending;
+    w->num_pending = 0;
+    return write_bytes(w, w->encoded, bytes);
+}
+
+/**
+ * @brief Creates a binary trace.
+ *
+ * @param[in] path            The file to create
+ * @param[in] chunk_accesses  Accesses per chunk, 0 for the default
+ *
+ * @return The writer, or NULL with an error message printed.
+ */
+trace_writer_t *trace_writer_open(const char *path, size_t chunk_accesses) {
+    if (chunk_accesses == 0)
+        chunk_accesses = TRACE_CHUNK_ACCESSES;
+    if (chunk_accesses > UINT32_MAX / MAX_RECORD_BYTES)
+        chunk_accesses = UINT32_MAX / MAX_RECORD_BYTES;
+
+    trace_writer_t *w = calloc(1, sizeof(*w));
+    if (w == NULL)
+        return NULL;
+    w->ok = true;
+    w->chunk_accesses = chunk_accesses;
+    w->pending = malloc(chunk_accesses * sizeof(*w->pending));
+    w->encoded = malloc(chunk_accesses * MAX_RECORD_BYTES);
+    w->fp = fopen(path, "wb");
+    if (w->pending == NULL || w->encoded == NULL || w->fp == NULL) {
+        fprintf(stderr, "Failed to create trace %s: %s\n", path,
+                strerror(errno));
+        if (w->fp != NULL)
+            fclose(w->fp);
+        free(w->pending);
+        free(w->encoded);
+        free(w);
+        return NULL;
+    }
+
+    unsigned char header[HEADER_BYTES];
+    memcpy(header, TRACE_MAGIC, 8);
+    put_u32(header + 8, TRACE_VERSION);
+    put_u32(header + 12, 0);
+    write_bytes(w, header, sizeof(header));
+    return w;
+}
+
+/**
+ * @brief Appends one access to a binary trace.
+ */
+bool trace_writer_put(trace_writer_t *w, const trace_access_t *access) {
+    w->pending[w->num_pending++] = *access;
+    if (w->num_pending == w->chunk_accesses)
+        return flush_chunk(w);
+    return w->ok;
+}
+
+/**
+ * @brief Writes the last chunk, the index and the footer, and closes.
+ *
+ * @return False if anything failed while writing the trace
+ */
+bool trace_writer_close(trace_writer_t *w) {
+    flush_chunk(w);
+
+    uint64_t index_offset = w->offset;
+    for (size_t i = 0; i < w->num_chunks; i++) {
+        unsigned char e[INDEX_ENTRY_BYTES];
+        put_u64(e, w->chunks[i].offset);
+        put_u32(e + 8, w->chunks[i].bytes);
+        put_u32(e + 12, w->chunks[i].accesses);
+        write_bytes(w, e, sizeof(e));
+    }
+
+    unsigned char footer[FOOTER_BYTES];
+    put_u64(footer, index_offset);
+    put_u64(footer + 8, w->num_chunks);
+    memcpy(footer + 16, INDEX_MAGIC, 8);
+    write_bytes(w, footer, sizeof(footer));
+
+    if (fclose(w->fp) != 0)
+        w->ok = false;
+    bool ok = w->ok;
+    free(w->pending);
+    free(w->encoded);
+    free(w->chunks);
+    free(w);
+    return ok;
+}
@@ -0,0 +1,135 @@
+/**
+ * @file trace.h
+ * @brief Reading and writing memory traces for the cache simulator
+ *
+ * These trace formats are understood:
+ *
+ *   - Text traces, one "op addr,size" line per access, as used by the lab,
+ *     extended with the M, P, F and N ops of trace_op_t.
+ *   - Valgrind Lackey output (valgrind --tool=lackey --trace-mem=yes).
+ *   - Uncompressed DynamoRIO drcachesim traces of trace_entry_t records.
+ *   - Binary traces, which store the accesses in independently compressed
+ *     chunks followed by an index of the chunks, so that any chunk can be
+ *     found and decoded without reading the ones before it.
+ *
+ * A reader hands out the accesses in trace order, in batches. Chunks of a
+ * binary trace, and byte ranges of a text trace, are parsed ahead of the
+ * consumer by a pool of threads.
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Kinds of trace records
+ */
+typedef enum {
+    TRACE_LOAD,         /* 'L' */
+    TRACE_STORE,        /* 'S' */
+    TRACE_IFETCH,       /* 'I', instruction fetch */
+    TRACE_REGION_BEGIN, /* 'B', region marker; addr is the region ID */
+    TRACE_REGION_END,   /* 'E' */
+    TRACE_MODIFY,       /* 'M', a load and then a store */
+    TRACE_PREFETCH,     /* 'P', software prefetch */
+    TRACE_FLUSH,        /* 'F', write back and invalidate (clflush) */
+    TRACE_NT_STORE,     /* 'N', non-temporal store, bypassing the cache */
+    TRACE_NUM_OPS
+} trace_op_t;
+
+/**
+ * Region markers travel through text traces as a load (begin) or store
+ * (end) of TRACE_MARKER_BASE plus the region ID, an address no program
+ * touches. tracegen-ct brackets each transpose function with them.
+ */
+#define TRACE_MARKER_BASE 0x3ffff00000000UL
+#define TRACE_MARKER_ID_MASK 0xffffffffUL
+
+/**
+ * @brief One memory access of a trace
+ */
+typedef struct {
+    unsigned long addr; /* address accessed */
+    unsigned int size;  /* number of bytes accessed */
+    unsigned char op;   /* a trace_op_t */
+} trace_access_t;
+
+/**
+ * @brief Trace file formats
+ */
+typedef enum {
+    TRACE_FORMAT_AUTO, /* recognize from the file contents */
+    TRACE_FORMAT_TEXT,
+    TRACE_FORMAT_LACKEY,
+    TRACE_FORMAT_DRMEMTRACE,
+    TRACE_FORMAT_BINARY
+} trace_format_t;
+
+/**
+ * @brief What to do with a malformed line of a text trace
+ */
+typedef enum {
+    TRACE_ON_ERROR_ABORT, /* stop reading at the first one */
+    TRACE_ON_ERROR_SKIP   /* count and report it, and go on */
+} trace_on_error_t;
+
+/**
+ * @brief Options for opening a trace
+ */
+typedef struct {
+    trace_format_t format; /* format of the file, or TRACE_FORMAT_AUTO */
+    int threads;           /* parser threads, 0 to parse in the caller */
+    size_t first_chunk;    /* first chunk of a binary trace to read */
+    size_t num_chunks;     /* chunks to read, 0 for all remaining */
+    trace_on_error_t on_error;
+} trace_options_t;
+
+/** @brief Number of malformed lines reported with their line number */
+#define TRACE_REPORTED_ERRORS 10
+
+/** @brief Default number of accesses per chunk of a binary trace */
+#define TRACE_CHUNK_ACCESSES (1UL << 20)
+
+typedef struct trace_reader trace_reader_t;
+typedef struct trace_writer trace_writer_t;
+
+/** @brief Returns the letter used for an op in text traces */
+char trace_op_char(unsigned char op);
+
+/** @brief Formats an access as a text trace line, without the newline */
+int trace_format_access(char *buf, size_t len, const trace_access_t *access);
+
+/** @brief Returns the name of a trace format */
+const char *trace_format_name(trace_format_t format);
+
+/** @brief Looks up a trace format by name */
+bool trace_format_parse(const char *name, trace_format_t *format);
+
+/** @brief Opens a trace for reading */
+trace_reader_t *trace_open(const char *path, const trace_options_t *options);
+
+/** @brief Returns the next batch of accesses, or NULL at the end */
+const trace_access_t *trace_next(trace_reader_t *reader, size_t *count);
+
+/** @brief Returns the number of malformed lines found so far */
+size_t trace_errors(const trace_reader_t *reader);
+
+/** @brief Returns the number of chunks of a binary trace, 0 for text */
+size_t trace_num_chunks(const trace_reader_t *reader);
+
+/** @brief Closes a reader; returns false if the trace was not valid */
+bool trace_close(trace_reader_t *reader);
+
+/** @brief Creates a binary trace */
+trace_writer_t *trace_writer_open(const char *path, size_t chunk_accesses);
+
+/** @brief Appends one access to a binary trace */
+bool trace_writer_put(trace_writer_t *writer, const trace_access_t *access);
+
+/** @brief Finishes a binary trace; returns false if anything failed */
+bool trace_writer_close(trace_writer_t *writer);
+
+#endif /* TRACE_H */
@@ -5,7 +5,10 @@
  * The tracing functionality will only record memory accesses from
  * the registered transpose functions; however, if multiple functions
  * are invoked during a single execution, the trace will contain
- * all of the accesses together.
+ * all of the accesses together. In that case each function's accesses
+ * are bracketed by region markers carrying its function number, so that
+ * "csim --regions" can report every function from the one trace. A trace
+ * of a single function (-F) has no markers, so any simulator can read it.
  */
 
 #include "cachelab.h"
@@ -19,11 +22,24 @@
 #include <unistd.h>
 
 #include "cachelab.h"
+#include "trace.h"
 
 /* Enable / disable tracing */
 extern void __roi_begin(void);
 extern void __roi_end(void);
 
+/* Parts of the CT runtime used to append records to the trace buffer */
+extern void *__ctGetBuffer(void);
+extern unsigned int __ctGetBufferPos(void *buffer);
+extern void __ctCheckBufferSize(unsigned int pos);
+extern char *__ctStoreBasicBlock(unsigned int id, unsigned int pos,
+                                 void *buffer);
+extern void __ctStoreMemOp(void *addr, char isWrite, unsigned int sizeLog2,
+                           unsigned int index, char *base);
+extern unsigned int __ctStoreBasicBlockComplete(unsigned int numOps,
+                                                unsigned int pos,
+                                                void *buffer);
+
 /* Need to make sure A and B start on cache block boundaries */
 static double bigA[MAXN][MAXN] __attribute__((aligned(64)));
 static double bigT[TMPCOUNT] __attribute__((aligned(64)));
@@ -78,6 +94,44 @@ bool validate(int fn, double A[N][M], double Acopy[N][M], double B[M][N],
     return true;
 }
 
+/**
+ * @brief Appends a region marker to the trace.
+ *
+ * The marker is written as a one-byte load (begin) or store (end) of the
+ * reserved address TRACE_MARKER_BASE + id, recorded in the buffer of the
+ * current region of interest exactly like an instrumented access.
+ */
+static void emit_marker(int id, bool end) {
+    void *buffer = __ctGetBuffer();
+    if (buffer == NULL)
+        return;
+    /* Hand a nearly full buffer to the writer, as instrumented code does */
+    __ctCheckBufferSize(__ctGetBufferPos(buffer));
+    buffer = __ctGetBuffer();
+    unsigned int pos = __ctGetBufferPos(buffer);
+    char *base = __ctStoreBasicBlock(0, pos, buffer);
+    __ctStoreMemOp((void *)(TRACE_MARKER_BASE | (unsigned long)id), end, 0, 0,
+                   base);
+    __ctStoreBasicBlockComplete(1, pos, buffer);
+}
+
+/**
+ * @brief Runs one transpose function inside a region of interest.
+ *
+ * @param[in] fn    Index of the transpose function
+ * @param[in] mark  Whether to bracket its accesses with region markers
+ */
+static void run_traced(int fn, bool mark) {
+    memset(bigT, 0, sizeof(bigT));
+    __roi_begin();
+    if (mark)
+        emit_marker(fn, false);
+    (*func_list[fn].func_ptr)(M, N, bigA, bigB, bigT);
+    if (mark)
+        emit_marker(fn, true);
+    __roi_end();
+}
+
 static void usage(char *cmd) {
     fprintf(stderr, "Usage: %s [-h] [-M M] [-N N] [-F ID]\n", cmd);
     fprintf(stderr, "  -N N    Set number of rows of A / cols of B\n");
@@ -165,19 +219,13 @@ int entry(int argc, char *argv[]) {
     if (-1 == selectedFunc) {
         /* Invoke registered transpose functions */
         for (i = 0; i < func_counter; i++) {
-            memset(bigT, 0, sizeof(bigT));
-            __roi_begin();
-            (*func_list[i].func_ptr)(M, N, bigA, bigB, bigT);
-            __roi_end();
+            run_traced(i, true);
             if (!validate(i, bigA, bigAcopy, bigB, bigBtarg)) {
                 return i + 1;
             }
         }
     } else {
-        memset(bigT, 0, sizeof(bigT));
-        __roi_begin();
-        (*func_list[selectedFunc].func_ptr)(M, N, bigA, bigB, bigT);
-        __roi_end();
+        run_traced(selectedFunc, false);
         if (!validate(selectedFunc, bigA, bigAcopy, bigB, bigBtarg)) {
             return 1;
         }
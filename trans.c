@@ -17,6 +17,10 @@
  * A transpose function is evaluated by counting the number of hits and misses,
  * using the cache parameters and score computations described in the writeup.
  *
+ * Read A and tmp through TRANS_LD() and write B and tmp through TRANS_ST()
+ * (see cachelab.h). They are plain array accesses, except in tracegen-src,
+ * where they also record the access in the trace.
+ *
  * Programming restrictions:
  *   - No out-of-bounds references are allowed
  *   - No alterations may be made to the source array A
@@ -85,7 +89,7 @@ static void trans_basic(size_t M, size_t N, double A[N][M], double B[M][N],
 
     for (size_t i = 0; i < N; i++) {
         for (size_t j = 0; j < M; j++) {
-            B[j][i] = A[i][j];
+            TRANS_ST(B[j][i], TRANS_LD(A[i][j]));
         }
     }
 
@@ -107,8 +111,8 @@ static void trans_tmp(size_t M, size_t N, double A[N][M], double B[M][N],
         for (size_t j = 0; j < M; j++) {
             size_t di = i % 2;
             size_t dj = j % 2;
-            tmp[2 * di + dj] = A[i][j];
-            B[j][i] = tmp[2 * di + dj];
+            TRANS_ST(tmp[2 * di + dj], TRANS_LD(A[i][j]));
+            TRANS_ST(B[j][i], TRANS_LD(tmp[2 * di + dj]));
         }
     }
 
@@ -140,24 +144,24 @@ static void transpose_submit(size_t M, size_t N, double A[N][M], double B[M][N],
                 for (size_t ii = i; ii < i + 8; ii++) {
                     for (size_t jj = j; jj < j + 8; jj++) {
                         if (ii == jj) {
-                            tmp[tmpIndex] = A[ii][jj];
+                            TRANS_ST(tmp[tmpIndex], TRANS_LD(A[ii][jj]));
                             tmpIndex--;
                             continue;
                         }
-                        B[jj][ii] = A[ii][jj];
+                        TRANS_ST(B[jj][ii], TRANS_LD(A[ii][jj]));
                     }
                 }
             }
         }
         for (size_t i = 0; i < 32; i++) {
-            B[i][i] = tmp[TMPCOUNT - 1 - i];
+            TRANS_ST(B[i][i], TRANS_LD(tmp[TMPCOUNT - 1 - i]));
         }
     } else if (M == 1024.0 && N == 1024.0) {
         for (size_t i = 0; i < N; i += 8) {
             for (size_t j = 0; j < M; j += 8) {
                 for (size_t ii = i; ii < i + 8; ii++) {
                     for (size_t jj = j; jj < j + 8; jj++) {
-                        B[jj][ii] = A[ii][jj];
+                        TRANS_ST(B[jj][ii], TRANS_LD(A[ii][jj]));
                     }
                 }
             }
@@ -0,0 +1,223 @@
+/**
+ * @file translate.c
+ * @brief Virtual to physical address translation between reader and cache
+ *
+ * The page table is one open-addressing hash table from (address space,
+ * virtual page) to frame, kept at most half full, so a lookup is a hash
+ * and one or two probes, with key and frame in the same slot so that a
+ * probe touches a single host cache line. In front of it, the last translation is kept, as
+ * a one-entry TLB: most accesses fall in the page of the one before, and
+ * translate with a compare.
+ *
+ * The random allocator draws frames with xorshift from a fixed seed, so
+ * runs are repeatable, and moves to the next free frame when it draws a
+ * used one. It fails once the TRANSLATE_MEMORY_BITS bytes of physical
+ * memory are all used.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "translate.h"
+
+/** @brief Initial number of slots of the page table */
+#define TRANSLATE_INITIAL_SLOTS 1024
+
+/** @brief Seed of the random allocator */
+#define TRANSLATE_SEED 0x9e3779b97f4a7c15UL
+
+/** @brief Bits of a key that hold the page number */
+#define TRANSLATE_PAGE_BITS 56
+
+static size_t hash_key(unsigned long key, size_t size) {
+    key *= 0x9e3779b97f4a7c15UL;
+    return (size_t)(key >> 32) & (size - 1);
+}
+
+/**
+ * @brief Parses an allocator name.
+ */
+bool translate_parse(const char *name, translate_alloc_t *alloc) {
+    if (strcmp(name, "seq") == 0)
+        *alloc = TRANSLATE_SEQ;
+    else if (strcmp(name, "random") == 0)
+        *alloc = TRANSLATE_RANDOM;
+    else if (strcmp(name, "color") == 0)
+        *alloc = TRANSLATE_COLOR;
+    else
+        return false;
+    return true;
+}
+
+/**
+ * @brief Creates a translator.
+ *
+ * @param[out] tr         The translator to initialize
+ * @param[in]  alloc      Frame allocator
+ * @param[in]  page_bits  log2 of the page size, from 8 to 30
+ * @param[in]  colors     Number of page colors of the color allocator, a
+ *                        power of two (usually cache size / associativity
+ *                        / page size); ignored by the other allocators
+ *
+ * @return True if the translator was allocated, false otherwise
+ */
+bool translate_init(translator_t *tr, translate_alloc_t alloc, int page_bits,
+                    unsigned long colors) {
+    memset(tr, 0, sizeof(*tr));
+    if (page_bits < 8 || page_bits > 30 || colors == 0 ||
+        (colors & (colors - 1)) != 0)
+        return false;
+
+    tr->alloc = alloc;
+    tr->page_bits = page_bits;
+    tr->colors = colors;
+    tr->rng = TRANSLATE_SEED;
+    tr->size = TRANSLATE_INITIAL_SLOTS;
+    tr->slots = calloc(tr->size, sizeof(*tr->slots));
+    bool ok = tr->slots != NULL;
+    if (ok && alloc == TRANSLATE_COLOR) {
+        tr->next_of = calloc(colors, sizeof(*tr->next_of));
+        ok = tr->next_of != NULL;
+    }
+    if (ok && alloc == TRANSLATE_RANDOM) {
+        tr->num_frames = 1UL << (TRANSLATE_MEMORY_BITS - page_bits);
+        tr->taken = calloc(tr->num_frames / 8, 1);
+        ok = tr->taken != NULL;
+    }
+    if (!ok)
+        translate_free(tr);
+    return ok;
+}
+
+/**
+ * @brief Releases the memory held by a translator.
+ */
+void translate_free(translator_t *tr) {
+    free(tr->slots);
+    free(tr->next_of);
+    free(tr->taken);
+    tr->slots = NULL;
+    tr->next_of = NULL;
+    tr->taken = NULL;
+}
+
+/**
+ * @brief Doubles the page table.
+ */
+static bool grow(translator_t *tr) {
+    size_t size = tr->size * 2;
+    translate_slot_t *slots = calloc(size, sizeof(*slots));
+    if (slots == NULL)
+        return false;
+    for (size_t i = 0; i < tr->size; i++) {
+        if (tr->slots[i].key == 0)
+            continue;
+        size_t slot = hash_key(tr->slots[i].key, size);
+        while (slots[slot].key != 0)
+            slot = (slot + 1) & (size - 1);
+        slots[slot] = tr->slots[i];
+    }
+    free(tr->slots);
+    tr->slots = slots;
+    tr->size = size;
+    return true;
+}
+
+/**
+ * @brief Allocates the frame of a page touched for the first time.
+ */
+static bool allocate(translator_t *tr, unsigned long page,
+                     unsigned long *frame) {
+    switch (tr->alloc) {
+    case TRANSLATE_SEQ:
+        *frame = tr->next++;
+        return true;
+    case TRANSLATE_COLOR: {
+        unsigned long color = page & (tr->colors - 1);
+        *frame = tr->next_of[color]++ * tr->colors + color;
+        return true;
+    }
+    case TRANSLATE_RANDOM:
+        break;
+    }
+
+    if (tr->used >= tr->num_frames)
+        return false;
+    tr->rng ^= tr->rng << 13;
+    tr->rng ^= tr->rng >> 7;
+    tr->rng ^= tr->rng << 17;
+    unsigned long f = tr->rng & (tr->num_frames - 1);
+    while (tr->taken[f / 8] & (1 << (f % 8)))
+        f = (f + 1) & (tr->num_frames - 1);
+    tr->taken[f / 8] |= (unsigned char)(1 << (f % 8));
+    *frame = f;
+    return true;
+}
+
+/**
+ * @brief Translates one address of an address space.
+ *
+ * @param[in,out] tr     The translator
+ * @param[in]     space  Address space, below 256
+ * @param[in]     addr   Virtual address
+ * @param[out]    phys   Physical address
+ *
+ * @return True on success, false if a new frame could not be allocated
+ */
+bool translate_addr(translator_t *tr, unsigned int space, unsigned long addr,
+                    unsigned long *phys) {
+    unsigned long page = addr >> tr->page_bits;
+    unsigned long offset = addr & ((1UL << tr->page_bits) - 1);
+    unsigned long key =
+        ((unsigned long)space << TRANSLATE_PAGE_BITS | page) + 1;
+
+    if (key == tr->last_key) {
+        *phys = tr->last_frame << tr->page_bits | offset;
+        return true;
+    }
+
+    size_t slot = hash_key(key, tr->size);
+    while (tr->slots[slot].key != 0 && tr->slots[slot].key != key)
+        slot = (slot + 1) & (tr->size - 1);
+    if (tr->slots[slot].key == 0) {
+        unsigned long frame;
+        if (!allocate(tr, page, &frame))
+            return false;
+        if (2 * (tr->used + 1) > tr->size) {
+            if (!grow(tr))
+                return false;
+            slot = hash_key(key, tr->size);
+            while (tr->slots[slot].key != 0)
+                slot = (slot + 1) & (tr->size - 1);
+        }
+        tr->slots[slot].key = key;
+        tr->slots[slot].frame = frame;
+        tr->used++;
+    }
+
+    tr->last_key = key;
+    tr->last_frame = tr->slots[slot].frame;
+    *phys = tr->last_frame << tr->page_bits | offset;
+    return true;
+}
+
+/**
+ * @brief Translates the accesses of a batch in place.
+ *
+ * Region markers are left as they are.
+ *
+ * @return True on success, false if a new frame could not be allocated
+ */
+bool translate_apply(translator_t *tr, unsigned int space,
+                     trace_access_t *accesses, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        if (accesses[i].op == TRACE_REGION_BEGIN ||
+            accesses[i].op == TRACE_REGION_END)
+            continue;
+        if (!translate_addr(tr, space, accesses[i].addr, &accesses[i].addr))
+            return false;
+    }
+    return true;
+}
@@ -0,0 +1,84 @@
+/**
+ * @file translate.h
+ * @brief Virtual to physical address translation between reader and cache
+ *
+ * Traces hold virtual addresses, but the caches that matter are usually
+ * physically indexed. A translator gives every virtual page a physical
+ * frame the first time it is touched, chosen by one of three allocators:
+ *
+ *   seq     frames in the order the pages are first touched
+ *   random  a random free frame of a fixed-size physical memory
+ *   color   the next free frame with the color (frame number modulo the
+ *           number of colors) of the virtual page, as an OS doing page
+ *           coloring would
+ *
+ * Every trace of a mix has an address space of its own, and all of them
+ * share the physical memory.
+ */
+
+#ifndef TRANSLATE_H
+#define TRANSLATE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "trace.h"
+
+/** @brief log2 of the bytes of physical memory of the random allocator */
+#define TRANSLATE_MEMORY_BITS 36
+
+/**
+ * @brief Frame allocators
+ */
+typedef enum {
+    TRANSLATE_SEQ,
+    TRANSLATE_RANDOM,
+    TRANSLATE_COLOR,
+} translate_alloc_t;
+
+/**
+ * @brief Slot of the page table
+ */
+typedef struct {
+    unsigned long key;   /* address space and page number + 1, 0 if free */
+    unsigned long frame; /* frame of the page */
+} translate_slot_t;
+
+/**
+ * @brief State of a translator
+ */
+typedef struct {
+    translate_alloc_t alloc; /* frame allocator */
+    int page_bits;           /* log2 of the page size */
+    unsigned long colors;    /* number of page colors, a power of two */
+    translate_slot_t *slots; /* page table */
+    size_t size;             /* slots in the page table, a power of two */
+    size_t used;             /* pages in the page table */
+    unsigned long last_key;  /* most recently translated key, or 0 */
+    unsigned long last_frame;
+    unsigned long next;      /* next frame of the seq allocator */
+    unsigned long *next_of;  /* next frame of each color */
+    unsigned char *taken;    /* frames used by the random allocator */
+    unsigned long num_frames;
+    unsigned long rng;       /* state of the random allocator */
+} translator_t;
+
+/** @brief Parses an allocator name ("seq", "random" or "color") */
+bool translate_parse(const char *name, translate_alloc_t *alloc);
+
+/** @brief Creates a translator */
+bool translate_init(translator_t *tr, translate_alloc_t alloc, int page_bits,
+                    unsigned long colors);
+
+/** @brief Releases the memory held by a translator */
+void translate_free(translator_t *tr);
+
+/** @brief Translates one address of an address space */
+bool translate_addr(translator_t *tr, unsigned int space, unsigned long addr,
+                    unsigned long *phys);
+
+/** @brief Translates the accesses of a batch in place */
+bool translate_apply(translator_t *tr, unsigned int space,
+                     trace_access_t *accesses, size_t count);
+
+#endif /* TRANSLATE_H */